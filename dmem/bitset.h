@@ -0,0 +1,122 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#pragma once
+
+#include "vector.h"
+
+/* A growable set of bits, stored 64 to a word. Bit i is bit (i % 64) of
+ * data[i / 64]. The bits past size in the last word are always clear.
+ *
+ * Set bits can be walked a word at a time with db_next:
+ *
+ *   dv_size_t i;
+ *   for (i = db_next(&bits, 0); i >= 0; i = db_next(&bits, i + 1)) {
+ *       ...
+ *   }
+ */
+typedef struct d_bitset d_bitset;
+struct d_bitset {
+    dv_size_t size;
+    uint64_t* data;
+};
+
+/* Static initializer */
+#define DB_INIT {0, NULL}
+
+/* Dynamic initializer */
+#define db_init(PBITS) ((PBITS)->size = 0, (PBITS)->data = NULL)
+
+#define db_free(BITS) dv_free_base((BITS).data)
+
+/* Returns the number of words used to store 'SIZE' bits */
+#define db_words(SIZE) (((SIZE) + 63) / 64)
+
+/* Resizes the set to hold 'size' bits. New bits are clear. */
+DMEM_API void db_resize(d_bitset* b, dv_size_t size);
+
+/* Appends a bit with the value 'value' */
+DMEM_API void db_append(d_bitset* b, bool value);
+
+/* Sets all the bits to 'value' */
+DMEM_API void db_fill(d_bitset* b, bool value);
+
+/* Tests, sets and clears the bit at index 'IDX' */
+#define db_test(BITS, IDX) (((BITS).data[(IDX) / 64] >> ((IDX) % 64)) & 1)
+#define db_set(PBITS, IDX) ((PBITS)->data[(IDX) / 64] |= (uint64_t) 1 << ((IDX) % 64))
+#define db_clear(PBITS, IDX) ((PBITS)->data[(IDX) / 64] &= ~((uint64_t) 1 << ((IDX) % 64)))
+#define db_assign(PBITS, IDX, VALUE) ((VALUE) ? db_set(PBITS, IDX) : db_clear(PBITS, IDX))
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the number of set bits */
+DMEM_API dv_size_t db_count(const d_bitset* b);
+
+/* Returns the number of set bits before index 'idx'. This counts from the
+ * start of the set so is O(idx) - use a d_bitset_rank for many queries. */
+DMEM_API dv_size_t db_rank(const d_bitset* b, dv_size_t idx);
+
+/* Returns the index of the set bit with rank 'n', ie the (n+1)th set bit,
+ * or -1 if there aren't that many. This scans from the start of the set so
+ * is O(size) - use a d_bitset_rank for many queries. */
+DMEM_API dv_size_t db_select(const d_bitset* b, dv_size_t n);
+
+/* An index of the number of set bits before each 512 bit block of a set,
+ * for rank in O(1) and select in O(log size). It takes 1/64th of the memory
+ * of the set with the default dv_size_t. The index is a snapshot and must
+ * be rebuilt with db_build_rank after the set changes.
+ */
+typedef struct d_bitset_rank d_bitset_rank;
+struct d_bitset_rank {
+    dv_size_t size;
+    dv_size_t* data;
+};
+
+#define DB_RANK_INIT {0, NULL}
+#define db_free_rank(RANK) dv_free_base((RANK).data)
+
+/* Builds or rebuilds the index 'r' for the set 'b' */
+DMEM_API void db_build_rank(d_bitset_rank* r, const d_bitset* b);
+
+/* As db_rank and db_select using the index 'r' built from 'b' */
+DMEM_API dv_size_t db_rank_indexed(const d_bitset_rank* r, const d_bitset* b, dv_size_t idx);
+DMEM_API dv_size_t db_select_indexed(const d_bitset_rank* r, const d_bitset* b, dv_size_t n);
+
+/* Returns the index of the first set bit at or after 'idx' or -1 if there
+ * are none */
+DMEM_API dv_size_t db_next(const d_bitset* b, dv_size_t idx);
+
+/* ------------------------------------------------------------------------- */
+
+/* Bulk operations a word (or SIMD register) at a time. db_or and db_xor
+ * grow 'to' to the size of 'from'. db_and clears the bits of 'to' past the
+ * end of 'from'. */
+DMEM_API void db_and(d_bitset* to, const d_bitset* from);
+DMEM_API void db_or(d_bitset* to, const d_bitset* from);
+DMEM_API void db_xor(d_bitset* to, const d_bitset* from);
+
+/* Clears the bits in 'to' that are set in 'from' */
+DMEM_API void db_andnot(d_bitset* to, const d_bitset* from);
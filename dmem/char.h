@@ -37,17 +37,17 @@ typedef d_slice(char) d_string;
 /* Macro to wrap char slices/vectors for printing with printf - use "%.*s" in
  * the format string.
  */
-#define DV_PRI(STR) (STR).size, (STR).data
+#define DV_PRI(STR) (int) (STR).size, (STR).data
 
 /* ------------------------------------------------------------------------- */
 
 /* Returns a slice for the null terminated string 'str' */
 DMEM_INLINE d_string dv_char(const char* str)
-{ d_string ret = {str ? (int) strlen(str) : 0, (char*) str}; return ret; }
+{ d_string ret = {str ? (dv_size_t) strlen(str) : 0, (char*) str}; return ret; }
 
 #ifdef __cplusplus
 DMEM_INLINE d_string dv_char(char* str)
-{ d_string ret = {str ? (int) strlen(str) : 0, str}; return ret; }
+{ d_string ret = {str ? (dv_size_t) strlen(str) : 0, str}; return ret; }
 
 /* Overload for std::string and compatible interfaces */
 template <class T>
@@ -56,11 +56,11 @@ DMEM_INLINE d_string dv_char(const T& str)
 #endif
 
 DMEM_INLINE d_string dv_char2(const char* str, size_t size)
-{ d_string ret = {(int) size, (char*) str}; return ret; }
+{ d_string ret = {(dv_size_t) size, (char*) str}; return ret; }
 
 #ifdef __cplusplus
 DMEM_INLINE d_string dv_char2(char* str, size_t size)
-{ d_string ret = {(int) size, str}; return ret; }
+{ d_string ret = {(dv_size_t) size, str}; return ret; }
 #endif
 
 /* Macro to convert char string literals into a d_string */
@@ -81,8 +81,92 @@ typedef struct { uint32_t d[8]; } dv_char_mask;
 
 DMEM_API dv_char_mask dv_create_mask(d_string chars);
 
-/* Appends a base64 encoded version of 'from' to 'to' */
+/* Returns whether the byte 'ch' is in the mask */
+DMEM_INLINE bool dv_in_mask(const dv_char_mask* mask, int ch)
+{ return (mask->d[(ch & 0xFF) >> 5] >> (ch & 31)) & 1; }
+
+/* Static initializer for a mask of up to 32 characters, so that constant
+ * separator sets are built at compile time, eg:
+ *
+ *   static const dv_char_mask ws = DV_MASK_INIT(' ', '\t', '\r', '\n');
+ *   d_string word = dv_split_mask(&line, &ws);
+ *
+ * Characters past the 32nd are ignored. C++ can use dv_mask("...") instead.
+ */
+#define DV_MASK_INIT(...) {{                                                \
+        DVI_MASK_WORD(0, __VA_ARGS__, DVI_MASK_PAD),                        \
+        DVI_MASK_WORD(1, __VA_ARGS__, DVI_MASK_PAD),                        \
+        DVI_MASK_WORD(2, __VA_ARGS__, DVI_MASK_PAD),                        \
+        DVI_MASK_WORD(3, __VA_ARGS__, DVI_MASK_PAD),                        \
+        DVI_MASK_WORD(4, __VA_ARGS__, DVI_MASK_PAD),                        \
+        DVI_MASK_WORD(5, __VA_ARGS__, DVI_MASK_PAD),                        \
+        DVI_MASK_WORD(6, __VA_ARGS__, DVI_MASK_PAD),                        \
+        DVI_MASK_WORD(7, __VA_ARGS__, DVI_MASK_PAD)}}
+
+/* 0x100 is past the last byte value and so never sets a bit */
+#define DVI_MASK_NONE 0x100
+#define DVI_MASK_BIT(w, c) ((c) == DVI_MASK_NONE || (((c) & 0xFF) >> 5) != (w) ? 0U : 1U << ((c) & 31))
+
+#define DVI_MASK_PAD                                                        \
+    DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE,             \
+    DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE,             \
+    DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE,             \
+    DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE,             \
+    DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE,             \
+    DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE,             \
+    DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE,             \
+    DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE, DVI_MASK_NONE
+
+/* The extra level expands DVI_MASK_PAD before the arguments are counted */
+#define DVI_MASK_WORD(...) DVI_MASK_WORD2(__VA_ARGS__)
+#define DVI_MASK_WORD2(w, c0, c1, c2, c3, c4, c5, c6, c7, c8, c9, c10, c11, \
+        c12, c13, c14, c15, c16, c17, c18, c19, c20, c21, c22, c23, c24,    \
+        c25, c26, c27, c28, c29, c30, c31, ...) (                           \
+    DVI_MASK_BIT(w, c0) | DVI_MASK_BIT(w, c1) | DVI_MASK_BIT(w, c2) |       \
+    DVI_MASK_BIT(w, c3) | DVI_MASK_BIT(w, c4) | DVI_MASK_BIT(w, c5) |       \
+    DVI_MASK_BIT(w, c6) | DVI_MASK_BIT(w, c7) | DVI_MASK_BIT(w, c8) |       \
+    DVI_MASK_BIT(w, c9) | DVI_MASK_BIT(w, c10) | DVI_MASK_BIT(w, c11) |     \
+    DVI_MASK_BIT(w, c12) | DVI_MASK_BIT(w, c13) | DVI_MASK_BIT(w, c14) |    \
+    DVI_MASK_BIT(w, c15) | DVI_MASK_BIT(w, c16) | DVI_MASK_BIT(w, c17) |    \
+    DVI_MASK_BIT(w, c18) | DVI_MASK_BIT(w, c19) | DVI_MASK_BIT(w, c20) |    \
+    DVI_MASK_BIT(w, c21) | DVI_MASK_BIT(w, c22) | DVI_MASK_BIT(w, c23) |    \
+    DVI_MASK_BIT(w, c24) | DVI_MASK_BIT(w, c25) | DVI_MASK_BIT(w, c26) |    \
+    DVI_MASK_BIT(w, c27) | DVI_MASK_BIT(w, c28) | DVI_MASK_BIT(w, c29) |    \
+    DVI_MASK_BIT(w, c30) | DVI_MASK_BIT(w, c31))
+
+#if defined __cplusplus && __cplusplus >= 201103L
+constexpr uint32_t dvi_mask_word(const char* str, size_t num, unsigned w)
+{
+    return num == 0 ? 0 : dvi_mask_word(str + 1, num - 1, w)
+        | ((unsigned char) str[0] >> 5 == w ? 1U << ((unsigned char) str[0] & 31) : 0U);
+}
+
+/* Builds the mask of the characters in the string literal 'str' at compile
+ * time, eg constexpr dv_char_mask ws = dv_mask(" \t\r\n"); */
+template <size_t N>
+constexpr dv_char_mask dv_mask(const char (&str)[N])
+{
+    return dv_char_mask{{
+        dvi_mask_word(str, N - 1, 0), dvi_mask_word(str, N - 1, 1),
+        dvi_mask_word(str, N - 1, 2), dvi_mask_word(str, N - 1, 3),
+        dvi_mask_word(str, N - 1, 4), dvi_mask_word(str, N - 1, 5),
+        dvi_mask_word(str, N - 1, 6), dvi_mask_word(str, N - 1, 7)}};
+}
+#endif
+
+/* Appends a base64 encoded version of 'from' to 'to'. The url version uses
+ * the URL and filename safe alphabet ('-' and '_' for '+' and '/') without
+ * padding. */
 DMEM_API void dv_base64_encode(d_vector(char)* to, d_string from);
+DMEM_API void dv_base64url_encode(d_vector(char)* to, d_string from);
+
+/* Appends the base64 decoded version of 'from' to 'to'. Returns -1 and
+ * leaves 'to' unchanged if 'from' is not valid base64: characters outside
+ * the alphabet (including whitespace), missing or misplaced padding, or
+ * non-zero unused bits in the last character. Padding is optional for the
+ * url version. */
+DMEM_API int dv_base64_decode(d_vector(char)* to, d_string from);
+DMEM_API int dv_base64url_decode(d_vector(char)* to, d_string from);
 
 /* Appends a hex decoded/encoded version of 'from' to 'to' */
 DMEM_API void dv_hex_decode(d_vector(char)* to, d_string from);
@@ -104,23 +188,27 @@ DMEM_API void dv_url_encode(d_vector(char)* to, d_string from, dv_char_mask* kee
 /* Searches in from for sep (or the bytes in sep). Updating from with the
  * remaining slice after the seperator and returns the slice before the
  * seperator. Will return the whole string if sep can not be found. Multiple
- * seperators in a row will return empty strings.
+ * seperators in a row will return empty strings. The mask versions take a
+ * prebuilt set of seperator bytes (see DV_MASK_INIT).
  */
 DMEM_API d_string dv_split_char(d_string* from, int sep);
 DMEM_API d_string dv_split_one_of(d_string* from, d_string sep);
 DMEM_API d_string dv_split_string(d_string* from, d_string sep);
+DMEM_API d_string dv_split_mask(d_string* from, const dv_char_mask* sep);
 
 /* Searches for the first occurrence of ch in str. Returning -1 if it can
  * not be found */
-DMEM_API int dv_find_char(d_string str, int ch);
-DMEM_API int dv_find_one_of(d_string str, d_string sep);
-DMEM_API int dv_find_string(d_string str, d_string val);
+DMEM_API dv_size_t dv_find_char(d_string str, int ch);
+DMEM_API dv_size_t dv_find_one_of(d_string str, d_string sep);
+DMEM_API dv_size_t dv_find_string(d_string str, d_string val);
+DMEM_API dv_size_t dv_find_mask(d_string str, const dv_char_mask* chars);
 
 /* Searches for the last occurrence of ch in str. Returning -1 if it can not be
  * found */
-DMEM_API int dv_find_last_char(d_string str, int ch);
-DMEM_API int dv_find_last_one_of(d_string str, d_string sep);
-DMEM_API int dv_find_last_string(d_string str, d_string val);
+DMEM_API dv_size_t dv_find_last_char(d_string str, int ch);
+DMEM_API dv_size_t dv_find_last_one_of(d_string str, d_string sep);
+DMEM_API dv_size_t dv_find_last_string(d_string str, d_string val);
+DMEM_API dv_size_t dv_find_last_mask(d_string str, const dv_char_mask* chars);
 
 /* Splits from on the next newline. Returning the line without line endings,
  * and updates from to the remaining string. Will return a null slice if no
@@ -134,30 +222,78 @@ DMEM_API d_string dv_strip_whitespace(d_string str);
 
 /* ------------------------------------------------------------------------- */
 
+/* Sorts a vector of strings (d_string or d_vector(char)) in the order given
+ * by dv_cmp using a most significant byte first radix sort.
+ */
+DMEM_API void dv_sort_string_base(d_string* data, dv_size_t size);
+
+#define dv_sort_string(pvec)                                                \
+    do {                                                                    \
+        STATIC_ASSERT(dv_pdatasize(pvec) == sizeof(d_string));              \
+        dv_sort_string_base((d_string*) (pvec)->data, (pvec)->size);        \
+    } while (0)
+
+/* ------------------------------------------------------------------------- */
+
 /* Returns the slice left of index from */
-DMEM_INLINE d_string dv_left(d_string str, int from)
+DMEM_INLINE d_string dv_left(d_string str, dv_size_t from)
 { d_string ret = {from, str.data}; return ret; }
 
 /* Returns the slice right of index from */
-DMEM_INLINE d_string dv_right(d_string str, int from)
+DMEM_INLINE d_string dv_right(d_string str, dv_size_t from)
 { d_string ret = {str.size - from, str.data + from}; return ret; }
 
 /* Returns the slice starting at from and size long */
-DMEM_INLINE d_string dv_slice(d_string str, int from, int size)
+DMEM_INLINE d_string dv_slice(d_string str, dv_size_t from, dv_size_t size)
 { d_string ret = {size, str.data + from}; return ret; }
 
 /* ------------------------------------------------------------------------- */
 
-/* Converts the string slice to a number - see strtod for valid values */
+/* Parses a number from the start of 'str' into *out. This accepts an
+ * optional sign, digits with an optional fraction and exponent, and "inf",
+ * "infinity" and "nan" in any case. It doesn't allocate or depend on the
+ * locale and the result is correctly rounded. Values out of range give
+ * +/-HUGE_VAL or zero. Returns the number of bytes parsed or 0 if 'str'
+ * doesn't start with a number.
+ */
+DMEM_API dv_size_t dv_parse_number(d_string str, double* out);
+
+/* Parses an integer with an optional sign from the start of 'str' into
+ * *out. As with strtol a radix of 0 picks 16 for a 0x prefix, 8 for a
+ * leading 0 and 10 otherwise. Returns the number of bytes parsed, 0 if
+ * 'str' doesn't start with an integer or -1 if it doesn't fit in an
+ * int64_t.
+ */
+DMEM_API dv_size_t dv_parse_integer(d_string str, int radix, int64_t* out);
+
+/* Converts the string slice to a number after skipping leading whitespace
+ * using the functions above. dv_to_number returns 0 if the slice isn't a
+ * number followed by optional whitespace, or NAN if it's empty.
+ * dv_to_integer returns 'def' if the slice isn't an integer or doesn't fit
+ * in an int.
+ */
 DMEM_API double dv_to_number(d_string value);
 DMEM_API int dv_to_integer(d_string value, int radix, int def);
 
+/* Appends the shortest decimal that parses back to exactly 'value'. Like
+ * JavaScript this is written out in full for values from 1e-6 up to 1e21
+ * and with an exponent (eg 1.5e+300) otherwise. Infinities and NaN are
+ * written as "inf", "-inf" and "nan".
+ */
+DMEM_API void dv_append_number(d_vector(char)* to, double value);
+
+/* Appends 'value' in decimal */
+DMEM_API void dv_append_integer(d_vector(char)* to, int64_t value);
+
 /* ------------------------------------------------------------------------- */
 
 /* Appends a sprintf formatted string to 's' */
 DMEM_API int dv_print(d_vector(char)* s, const char* format, ...) DMEM_PRINTF(2, 3);
 DMEM_API int dv_vprint(d_vector(char)* s, const char* format, va_list ap) DMEM_PRINTF(2, 0);
 
+/* Appends a readable summary of dv_get_stats to 's' */
+DMEM_API void dv_print_stats(d_vector(char)* s);
+
 /* ------------------------------------------------------------------------- */
 
 /* The two path functions should only be used for unix style paths with /
@@ -170,7 +306,7 @@ DMEM_API void dv_clean_path(d_vector(char)* out, d_string path);
  * at off to the end of the vector. If rel is an absolute path, it replaces
  * the path in out. Finally the resulting path is cleaned.
  */
-DMEM_API void dv_join_path(d_vector(char)* out, int off, d_string rel);
+DMEM_API void dv_join_path(d_vector(char)* out, dv_size_t off, d_string rel);
 
 /* Appends the current working directory into out. Returns length of current
  * directory or -1 on error. */
@@ -0,0 +1,149 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#pragma once
+
+#include "vector.h"
+
+/* A work stealing thread pool and parallel algorithms over vectors.
+ *
+ * Work is handed to the pool as a range of indices. The thread running a
+ * range keeps splitting the top half off onto its own queue until the rest
+ * is no bigger than the grain, and idle threads steal the largest pieces
+ * from the other end of other threads' queues. The thread that calls into
+ * the pool works on the range too and returns once all of it is done.
+ * Pools can be used from one caller at a time plus from inside tasks
+ * running on the pool.
+ *
+ * Ranges smaller than the pool's serial threshold are run directly on the
+ * calling thread, as is everything on a NULL pool or a pool of one thread.
+ *
+ * For example upper casing a large buffer:
+ *
+ *   static void upper(void* udata, void* data, dv_size_t num) {
+ *       char* p = (char*) data;
+ *       dv_size_t i;
+ *       for (i = 0; i < num; i++) {
+ *           p[i] = toupper(p[i]);
+ *       }
+ *   }
+ *
+ *   dp_pool* pool = dp_new_pool(0);
+ *   dp_for_each(pool, buf, &upper, NULL);
+ *   dp_sort_int(pool, &values);
+ *   dp_free_pool(pool);
+ *
+ * Uses POSIX threads.
+ */
+typedef struct dp_pool dp_pool;
+
+/* Creates a pool using 'threads' threads including the calling thread, or
+ * one per CPU if 'threads' is 0 or less. The pool has fewer threads if
+ * they can't all be started. Returns NULL if the pool can't be allocated,
+ * which the functions below take as running on the calling thread. */
+DMEM_API dp_pool* dp_new_pool(int threads);
+
+/* Waits for the threads to exit and frees the pool */
+DMEM_API void dp_free_pool(dp_pool* p);
+
+/* Returns the number of threads used by the pool */
+DMEM_API int dp_threads(const dp_pool* p);
+
+/* Sets the number of values below which the algorithms run serially on the
+ * calling thread. Defaults to 16384. */
+DMEM_API void dp_set_serial_threshold(dp_pool* p, dv_size_t num);
+
+/* ------------------------------------------------------------------------- */
+
+typedef void (*dp_range_fn)(void* udata, dv_size_t begin, dv_size_t end);
+
+/* Calls 'func' over ranges that together cover the indices 0 to 'num',
+ * splitting them no smaller than 'grain' */
+DMEM_API void dp_for(dp_pool* p, dv_size_t num, dv_size_t grain, dp_range_fn func, void* udata);
+
+/* ------------------------------------------------------------------------- */
+
+typedef void (*dp_each_fn)(void* udata, void* data, dv_size_t num);
+
+DMEM_API void dp_for_each_base(dp_pool* p, void* data, dv_size_t num, int typesz, dp_each_fn func, void* udata);
+
+/* Calls 'FUNC(UDATA, data, num)' over consecutive runs of the values in the
+ * vector 'VEC' */
+#define dp_for_each(POOL, VEC, FUNC, UDATA) dp_for_each_base(POOL, (VEC).data, (VEC).size, dv_datasize(VEC), FUNC, UDATA)
+
+typedef void (*dp_transform_fn)(void* udata, void* to, const void* from, dv_size_t num);
+
+DMEM_API void dp_transform_base(dp_pool* p, void* to, int totypesz, const void* from, int fromtypesz, dv_size_t num, dp_transform_fn func, void* udata);
+
+/* Resizes the vector 'PTO' to the size of 'FROM' and calls
+ * 'FUNC(UDATA, to, from, num)' over consecutive runs of the two */
+#define dp_transform(POOL, PTO, FROM, FUNC, UDATA)                          \
+    do {                                                                    \
+        dv_resize(PTO, (FROM).size);                                        \
+        dp_transform_base(POOL, (PTO)->data, dv_pdatasize(PTO),             \
+                (FROM).data, dv_datasize(FROM), (FROM).size, FUNC, UDATA);  \
+    } while (0)
+
+/* ------------------------------------------------------------------------- */
+
+typedef void (*dp_reduce_fn)(void* udata, void* acc, const void* data, dv_size_t num);
+typedef void (*dp_combine_fn)(void* udata, void* acc, const void* other);
+
+DMEM_API void dp_reduce_base(dp_pool* p, const void* data, dv_size_t num, int typesz, void* acc, int accsz, dp_reduce_fn reduce, dp_combine_fn combine, void* udata);
+
+/* Folds the values in the vector 'VEC' into '*PACC'. 'REDUCE(UDATA, acc,
+ * data, num)' folds a run of values into an accumulator and
+ * 'COMBINE(UDATA, acc, other)' folds one accumulator into another. Each
+ * run starts from a copy of the initial '*PACC', so it must be the
+ * identity for the operation. The results of the runs are combined in
+ * order, so the operation needs to be associative but not commutative.
+ */
+#define dp_reduce(POOL, VEC, PACC, REDUCE, COMBINE, UDATA) dp_reduce_base(POOL, (VEC).data, (VEC).size, dv_datasize(VEC), PACC, (int) sizeof(*(PACC)), REDUCE, COMBINE, UDATA)
+
+/* ------------------------------------------------------------------------- */
+
+typedef bool (*dp_keep_fn)(void* udata, const void* value);
+
+DMEM_API void dp_filter_base(dp_pool* p, struct dv_base* v, int typesz, dp_keep_fn keep, void* udata);
+
+/* Removes the values from the vector 'PVEC' for which 'KEEP(UDATA, value)'
+ * returns false. The remaining values keep their order. */
+#define dp_filter(POOL, PVEC, KEEP, UDATA) dp_filter_base(POOL, (struct dv_base*) (PVEC), dv_pdatasize(PVEC), KEEP, UDATA)
+
+/* ------------------------------------------------------------------------- */
+
+DMEM_API void dp_sort_base(dp_pool* p, void* data, dv_size_t num, int typesz, int (*cmp)(const void*, const void*));
+DMEM_API void dp_radix_sort_base(dp_pool* p, void* data, dv_size_t num, int typesz, bool is_signed);
+
+/* Sorts the vector 'PVEC' using the qsort style comparison 'CMP'. Runs of
+ * the vector are sorted with qsort in parallel and then merged together,
+ * so the sort is stable only if qsort is. */
+#define dp_sort(POOL, PVEC, CMP) dp_sort_base(POOL, (PVEC)->data, (PVEC)->size, dv_pdatasize(PVEC), CMP)
+
+/* Sorts a vector of signed or unsigned integers. Runs are sorted with
+ * dv_sort_int/dv_sort_uint in parallel and then merged together. */
+#define dp_sort_int(POOL, PVEC) dp_radix_sort_base(POOL, (PVEC)->data, (PVEC)->size, dv_pdatasize(PVEC), true)
+#define dp_sort_uint(POOL, PVEC) dp_radix_sort_base(POOL, (PVEC)->data, (PVEC)->size, dv_pdatasize(PVEC), false)
@@ -0,0 +1,168 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "vector.h"
+
+/* A ring buffer holding values of 'type' with constant time push and pop at
+ * both ends. The values run from data[begin] and wrap around to data[0]
+ * once they reach data[capacity].
+ *
+ * For example a network input buffer:
+ *
+ *   DRING_INIT(char, char);
+ *   d_ring(char) in = DR_INIT;
+ *   d_string a, b;
+ *
+ *   dr_append2(&in, buf, bufsz);
+ *   dr_slices(in, &a, &b);
+ *   dj_parse_chunk(parser, a);
+ *   dj_parse_chunk(parser, b);
+ *   dr_clear(&in);
+ */
+#define DRING_INIT(name, type)                                              \
+    typedef struct d_ring_##name d_ring_##name;                             \
+    struct d_ring_##name {                                                  \
+        dv_size_t size;                                                     \
+        type* data;                                                         \
+        dv_size_t begin;                                                    \
+        dv_size_t capacity;                                                 \
+    }
+
+#define d_ring(name) d_ring_##name
+
+struct dr_base {
+    dv_size_t size;
+    void* data;
+    dv_size_t begin;
+    dv_size_t capacity;
+};
+
+DMEM_API void dr_reserve_base(struct dr_base* r, dv_size_t newsz, int typesz);
+DMEM_API void dr_append_base(struct dr_base* r, const void* data, dv_size_t num, int typesz);
+
+/* Wraps an index that has overrun the capacity by less than the capacity */
+DMEM_INLINE dv_size_t dri_wrap(dv_size_t idx, dv_size_t capacity)
+{ return idx >= capacity ? idx - capacity : idx; }
+
+/* ------------------------------------------------------------------------- */
+
+/* Static initializer */
+#define DR_INIT {0, NULL, 0, 0}
+
+/* Dynamic initializer */
+#define dr_init(PRING) ((PRING)->size = 0, (PRING)->data = NULL, (PRING)->begin = 0, (PRING)->capacity = 0)
+
+#define dr_free(RING) dv_free_base((RING).data)
+
+/* Makes sure the ring can hold 'NEWSZ' values without reallocating */
+#define dr_reserve(PRING, NEWSZ) dr_reserve_base((struct dr_base*) (PRING), NEWSZ, dv_pdatasize(PRING))
+
+/* Removes all values */
+#define dr_clear(PRING) ((PRING)->size = 0, (PRING)->begin = 0)
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the value at index 'IDX' from the front */
+#define dr_at(RING, IDX) ((RING).data[dri_wrap((RING).begin + (IDX), (RING).capacity)])
+
+#define dr_front(RING) ((RING).data[(RING).begin])
+#define dr_back(RING) dr_at(RING, (RING).size - 1)
+
+/* ------------------------------------------------------------------------- */
+
+/* Adds 'VALUE' to the end of the ring. VALUE is only evaluated once. */
+#define dr_push_back(PRING, VALUE)                                          \
+    do {                                                                    \
+        dr_reserve(PRING, (PRING)->size + 1);                               \
+        dr_at(*(PRING), (PRING)->size) = (VALUE);                           \
+        (PRING)->size++;                                                    \
+    } while (0)
+
+/* Adds 'VALUE' to the front of the ring. VALUE is only evaluated once. */
+#define dr_push_front(PRING, VALUE)                                         \
+    do {                                                                    \
+        dr_reserve(PRING, (PRING)->size + 1);                               \
+        (PRING)->begin = ((PRING)->begin ? (PRING)->begin : (PRING)->capacity) - 1; \
+        (PRING)->data[(PRING)->begin] = (VALUE);                            \
+        (PRING)->size++;                                                    \
+    } while (0)
+
+/* Removes 'NUM' values from the front of the ring. The ring restarts at
+ * data[0] when it empties so that later appends are contiguous.
+ */
+#define dr_erase_front(PRING, NUM)                                          \
+    do {                                                                    \
+        dv_size_t _num = (NUM);                                             \
+        (PRING)->size -= _num;                                              \
+        (PRING)->begin = (PRING)->size ? dri_wrap((PRING)->begin + _num, (PRING)->capacity) : 0; \
+    } while (0)
+
+/* Removes 'NUM' values from the back of the ring */
+#define dr_erase_back(PRING, NUM)                                           \
+    do {                                                                    \
+        (PRING)->size -= (NUM);                                             \
+        if ((PRING)->size == 0) {                                           \
+            (PRING)->begin = 0;                                             \
+        }                                                                   \
+    } while (0)
+
+#define dr_pop_front(PRING) dr_erase_front(PRING, 1)
+#define dr_pop_back(PRING) dr_erase_back(PRING, 1)
+
+/* ------------------------------------------------------------------------- */
+
+/* Appends a copy of 'DATA' of size 'SZ' to the back of the ring. This copies
+ * with at most two memcpys. */
+#define dr_append2(PRING, DATA, SZ)                                         \
+    do {                                                                    \
+        STATIC_ASSERT(sizeof((DATA)[0]) == dv_pdatasize(PRING));            \
+        dr_append_base((struct dr_base*) (PRING), DATA, SZ, dv_pdatasize(PRING)); \
+    } while (0)
+
+/* Appends the vector or slice 'FROM' to the back of the ring. FROM is
+ * evaluated twice. */
+#define dr_append(PRING, FROM) dr_append2(PRING, (FROM).data, (FROM).size)
+
+/* Sets the slices 'PFIRST' and 'PSECOND' to the values in the ring in
+ * order. PSECOND is empty if the values do not wrap. The slices must be of
+ * the same type as the ring (eg d_string for a ring of char) and are only
+ * valid until the ring is next modified.
+ */
+#define dr_slices(RING, PFIRST, PSECOND)                                    \
+    do {                                                                    \
+        dv_size_t _first = (RING).capacity - (RING).begin;                  \
+        if (_first > (RING).size) {                                         \
+            _first = (RING).size;                                           \
+        }                                                                   \
+        (PFIRST)->data = (RING).data + (RING).begin;                        \
+        (PFIRST)->size = _first;                                            \
+        (PSECOND)->data = (RING).data;                                      \
+        (PSECOND)->size = (RING).size - _first;                             \
+    } while (0)
+
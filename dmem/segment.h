@@ -0,0 +1,184 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#pragma once
+
+#include "vector.h"
+
+/* A segmented vector holding values of 'type' that never moves a value once
+ * it has been added, so pointers into it stay valid while appending. The
+ * values are stored in blocks that double in size, block k holding 16 << k
+ * values, so an index maps to its block and offset with a single bit scan.
+ *
+ * For example a scope stack where each scope keeps a pointer to its parent:
+ *
+ *   DSEGMENT_INIT(Scope, Scope);
+ *   d_segment(Scope) stack = DSG_INIT;
+ *   Scope* top = NULL;
+ *   Scope child;
+ *
+ *   child.parent = top;
+ *   dsg_push_back(&stack, child);
+ *   top = &dsg_back(stack);
+ *   ...
+ *   dsg_free(&stack);
+ */
+
+#define DSGI_SHIFT 4
+#define DSGI_FIRST (1 << DSGI_SHIFT)
+
+/* Enough blocks to hold any index that fits in dv_size_t */
+#define DSG_BLOCKS (sizeof(dv_size_t) * 8 - DSGI_SHIFT)
+
+#define DSEGMENT_INIT(name, type)                                           \
+    typedef struct d_segment_##name d_segment_##name;                       \
+    struct d_segment_##name {                                               \
+        dv_size_t size;                                                     \
+        dv_size_t capacity;                                                 \
+        type* blocks[DSG_BLOCKS];                                           \
+    }
+
+#define d_segment(name) d_segment_##name
+
+struct dsg_base {
+    dv_size_t size;
+    dv_size_t capacity;
+    void* blocks[DSG_BLOCKS];
+};
+
+DMEM_API void dsg_reserve_base(struct dsg_base* s, dv_size_t newsz, int typesz);
+DMEM_API void dsg_append_base(struct dsg_base* s, const void* data, dv_size_t num, int typesz);
+DMEM_API void dsg_free_base(struct dsg_base* s);
+
+/* Returns the block holding index 'idx' */
+DMEM_INLINE int dsgi_block(dv_size_t idx)
+{
+    uint64_t j = (uint64_t) idx + DSGI_FIRST;
+#ifdef __GNUC__
+    return 63 - __builtin_clzll(j) - DSGI_SHIFT;
+#else
+    int n = -1 - DSGI_SHIFT;
+    while (j) {
+        j >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* Returns the offset of index 'idx' within its block */
+DMEM_INLINE dv_size_t dsgi_offset(dv_size_t idx)
+{ return idx + DSGI_FIRST - ((dv_size_t) DSGI_FIRST << dsgi_block(idx)); }
+
+/* Returns the number of values block 'k' holds */
+DMEM_INLINE dv_size_t dsg_block_size(int k)
+{ return (dv_size_t) DSGI_FIRST << k; }
+
+/* ------------------------------------------------------------------------- */
+
+/* Static initializer */
+#define DSG_INIT {0}
+
+/* Dynamic initializer */
+#define dsg_init(PSEG) memset(PSEG, 0, sizeof(*(PSEG)))
+
+/* Frees all of the blocks and resets the segment to empty */
+#define dsg_free(PSEG) dsg_free_base((struct dsg_base*) (PSEG))
+
+#define dsg_pdatasize(PSEG) ((int) sizeof(*(PSEG)->blocks[0]))
+
+/* Makes sure the segment can hold 'NEWSZ' values without allocating */
+#define dsg_reserve(PSEG, NEWSZ) dsg_reserve_base((struct dsg_base*) (PSEG), NEWSZ, dsg_pdatasize(PSEG))
+
+/* Resizes the segment to 'NEWSZ' values. New values are uninitialised. */
+#define dsg_resize(PSEG, NEWSZ)                                             \
+    do {                                                                    \
+        dv_size_t _newsz = (NEWSZ);                                         \
+        dsg_reserve(PSEG, _newsz);                                          \
+        (PSEG)->size = _newsz;                                              \
+    } while (0)
+
+/* Removes all values. The blocks are kept for reuse. */
+#define dsg_clear(PSEG) ((PSEG)->size = 0)
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the value at index 'IDX'. IDX is evaluated twice. */
+#define dsg_at(SEG, IDX) ((SEG).blocks[dsgi_block(IDX)][dsgi_offset(IDX)])
+
+#define dsg_front(SEG) ((SEG).blocks[0][0])
+#define dsg_back(SEG) dsg_at(SEG, (SEG).size - 1)
+
+/* Returns the number of blocks holding values */
+#define dsg_blocks(SEG) ((SEG).size ? dsgi_block((SEG).size - 1) + 1 : 0)
+
+/* Sets the slice 'PSLICE' to the values in block 'K'. This is the fast way
+ * to scan the values in order:
+ *
+ *   for (k = 0; k < dsg_blocks(seg); k++) {
+ *       dsg_block(seg, k, &slice);
+ *       for (i = 0; i < slice.size; i++) {
+ *           ... slice.data[i] ...
+ *       }
+ *   }
+ */
+#define dsg_block(SEG, K, PSLICE)                                           \
+    do {                                                                    \
+        int _k = (K);                                                       \
+        dv_size_t _begin = dsg_block_size(_k) - DSGI_FIRST;                 \
+        dv_size_t _end = _begin + dsg_block_size(_k);                       \
+        (PSLICE)->data = (SEG).blocks[_k];                                  \
+        (PSLICE)->size = ((SEG).size < _end ? (SEG).size : _end) - _begin;  \
+    } while (0)
+
+/* ------------------------------------------------------------------------- */
+
+/* Adds 'VALUE' to the end of the segment. VALUE is only evaluated once. */
+#define dsg_push_back(PSEG, VALUE)                                          \
+    do {                                                                    \
+        if ((PSEG)->size == (PSEG)->capacity) {                             \
+            dsg_reserve(PSEG, (PSEG)->size + 1);                            \
+        }                                                                   \
+        dsg_at(*(PSEG), (PSEG)->size) = (VALUE);                            \
+        (PSEG)->size++;                                                     \
+    } while (0)
+
+/* Removes 'NUM' values from the back of the segment */
+#define dsg_erase_back(PSEG, NUM) ((PSEG)->size -= (NUM))
+#define dsg_pop_back(PSEG) dsg_erase_back(PSEG, 1)
+
+/* Appends a copy of 'DATA' of size 'SZ' to the back of the segment. This
+ * copies with one memcpy per block touched. */
+#define dsg_append2(PSEG, DATA, SZ)                                         \
+    do {                                                                    \
+        STATIC_ASSERT(sizeof((DATA)[0]) == dsg_pdatasize(PSEG));            \
+        dsg_append_base((struct dsg_base*) (PSEG), DATA, SZ, dsg_pdatasize(PSEG)); \
+    } while (0)
+
+/* Appends the vector or slice 'FROM' to the back of the segment. FROM is
+ * evaluated twice. */
+#define dsg_append(PSEG, FROM) dsg_append2(PSEG, (FROM).data, (FROM).size)
+
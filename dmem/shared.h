@@ -0,0 +1,96 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#pragma once
+
+#include "char.h"
+
+/* An immutable reference counted string. Copies and slices share the one
+ * buffer and only bump its count, and the buffer is freed once the last
+ * reference is released with ds_free. The counts are atomic so references
+ * can be handed between threads.
+ *
+ * size and data come first so a d_shared can be used with DV_PRI and
+ * ds_string gives a borrowed d_string for the dv_* functions. Only strings
+ * from ds_new are null terminated, slices generally aren't.
+ *
+ * For example keeping JSON keys beyond the delegate callback:
+ *
+ *   d_shared doc = ds_take(&file_contents);
+ *   dj_parse_shared(doc, dlg, &errstr);
+ *   ds_free(doc);
+ *
+ *   static bool on_child(Config* c, dj_Node* n) {
+ *       c->name = ds_retain(n->source, n->key);
+ *       ...
+ *   }
+ */
+typedef struct d_shared d_shared;
+typedef struct dsi_buffer dsi_buffer;
+
+struct d_shared {
+    dv_size_t size;
+    const char* data;
+    dsi_buffer* buf;
+};
+
+/* Static initializer */
+#define DS_INIT {0, NULL, NULL}
+
+/* Dynamic initializer */
+#define ds_init(PSTR) ((PSTR)->size = 0, (PSTR)->data = NULL, (PSTR)->buf = NULL)
+
+/* Returns a borrowed d_string for the shared string 'STR' */
+#define ds_string(STR) dv_char2((STR).data, (STR).size)
+
+/* Returns a new shared string holding a copy of 'str' */
+DMEM_API d_shared ds_new(d_string str);
+
+/* Takes over the storage of the vector 'v' without copying it. 'v' is left
+ * empty. */
+DMEM_API d_shared ds_take(d_vector(char)* v);
+
+/* Returns another reference to 's' */
+DMEM_API d_shared ds_copy(d_shared s);
+
+/* Returns a reference to the chars from index 'from' up to but not
+ * including 'to' in 's'. The slice keeps the whole buffer alive. */
+DMEM_API d_shared ds_slice(d_shared s, dv_size_t from, dv_size_t to);
+
+/* Returns a reference for 'str'. When 'str' points into the buffer of
+ * 'parent' this is a slice of it, otherwise 'str' is copied into a new
+ * buffer. Used to keep strings handed out by the parsers. */
+DMEM_API d_shared ds_retain(d_shared parent, d_string str);
+
+/* Releases the reference 's' */
+DMEM_API void ds_free(d_shared s);
+
+/* Returns true if other references share the buffer of 's' */
+DMEM_API bool ds_is_shared(d_shared s);
+
+/* Returns a writable pointer to the chars of '*ps', first copying them into
+ * a buffer of its own if the buffer is shared (copy on write). */
+DMEM_API char* ds_unshare(d_shared* ps);
@@ -0,0 +1,126 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#pragma once
+
+#include "vector.h"
+
+/* Declares a struct of arrays vector d_soa(name) with one column per field
+ * and a shared size, for loops that only touch a few fields of large
+ * records. The fields are given as an X macro taking the type and name of
+ * each field.
+ *
+ * For example:
+ *
+ *   #define TRADE_FIELDS(X) X(double, price) X(int, qty) X(int, id)
+ *   DVECTOR_SOA_INIT(trade, TRADE_FIELDS);
+ *
+ *   d_soa(trade) t = DSOA_INIT;
+ *   dv_size_t i = dsoa_append_trade(&t, 1);
+ *   t.price[i] = 1.5;
+ *   t.qty[i] = 10;
+ *   t.id[i] = 42;
+ *   ...
+ *   dsoa_free_trade(&t);
+ *
+ * This declares the struct and the following functions, which apply to
+ * every column:
+ *
+ * dsoa_reserve_<name>(v, num)      - reserves space for 'num' rows
+ * dsoa_resize_<name>(v, num)       - resizes to 'num' rows, new rows are
+ *                                    uninitialised
+ * dsoa_append_<name>(v, num)       - appends 'num' uninitialised rows and
+ *                                    returns the index of the first
+ * dsoa_erase_<name>(v, idx, num)   - erases 'num' rows beginning at 'idx'
+ * dsoa_swap_remove_<name>(v, idx)  - removes row 'idx' by moving the last
+ *                                    row into its place
+ * dsoa_free_<name>(v)              - frees the columns
+ */
+#define DVECTOR_SOA_INIT(name, FIELDS)                                      \
+    typedef struct d_soa_##name d_soa_##name;                               \
+                                                                            \
+    struct d_soa_##name {                                                   \
+        dv_size_t size;                                                     \
+        dv_size_t capacity;                                                 \
+        FIELDS(DSOAI_FIELD)                                                 \
+    };                                                                      \
+                                                                            \
+    DMEM_INLINE void dsoa_reserve_##name(d_soa_##name* v, dv_size_t num)    \
+    {                                                                       \
+        dv_size_t n = v->capacity * 2 + 16;                                 \
+        if (num <= v->capacity) {                                           \
+            return;                                                         \
+        }                                                                   \
+        if (n < num) {                                                      \
+            n = num;                                                        \
+        }                                                                   \
+        FIELDS(DSOAI_RESERVE)                                               \
+        v->capacity = n;                                                    \
+    }                                                                       \
+                                                                            \
+    DMEM_INLINE void dsoa_resize_##name(d_soa_##name* v, dv_size_t num)     \
+    {                                                                       \
+        dsoa_reserve_##name(v, num);                                        \
+        v->size = num;                                                      \
+    }                                                                       \
+                                                                            \
+    DMEM_INLINE dv_size_t dsoa_append_##name(d_soa_##name* v, dv_size_t num) \
+    {                                                                       \
+        dv_size_t idx = v->size;                                            \
+        dsoa_reserve_##name(v, idx + num);                                  \
+        v->size = idx + num;                                                \
+        return idx;                                                         \
+    }                                                                       \
+                                                                            \
+    DMEM_INLINE void dsoa_erase_##name(d_soa_##name* v, dv_size_t idx, dv_size_t num) \
+    {                                                                       \
+        FIELDS(DSOAI_ERASE)                                                 \
+        v->size -= num;                                                     \
+    }                                                                       \
+                                                                            \
+    DMEM_INLINE void dsoa_swap_remove_##name(d_soa_##name* v, dv_size_t idx) \
+    {                                                                       \
+        v->size--;                                                          \
+        FIELDS(DSOAI_SWAP_REMOVE)                                           \
+    }                                                                       \
+                                                                            \
+    DMEM_INLINE void dsoa_free_##name(d_soa_##name* v)                      \
+    {                                                                       \
+        FIELDS(DSOAI_FREE)                                                  \
+        memset(v, 0, sizeof(*v));                                           \
+    }
+
+#define d_soa(name) d_soa_##name
+
+/* Static initializer */
+#define DSOA_INIT {0}
+
+/* Per field pieces of DVECTOR_SOA_INIT */
+#define DSOAI_FIELD(type, field) type* field;
+#define DSOAI_RESERVE(type, field) v->field = (type*) dv_resize_base(v->field, n * (dv_size_t) sizeof(type));
+#define DSOAI_ERASE(type, field) memmove(v->field + idx, v->field + idx + num, (v->size - idx - num) * sizeof(type));
+#define DSOAI_SWAP_REMOVE(type, field) v->field[idx] = v->field[v->size];
+#define DSOAI_FREE(type, field) dv_free_base(v->field);
@@ -0,0 +1,87 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "char.h"
+
+/* An editable char buffer for making many inserts and erases into a large
+ * piece of text. It's a gap buffer: the text is held in a vector block with
+ * a gap at the last edit position, so edits near the previous edit only
+ * move the text between the two positions. Jumping around still costs
+ * moving the text in between.
+ *
+ * The text before the gap is data[0] to data[gap - 1] and the text after is
+ * data[gap + (capacity - size)] up to data[capacity - 1].
+ */
+typedef struct d_text d_text;
+struct d_text {
+    dv_size_t size;
+    char* data;
+    dv_size_t gap;
+    dv_size_t capacity;
+};
+
+/* Static initializer */
+#define DT_INIT {0, NULL, 0, 0}
+
+/* Dynamic initializer */
+#define dt_init(PTEXT) ((PTEXT)->size = 0, (PTEXT)->data = NULL, (PTEXT)->gap = 0, (PTEXT)->capacity = 0)
+
+#define dt_free(TEXT) dv_free_base((TEXT).data)
+
+/* Takes over the storage of the vector 'v' with the gap at the end. 'v' is
+ * left empty. */
+DMEM_API void dt_take(d_text* t, d_vector(char)* v);
+
+/* Returns the char at index 'IDX' */
+#define dt_at(TEXT, IDX) ((TEXT).data[(IDX) < (TEXT).gap ? (IDX) : (IDX) + (TEXT).capacity - (TEXT).size])
+
+/* Inserts 'str' at index 'idx' */
+DMEM_API void dt_insert(d_text* t, dv_size_t idx, d_string str);
+
+/* Inserts 'num' uninitialised chars at index 'idx' and returns a pointer to
+ * them. The pointer is valid until the text is next modified. */
+DMEM_API char* dt_insert_buffer(d_text* t, dv_size_t idx, dv_size_t num);
+
+/* Erases 'num' chars beginning at index 'idx' */
+DMEM_API void dt_erase(d_text* t, dv_size_t idx, dv_size_t num);
+
+/* Appends 'str' to the end of the text */
+#define dt_append(PTEXT, STR) dt_insert(PTEXT, (PTEXT)->size, STR)
+
+/* Sets 'before' and 'after' to the text on either side of the gap. These are
+ * only valid until the text is next modified. */
+DMEM_API void dt_slices(const d_text* t, d_string* before, d_string* after);
+
+/* Moves the text into a null terminated d_vector(char) without copying it
+ * into new storage. 't' is left empty. */
+DMEM_API d_vector(char) dt_release(d_text* t);
+
+/* Appends a copy of the text to 'out' */
+DMEM_API void dt_flatten(d_vector(char)* out, const d_text* t);
+
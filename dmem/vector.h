@@ -32,6 +32,7 @@
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <limits.h>
 #include "common.h"
 
 /* ------------------------------------------------------------------------- */
@@ -51,17 +52,46 @@ DMEM_API void* dv_memrchr(const void* s, int c, size_t n);
 
 /* ------------------------------------------------------------------------- */
 
+/* The library picks SSE2 or AVX2 code paths at runtime based on the CPU.
+ * dv_set_simd limits the level used, mostly so that tests can compare the
+ * SIMD paths with the scalar fallbacks.
+ */
+#define DV_SIMD_NONE 0
+#define DV_SIMD_SSE2 1
+#define DV_SIMD_AVX2 2
+
+DMEM_API void dv_set_simd(int level);
+
+/* ------------------------------------------------------------------------- */
+
+/* Vector sizes and indices are int by default. Defining DMEM_LARGE_SIZE
+ * switches them to ptrdiff_t so that vectors and slices can hold more than
+ * 2GB. This changes the ABI of the library, so the library and all of its
+ * users must be built with the same setting.
+ */
+#ifdef DMEM_LARGE_SIZE
+typedef ptrdiff_t dv_size_t;
+#define DV_SIZE_MAX PTRDIFF_MAX
+#else
+typedef int dv_size_t;
+#define DV_SIZE_MAX INT_MAX
+#endif
+
+/* ------------------------------------------------------------------------- */
+
 /* Declares a new vector d_vector(name) and slice d_slice(name) that holds
- * 'type' data values
+ * 'type' data values. In C++ the slice is tagged with dv_slice_of so that
+ * templates can tell it apart from the owning vector.
  */
 #ifdef __cplusplus
 #define DVECTOR_INIT(name, type)                                            \
     struct d_slice_##name {                                                 \
-        int size;                                                           \
+        typedef type dv_slice_of;                                           \
+        dv_size_t size;                                                     \
         type* data;                                                         \
     };                                                                      \
     struct d_vector_##name {                                                \
-        int size;                                                           \
+        dv_size_t size;                                                     \
         type* data;                                                         \
         operator d_slice_##name() const {                                   \
             d_slice_##name ret = {size, data};                              \
@@ -74,7 +104,7 @@ DMEM_API void* dv_memrchr(const void* s, int c, size_t n);
     typedef struct d_vector_##name d_slice_##name;                          \
                                                                             \
     struct d_vector_##name {                                                \
-        int size;                                                           \
+        dv_size_t size;                                                     \
         type* data;                                                         \
     }
 #endif
@@ -82,6 +112,24 @@ DMEM_API void* dv_memrchr(const void* s, int c, size_t n);
 #define d_vector(name) d_vector_##name
 #define d_slice(name) d_slice_##name
 
+/* Declares d_inline(name) which holds a vector 'v' of type d_vector(vecname)
+ * along with N bytes of inline storage. The vector only goes to the heap
+ * once it outgrows the inline storage. Initialise it with dv_init_inline and
+ * then use &x.v with the usual dv_* macros - dv_free(x.v) is still required
+ * to release any spilled storage. A zeroed d_inline is a valid empty vector
+ * that doesn't use its inline storage.
+ */
+#define DVECTOR_INLINE_INIT(name, vecname, N)                               \
+    typedef struct d_inline_##name d_inline_##name;                         \
+                                                                            \
+    struct d_inline_##name {                                                \
+        d_vector(vecname) v;                                                \
+        uint64_t hdr[DVI_HEADER_WORDS];                                     \
+        uint64_t buf[((N) + 7) / 8 + 1];                                    \
+    }
+
+#define d_inline(name) d_inline_##name
+
 /* ------------------------------------------------------------------------- */
 
 #ifdef __cplusplus
@@ -96,17 +144,145 @@ T* dv_cast(T* p, void* u)
 #define dv_pdatasize(PVEC) ((int) sizeof((PVEC)->data[0]))
 
 struct dv_base {
-    int size;
+    dv_size_t size;
     void* data;
 };
 
-DMEM_API void* dv_resize_base(void* p, int newsz);
+/* ------------------------------------------------------------------------- */
+
+/* Defining DMEM_STATS builds in allocation statistics for all vector
+ * storage (see dv_get_stats). This adds to the block header, so like
+ * DMEM_LARGE_SIZE the library and its users must agree on it. Without it
+ * there is no tracking code at all.
+ */
+#ifdef DMEM_STATS
+#define DVI_HEADER_WORDS 4
+#else
+#define DVI_HEADER_WORDS 2
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+/* Allocators provide the storage behind vectors. realloc is given the
+ * existing block (or NULL) along with the old and new block sizes in bytes
+ * and returns the new block or NULL on failure. free releases a block. Each
+ * vector remembers the allocator it was created with so that later growth
+ * and dv_free go back to the same allocator.
+ */
+typedef struct dv_allocator dv_allocator;
+
+struct dv_allocator {
+    void* (*realloc)(dv_allocator* a, void* p, size_t oldsz, size_t newsz);
+    void (*free)(dv_allocator* a, void* p, size_t sz);
+};
+
+/* Sets the allocator used for new vectors on the current thread. NULL
+ * selects the default malloc based allocator. Returns the previous
+ * allocator so it can be restored at the end of a scope.
+ */
+DMEM_API dv_allocator* dv_set_allocator(dv_allocator* a);
+
+/* Returns the allocator used for new vectors on the current thread or NULL
+ * for the default. */
+DMEM_API dv_allocator* dv_current_allocator(void);
+
+/* Returns the allocator that owns the vector data 'p' */
+DMEM_API dv_allocator* dv_allocator_base(void* p);
+
+/* Bump allocator - all blocks allocated from the arena are released together
+ * by dv_arena_reset or dv_arena_free. Growing or freeing the most recent
+ * allocation happens in place.
+ */
+typedef struct dv_arena dv_arena;
+typedef struct dvi_arena_block dvi_arena_block;
+
+struct dv_arena {
+    dv_allocator base;
+    dvi_arena_block* blocks;
+    char* next;
+    char* end;
+    size_t block_size;
+};
+
+/* Initialises the arena. block_size is the size of each chunk requested
+ * from malloc, 0 selects a default.
+ */
+DMEM_API void dv_arena_init(dv_arena* a, size_t block_size);
+
+/* Releases all allocations made from the arena but keeps the first chunk
+ * around for reuse */
+DMEM_API void dv_arena_reset(dv_arena* a);
+
+/* Releases all allocations and memory held by the arena */
+DMEM_API void dv_arena_free(dv_arena* a);
+
+/* Vectors using the default allocator move into their own anonymous memory
+ * map once they grow past 'threshold' bytes, after which growth uses mremap
+ * rather than copying. 0 disables this. huge_pages asks the kernel to back
+ * the maps with transparent huge pages. Only has an effect on Linux. The
+ * default threshold is 64MB.
+ */
+DMEM_API void dv_set_mmap_threshold(size_t threshold, bool huge_pages);
+
+/* Buffer pool - with a non-zero limit, freed blocks from the default
+ * allocator of up to 1MB are kept on size class free lists and handed back
+ * out to new or growing vectors rather than going through malloc. Each
+ * thread keeps a small cache of its own and falls back to lists shared by
+ * all threads. 'max_bytes' caps the memory held across all of them. New
+ * default allocator vectors are rounded up to a size class while the pool
+ * is enabled. The pool is off (0) by default.
+ */
+DMEM_API void dv_set_pool_limit(size_t max_bytes);
+
+/* Releases the blocks cached by the current thread and those on the shared
+ * lists back to malloc. A thread's cache moves onto the shared lists when
+ * the thread exits.
+ */
+DMEM_API void dv_pool_trim(void);
+
+/* Returns the number of bytes currently held by the pool */
+DMEM_API size_t dv_pool_size(void);
+
+/* ------------------------------------------------------------------------- */
+
+#define DV_STATS_BUCKETS 48
+
+typedef struct dv_stats dv_stats;
+
+struct dv_stats {
+    int64_t live;       /* allocated vector blocks, not counting inline storage */
+    int64_t reserved;   /* bytes reserved by the live blocks */
+    int64_t used;       /* bytes last asked for through dv_resize_base */
+    int64_t reallocs;   /* times a block had to grow */
+    int64_t copied;     /* bytes copied when a growing block moved */
+
+    /* live blocks with a reserved size in [2^i, 2^(i+1)) */
+    int64_t sizes[DV_STATS_BUCKETS];
+};
+
+/* Fills out 'stats' with the totals across all threads. Returns false and
+ * zeros 'stats' if the library was built without DMEM_STATS. The used size
+ * does not see changes made to a vector's size directly rather than
+ * through the dv_* macros.
+ */
+DMEM_API bool dv_get_stats(dv_stats* stats);
+
+/* ------------------------------------------------------------------------- */
+
+/* The untyped block functions behind the dv_* macros. The other containers
+ * (ring.h, bitset.h, soa.h, segment.h and the C++ wrapper) keep their
+ * storage in blocks from these too, so the allocator, arena, pool and
+ * stats setup above applies to them as well.
+ */
+DMEM_API void* dv_resize_base(void* p, dv_size_t newsz);
+DMEM_API void* dv_resize_alloc_base(dv_allocator* a, void* p, dv_size_t newsz);
+DMEM_API void* dv_init_inline_base(uint64_t* hdr, size_t reserved);
 DMEM_API size_t dv_reserved_base(void* p);
 DMEM_API void dv_free_base(void* p);
-DMEM_API void* dv_append_buffer_base(struct dv_base* v, int num, int typesz);
-DMEM_API void* dv_append_zeroed_base(struct dv_base* v, int num, int typesz);
-DMEM_API void* dv_insert_buffer_base(struct dv_base* v, int idx, int num, int typesz);
-DMEM_API void* dv_insert_zeroed_base(struct dv_base* v, int idx, int num, int typesz);
+DMEM_API void* dv_append_buffer_base(struct dv_base* v, dv_size_t num, int typesz);
+DMEM_API void* dv_append_zeroed_base(struct dv_base* v, dv_size_t num, int typesz);
+DMEM_API void* dv_insert_buffer_base(struct dv_base* v, dv_size_t idx, dv_size_t num, int typesz);
+DMEM_API void* dv_insert_zeroed_base(struct dv_base* v, dv_size_t idx, dv_size_t num, int typesz);
 
 /* ------------------------------------------------------------------------- */
 
@@ -116,12 +292,29 @@ DMEM_API void* dv_insert_zeroed_base(struct dv_base* v, int idx, int num, int ty
 /* Dynamic initializer */
 #define dv_init(PVEC) ((PVEC)->data = NULL, (PVEC)->size = 0)
 
+/* Initialises the d_inline 'PIV' to an empty vector using its inline storage.
+ * Any spilled storage must be freed first.
+ */
+#define dv_init_inline(PIV) ((PIV)->v.size = 0, (PIV)->v.data = dv_cast((PIV)->v.data, dv_init_inline_base((PIV)->hdr, sizeof((PIV)->buf) - 8)))
+
+/* Repoints the d_inline 'PIV' at its inline storage after the struct has been
+ * copied or moved (eg by growing a vector of structs containing it). Does
+ * nothing if the vector has already spilled to the heap.
+ */
+#define dv_inline_moved(PIV) ((PIV)->hdr[DVI_HEADER_WORDS - 1] ? (void) ((PIV)->v.data = dv_cast((PIV)->v.data, (void*) (PIV)->buf)) : (void) 0)
+
 /* Frees the data in 'VEC'*/
 #define dv_free(VEC) dv_free_base((VEC).data)
 
 /* Reserves enough space in the vector to hold 'newsz' values */
 #define dv_reserve(PVEC, NEWSZ) ((PVEC)->data = dv_cast((PVEC)->data, dv_resize_base((PVEC)->data, (NEWSZ) * dv_pdatasize(PVEC))))
 
+/* Reserves enough space in the vector to hold 'newsz' values using the
+ * allocator 'ALLOC' (NULL for the malloc default). Existing data is moved
+ * over if the vector was using a different allocator.
+ */
+#define dv_reserve_alloc(PVEC, NEWSZ, ALLOC) ((PVEC)->data = dv_cast((PVEC)->data, dv_resize_alloc_base(ALLOC, (PVEC)->data, (NEWSZ) * dv_pdatasize(PVEC))))
+
 /* Returns the amount of space reserved in the vector */
 #define dv_reserved(VEC) dv_reserved_base((VEC).data)
 
@@ -156,8 +349,8 @@ DMEM_API void* dv_insert_zeroed_base(struct dv_base* v, int idx, int num, int ty
     do {                                                                    \
         STATIC_ASSERT(sizeof((DATA)[0]) == dv_pdatasize(PTO));              \
         const void* _fromdata = DATA;                                       \
-        int _fromsz = SZ;                                                   \
-        int _tosz = (PTO)->size;                                            \
+        dv_size_t _fromsz = SZ;                                             \
+        dv_size_t _tosz = (PTO)->size;                                      \
         (PTO)->size += _fromsz;                                             \
         dv_reserve(PTO, (PTO)->size);                                       \
         memcpy((PTO)->data + _tosz, _fromdata, _fromsz * dv_pdatasize(PTO));\
@@ -187,7 +380,7 @@ void dv_append(T* to, F from)
 #define dv_append(PTO, FROM)                                                \
     do {                                                                    \
         void* _todata, *_fromdata;                                          \
-        int _tosz, _fromsz;                                                 \
+        dv_size_t _tosz, _fromsz;                                           \
         _todata = (PTO)->data;                                              \
         _tosz = (PTO)->size;                                                \
         *(PTO) = (FROM); /* only eval FROM once */                          \
@@ -238,7 +431,7 @@ void dv_set(T* to, F from)
     do {                                                                    \
         STATIC_ASSERT(sizeof((DATA)[0]) == dv_pdatasize(PTO));              \
         const void* _fromdata = (DATA);                                     \
-        int _fromsz = (SZ);                                                 \
+        dv_size_t _fromsz = (SZ);                                           \
         void* _todata = dv_insert_buffer(PTO, INDEX, _fromsz);              \
         memcpy(_todata, _fromdata, _fromsz * dv_pdatasize(PTO));            \
     } while(0)
@@ -248,13 +441,13 @@ void dv_set(T* to, F from)
 /* Inserts a copy of 'FROM' at index 'INDEX' in 'PTO' */
 #ifdef __cplusplus
 template <class T, class U> inline
-void dv_insert(T* to, int idx, U from)
+void dv_insert(T* to, dv_size_t idx, U from)
 { dv_insert2(to, idx, from.data, from.size); }
 #else
 #define dv_insert(PTO, INDEX, FROM)                                         \
     do {                                                                    \
         void* _todata, *_fromdata;                                          \
-        int _tosz, _fromsz;                                                 \
+        dv_size_t _tosz, _fromsz;                                           \
         _todata = (PTO)->data;                                              \
         _tosz = (PTO)->size;                                                \
         *(PTO) = (FROM); /* only eval FROM once */                          \
@@ -272,9 +465,9 @@ void dv_insert(T* to, int idx, U from)
 /* Erases 'NUM' values beginning with data[INDEX] */
 #define dv_erase(PVEC, INDEX, NUM)                                          \
     do {                                                                    \
-        int _from = (int) (INDEX);                                          \
-        int _num = (int) (NUM);                                             \
-        int _to = _from + _num;                                             \
+        dv_size_t _from = (dv_size_t) (INDEX);                              \
+        dv_size_t _num = (dv_size_t) (NUM);                                 \
+        dv_size_t _to = _from + _num;                                       \
         memmove(&(PVEC)->data[_from], &(PVEC)->data[_to], ((PVEC)->size - _to) * dv_pdatasize(PVEC)); \
         dv_resize(PVEC, (PVEC)->size - _num);                               \
     } while(0)
@@ -289,35 +482,118 @@ void dv_insert(T* to, int idx, U from)
 
 /* Removes all items for which 'test' resolves to true - use INDEX to
  * reference the current index. eg test could be
- * "should_remove(&myvec.data[INDEX])"
+ * "should_remove(&myvec.data[INDEX])". The remaining items keep their order.
+ * This is a single pass with separate read and write cursors, so 'test' is
+ * called with the original index of each item and should not look at items
+ * before INDEX as they may have already been overwritten.
  */
 #define dv_remove2(pvec, test)                                              \
     do {                                                                    \
-        int INDEX;                                                          \
-        for (INDEX = 0; INDEX < (pvec)->size;) {                            \
+        dv_size_t INDEX, _w = 0;                                            \
+        for (INDEX = 0; INDEX < (pvec)->size; INDEX++) {                    \
+            if (!(test)) {                                                  \
+                if (_w != INDEX) {                                          \
+                    (pvec)->data[_w] = (pvec)->data[INDEX];                 \
+                }                                                           \
+                _w++;                                                       \
+            }                                                               \
+        }                                                                   \
+        if (_w != (pvec)->size) {                                           \
+            dv_resize(pvec, _w);                                            \
+        }                                                                   \
+    } while (0)
+
+/* Erases data[INDEX] by moving the last value into its place. This does not
+ * keep the order of the vector but is constant time.
+ */
+#define dv_swap_erase(PVEC, INDEX)                                          \
+    do {                                                                    \
+        dv_size_t _idx = (dv_size_t) (INDEX);                               \
+        (PVEC)->data[_idx] = (PVEC)->data[(PVEC)->size - 1];                \
+        dv_resize(PVEC, (PVEC)->size - 1);                                  \
+    } while (0)
+
+/* Removes all values that equal 'val' in the vector 'pvec' without keeping
+ * the order of the remaining values.
+ */
+#define dv_swap_remove(pvec, val) dv_swap_remove2(pvec, (pvec)->data[INDEX] == (val))
+
+/* Removes all items for which 'test' resolves to true by moving values from
+ * the end into their place. This only moves one value per removed item, but
+ * does not keep the order. Use INDEX to reference the current index as in
+ * dv_remove2.
+ */
+#define dv_swap_remove2(pvec, test)                                         \
+    do {                                                                    \
+        dv_size_t INDEX, _end = (pvec)->size;                               \
+        for (INDEX = 0; INDEX < _end;) {                                    \
             if (test) {                                                     \
-                dv_erase(pvec, INDEX, 1);                                   \
+                (pvec)->data[INDEX] = (pvec)->data[--_end];                 \
             } else {                                                        \
                 INDEX++;                                                    \
             }                                                               \
         }                                                                   \
-    } while (0)                                                             \
+        if (_end != (pvec)->size) {                                         \
+            dv_resize(pvec, _end);                                          \
+        }                                                                   \
+    } while (0)
+
+/* ------------------------------------------------------------------------- */
+
+DMEM_INLINE void dv_swap_base(void* a, void* b, int typesz)
+{
+    unsigned char* pa = (unsigned char*) a;
+    unsigned char* pb = (unsigned char*) b;
+    unsigned char tmp[64];
+    while (typesz > 0) {
+        int n = typesz < (int) sizeof(tmp) ? typesz : (int) sizeof(tmp);
+        memcpy(tmp, pa, n);
+        memcpy(pa, pb, n);
+        memcpy(pb, tmp, n);
+        pa += n;
+        pb += n;
+        typesz -= n;
+    }
+}
+
+/* Swaps the values data[IDX1] and data[IDX2] */
+#define dv_swap(PVEC, IDX1, IDX2) dv_swap_base(&(PVEC)->data[IDX1], &(PVEC)->data[IDX2], dv_pdatasize(PVEC))
+
+/* Reorders the vector so that all items for which 'test' resolves to true
+ * come before those for which it is false and sets 'pidx' to the number of
+ * true items. The order within each group is not kept. 'test' should use
+ * INDEX to reference the current index and is called once for each item.
+ * 'pidx' should point to a dv_size_t.
+ */
+#define dv_partition(pvec, test, pidx)                                      \
+    do {                                                                    \
+        dv_size_t INDEX, _w = 0;                                            \
+        for (INDEX = 0; INDEX < (pvec)->size; INDEX++) {                    \
+            if (test) {                                                     \
+                if (_w != INDEX) {                                          \
+                    dv_swap(pvec, _w, INDEX);                               \
+                }                                                           \
+                _w++;                                                       \
+            }                                                               \
+        }                                                                   \
+        *(pidx) = _w;                                                       \
+    } while (0)
 
 /* ------------------------------------------------------------------------- */
 
 /* Sets 'pidx' to the index of the value which equals 'val' in 'vec' or -1 if
- * none is found. 'pidx' should point to an int.
+ * none is found. 'pidx' should point to a dv_size_t.
  */
 #define dv_find(vec, val, pidx) dv_find2(vec, (vec).data[INDEX] == (val), pidx)
 
 /* Iterates over the vector values until 'test' evaluates to true. 'test'
  * should use the local variable INDEX to reference the index. eg test could
  * be "test_item(&myvec.data[INDEX])". 'pidx' is then set to the found index
- * or -1 if none is found. 'pidx' should point to an int.
+ * or -1 if none is found. 'pidx' should point to a dv_size_t.
  */
 #define dv_find2(vec, test, pidx)                                           \
     do {                                                                    \
-        int INDEX;                                                          \
+        dv_size_t INDEX;                                                    \
         *(pidx) = -1;                                                       \
         for (INDEX = 0; INDEX < (vec).size; INDEX++) {                      \
             if (test) {                                                     \
@@ -329,7 +605,217 @@ void dv_insert(T* to, int idx, U from)
 
 /* ------------------------------------------------------------------------- */
 
-DMEM_API int dv_cmp_base(void* adata, int asz, void* bdata, int bsz);
+DMEM_API dv_size_t dv_find_int_base(const void* data, dv_size_t size, int typesz, uint64_t val);
+DMEM_API dv_size_t dv_count_int_base(const void* data, dv_size_t size, int typesz, uint64_t val);
+DMEM_API dv_size_t dv_find_any_int_base(const void* data, dv_size_t size, int typesz, const void* vals, dv_size_t num);
+
+/* Returns the index of the first value equal to 'val' in 'vec' or -1 if none
+ * is found. 'vec' must be a vector or slice of 8, 16, 32 or 64 bit integers.
+ * This uses SSE2 or AVX2 when the CPU supports it.
+ */
+#define dv_find_int(vec, val) dv_find_int_base((vec).data, (vec).size, dv_datasize(vec), (uint64_t) (val))
+
+/* Returns the number of values equal to 'val' in the integer vector 'vec' */
+#define dv_count_int(vec, val) dv_count_int_base((vec).data, (vec).size, dv_datasize(vec), (uint64_t) (val))
+
+/* Returns the index of the first value in the integer vector 'vec' that
+ * equals any of the values in 'vals' or -1 if none is found. 'vals' must be
+ * a vector or slice of the same type.
+ */
+#define dv_find_any_int(vec, vals) dv_find_any_int_base((vec).data, (vec).size, dv_datasize(vec), (vals).data, (vals).size)
+
+/* ------------------------------------------------------------------------- */
+
+/* Used by the sort macros to evaluate 'less' with INDEX1 and INDEX2 set */
+#define DVI_LESS(IDX1, IDX2, less) (INDEX1 = (IDX1), INDEX2 = (IDX2), (less))
+
+/* Insertion sort of data[LO] to data[HI] for small ranges */
+#define DVI_INSERTION_SORT(pvec, less, LO, HI)                              \
+    for (_i = (LO) + 1; _i <= (HI); _i++) {                                 \
+        for (_j = _i; _j > (LO) && DVI_LESS(_j, _j - 1, less); _j--) {      \
+            dv_swap(pvec, _j, _j - 1);                                      \
+        }                                                                   \
+    }
+
+/* Heap sort of data[LO] to data[HI], used when quicksort is going badly.
+ * This uses a single sift down loop for both the heapify and sort down
+ * phases.
+ */
+#define DVI_HEAP_SORT(pvec, less, LO, HI)                                   \
+    _k = (HI) - (LO) + 1;                                                   \
+    _j = _k / 2;                                                            \
+    for (;;) {                                                              \
+        if (_j > 0) {                                                       \
+            _i = --_j;                                                      \
+        } else if (--_k > 0) {                                              \
+            dv_swap(pvec, (LO), (LO) + _k);                                 \
+            _i = 0;                                                         \
+        } else {                                                            \
+            break;                                                          \
+        }                                                                   \
+        for (;;) {                                                          \
+            _n = 2 * _i + 1;                                                \
+            if (_n >= _k) break;                                            \
+            if (_n + 1 < _k && DVI_LESS((LO) + _n, (LO) + _n + 1, less)) _n++; \
+            if (!DVI_LESS((LO) + _i, (LO) + _n, less)) break;               \
+            dv_swap(pvec, (LO) + _i, (LO) + _n);                            \
+            _i = _n;                                                        \
+        }                                                                   \
+    }
+
+/* Partitions data[LO] to data[HI] around the median of the first, middle
+ * and last values and leaves the pivot index in _j.
+ */
+#define DVI_PARTITION(pvec, less, LO, HI)                                   \
+    _k = (LO) + ((HI) - (LO)) / 2;                                          \
+    if (DVI_LESS(_k, (LO), less)) dv_swap(pvec, _k, (LO));                  \
+    if (DVI_LESS((HI), (LO), less)) dv_swap(pvec, (HI), (LO));              \
+    if (DVI_LESS((HI), _k, less)) dv_swap(pvec, (HI), _k);                  \
+    dv_swap(pvec, (LO), _k);                                                \
+    _i = (LO) + 1;                                                          \
+    _j = (HI);                                                              \
+    for (;;) {                                                              \
+        while (_i <= _j && DVI_LESS(_i, (LO), less)) _i++;                  \
+        while (_i <= _j && DVI_LESS((LO), _j, less)) _j--;                  \
+        if (_i >= _j) break;                                                \
+        dv_swap(pvec, _i, _j);                                              \
+        _i++;                                                               \
+        _j--;                                                               \
+    }                                                                       \
+    dv_swap(pvec, (LO), _j);
+
+/* Sorts the vector in place using 'less' which should use the local
+ * variables INDEX1 and INDEX2 to reference the two indices to compare and
+ * resolve to true if data[INDEX1] should sort before data[INDEX2]. eg less
+ * could be "myvec.data[INDEX1].key < myvec.data[INDEX2].key". The sort is
+ * not stable. It's a quicksort with a median of three pivot which falls back
+ * to heap sort on bad inputs and insertion sort for small ranges, so 'less'
+ * is inlined rather than called through a function pointer.
+ */
+#define dv_sort2(pvec, less)                                                \
+    do {                                                                    \
+        dv_size_t INDEX1, INDEX2, _lo, _hi, _i, _j, _k, _n;                 \
+        dv_size_t _stack[64 * 3];                                           \
+        dv_size_t _budget = 0;                                              \
+        int _sp = 0;                                                        \
+        for (_i = (pvec)->size; _i > 1; _i >>= 1) {                         \
+            _budget += 2;                                                   \
+        }                                                                   \
+        _lo = 0;                                                            \
+        _hi = (pvec)->size - 1;                                             \
+        for (;;) {                                                          \
+            if (_hi - _lo < 16) {                                           \
+                DVI_INSERTION_SORT(pvec, less, _lo, _hi)                    \
+            } else if (_budget == 0) {                                      \
+                DVI_HEAP_SORT(pvec, less, _lo, _hi)                         \
+            } else {                                                        \
+                _budget--;                                                  \
+                DVI_PARTITION(pvec, less, _lo, _hi)                         \
+                /* push the larger side and loop on the smaller */          \
+                if (_j - _lo > _hi - _j) {                                  \
+                    _stack[_sp++] = _lo;                                    \
+                    _stack[_sp++] = _j - 1;                                 \
+                    _stack[_sp++] = _budget;                                \
+                    _lo = _j + 1;                                           \
+                } else {                                                    \
+                    _stack[_sp++] = _j + 1;                                 \
+                    _stack[_sp++] = _hi;                                    \
+                    _stack[_sp++] = _budget;                                \
+                    _hi = _j - 1;                                           \
+                }                                                           \
+                continue;                                                   \
+            }                                                               \
+            if (_sp == 0) break;                                            \
+            _budget = _stack[--_sp];                                        \
+            _hi = _stack[--_sp];                                            \
+            _lo = _stack[--_sp];                                            \
+        }                                                                   \
+    } while (0)
+
+/* Sorts a vector of values that can be compared with < */
+#define dv_sort(pvec) dv_sort2(pvec, (pvec)->data[INDEX1] < (pvec)->data[INDEX2])
+
+DMEM_API void dv_radix_sort_base(void* data, dv_size_t size, int typesz, bool is_signed);
+
+/* Sorts a vector of signed or unsigned integers of any width using a radix
+ * sort. These are much faster than dv_sort for large vectors.
+ */
+#define dv_sort_int(pvec) dv_radix_sort_base((pvec)->data, (pvec)->size, dv_pdatasize(pvec), true)
+#define dv_sort_uint(pvec) dv_radix_sort_base((pvec)->data, (pvec)->size, dv_pdatasize(pvec), false)
+
+/* ------------------------------------------------------------------------- */
+
+/* Sets 'pidx' to the first index in the sorted vector 'vec' whose value is
+ * not less than 'val' or vec.size if there is none. 'pidx' should point to a
+ * dv_size_t.
+ */
+#define dv_lower_bound(vec, val, pidx) dv_lower_bound2(vec, (vec).data[INDEX] < (val), pidx)
+
+/* Sets 'pidx' to the first index in the sorted vector 'vec' whose value is
+ * greater than 'val' or vec.size if there is none. 'pidx' should point to a
+ * dv_size_t.
+ */
+#define dv_upper_bound(vec, val, pidx) dv_upper_bound2(vec, (val) < (vec).data[INDEX], pidx)
+
+/* Binary searches for the first index for which 'test' is false. 'test'
+ * should use INDEX to reference the index and be true for a leading run of
+ * the vector and false after it. eg test could be
+ * "myvec.data[INDEX].key < key".
+ */
+#define dv_lower_bound2(vec, test, pidx)                                    \
+    do {                                                                    \
+        dv_size_t INDEX, _lo = 0, _n = (vec).size;                          \
+        while (_n > 0) {                                                    \
+            INDEX = _lo + _n / 2;                                           \
+            if (test) {                                                     \
+                _lo = INDEX + 1;                                            \
+                _n -= _n / 2 + 1;                                           \
+            } else {                                                        \
+                _n /= 2;                                                    \
+            }                                                               \
+        }                                                                   \
+        *(pidx) = _lo;                                                      \
+    } while (0)
+
+/* Binary searches for the first index for which 'test' is true. 'test'
+ * should use INDEX to reference the index and be false for a leading run of
+ * the vector and true after it. eg test could be
+ * "key < myvec.data[INDEX].key".
+ */
+#define dv_upper_bound2(vec, test, pidx) dv_lower_bound2(vec, !(test), pidx)
+
+/* ------------------------------------------------------------------------- */
+
+/* Removes consecutive duplicate values from 'pvec'. Used on a sorted vector
+ * this leaves only unique values.
+ */
+#define dv_unique(pvec) dv_unique2(pvec, (pvec)->data[INDEX1] == (pvec)->data[INDEX2])
+
+/* Removes values for which 'equal' resolves to true when compared to the
+ * value before them. 'equal' should use the local variables INDEX1 and
+ * INDEX2 to reference the previous kept value and the current value. eg
+ * equal could be "dv_equals(myvec.data[INDEX1], myvec.data[INDEX2])".
+ */
+#define dv_unique2(pvec, equal)                                             \
+    do {                                                                    \
+        dv_size_t INDEX1, INDEX2, _w = 0;                                   \
+        for (INDEX2 = 0; INDEX2 < (pvec)->size; INDEX2++) {                 \
+            INDEX1 = _w - 1;                                                \
+            if (_w == 0 || !(equal)) {                                      \
+                if (_w != INDEX2) {                                         \
+                    (pvec)->data[_w] = (pvec)->data[INDEX2];                \
+                }                                                           \
+                _w++;                                                       \
+            }                                                               \
+        }                                                                   \
+        if (_w != (pvec)->size) {                                           \
+            dv_resize(pvec, _w);                                            \
+        }                                                                   \
+    } while (0)
+
+/* ------------------------------------------------------------------------- */
+
+DMEM_API int dv_cmp_base(void* adata, dv_size_t asz, void* bdata, dv_size_t bsz);
 
 /* Does a memcmp between the data in VEC1 and VEC2. Evaluates VEC1 and VEC2
  * multiple times. */
@@ -0,0 +1,254 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#pragma once
+
+#include "vector.h"
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/* dmem::vector<T> is an owning C++ wrapper over the same {size, data}
+ * layout and block header as d_vector. It frees its storage when it goes
+ * out of scope, can be moved but not implicitly copied (use clone), and
+ * grows through dv_resize_base so the allocator, arena and pool setup in
+ * vector.h all apply.
+ *
+ * It converts to any d_slice of the same type without copying, and c_vec
+ * gives a d_vector pointer for C functions that append to a vector:
+ *
+ *   dmem::vector<char> s;
+ *   dv_print(s.c_vec<d_vector(char)>(), "%d", 42);
+ *   d_string str = s;
+ *
+ * Values are moved by realloc, so T must be trivially copyable.
+ */
+
+namespace dmem {
+
+template <class T>
+class vector {
+    static_assert(std::is_trivially_copyable<T>::value, "dmem::vector values are moved with realloc");
+
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    vector() : m_size(0), m_data(NULL) {}
+
+    explicit vector(dv_size_t num) : m_size(0), m_data(NULL)
+    { resize(num); }
+
+    vector(std::initializer_list<T> list) : m_size(0), m_data(NULL)
+    { append(list.begin(), (dv_size_t) list.size()); }
+
+    vector(const T* data, dv_size_t num) : m_size(0), m_data(NULL)
+    { append(data, num); }
+
+    vector(vector&& o) noexcept : m_size(o.m_size), m_data(o.m_data)
+    { o.m_size = 0; o.m_data = NULL; }
+
+    vector& operator=(vector&& o) noexcept {
+        if (this != &o) {
+            dv_free_base(m_data);
+            m_size = o.m_size;
+            m_data = o.m_data;
+            o.m_size = 0;
+            o.m_data = NULL;
+        }
+        return *this;
+    }
+
+    vector(const vector&) = delete;
+    vector& operator=(const vector&) = delete;
+
+    ~vector()
+    { dv_free_base(m_data); }
+
+    /* Returns a copy with its own storage */
+    vector clone() const
+    { return vector(m_data, m_size); }
+
+    /* ---------------------------------------------------------------------- */
+
+    dv_size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    T* data() { return m_data; }
+    const T* data() const { return m_data; }
+
+    dv_size_t capacity() const
+    { return (dv_size_t) (dv_reserved_base(m_data) / sizeof(T)); }
+
+    T& operator[](dv_size_t idx) { return m_data[idx]; }
+    const T& operator[](dv_size_t idx) const { return m_data[idx]; }
+
+    T& front() { return m_data[0]; }
+    const T& front() const { return m_data[0]; }
+    T& back() { return m_data[m_size - 1]; }
+    const T& back() const { return m_data[m_size - 1]; }
+
+    iterator begin() { return m_data; }
+    iterator end() { return m_data + m_size; }
+    const_iterator begin() const { return m_data; }
+    const_iterator end() const { return m_data + m_size; }
+    const_iterator cbegin() const { return m_data; }
+    const_iterator cend() const { return m_data + m_size; }
+
+    /* ---------------------------------------------------------------------- */
+
+    /* Makes sure the vector can hold 'num' values without reallocating */
+    void reserve(dv_size_t num) {
+        if (num > m_size) {
+            grow(num);
+        }
+    }
+
+    /* Resizes the vector. New values are value initialised. Like dv_resize
+     * this writes two nul bytes past the end, so a dmem::vector<char> stays
+     * nul terminated. */
+    void resize(dv_size_t num) {
+        dv_size_t old = m_size;
+        grow(num);
+        for (dv_size_t i = old; i < num; i++) {
+            new (&m_data[i]) T();
+        }
+        m_size = num;
+    }
+
+    void resize(dv_size_t num, const T& value) {
+        T v = value;
+        dv_size_t old = m_size;
+        grow(num);
+        for (dv_size_t i = old; i < num; i++) {
+            m_data[i] = v;
+        }
+        m_size = num;
+    }
+
+    void clear() { m_size = 0; }
+
+    /* ---------------------------------------------------------------------- */
+
+    /* Appends a value constructed from 'args'. The value is built before the
+     * vector grows, so args can refer to existing values. */
+    template <class... A>
+    T& emplace_back(A&&... args) {
+        T v(std::forward<A>(args)...);
+        grow(m_size + 1);
+        m_data[m_size] = v;
+        return m_data[m_size++];
+    }
+
+    void push_back(const T& value)
+    { emplace_back(value); }
+
+    void pop_back() { m_size--; }
+
+    /* Appends a copy of 'num' values from 'data', which must not point into
+     * this vector */
+    void append(const T* data, dv_size_t num) {
+        grow(m_size + num);
+        memcpy(m_data + m_size, data, num * sizeof(T));
+        m_size += num;
+    }
+
+    /* Appends a d_vector, d_slice or dmem::vector */
+    template <class S>
+    void append(const S& from)
+    { append(from.data, from.size); }
+
+    void append(const vector& from)
+    { append(from.m_data, from.m_size); }
+
+    /* Removes 'num' values beginning at 'idx' */
+    void erase(dv_size_t idx, dv_size_t num = 1) {
+        memmove(m_data + idx, m_data + idx + num, (m_size - idx - num) * sizeof(T));
+        m_size -= num;
+    }
+
+    void swap(vector& o) {
+        std::swap(m_size, o.m_size);
+        std::swap(m_data, o.m_data);
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    /* Converts to any d_slice with the same value type without copying. The
+     * slice is only valid until the vector is next modified. This does not
+     * convert to a d_vector as both would then own the storage - use
+     * release for that. */
+    template <class S, class = typename std::enable_if<
+        std::is_same<typename S::dv_slice_of, T>::value ||
+        std::is_same<typename S::dv_slice_of, const T>::value>::type>
+    operator S() const {
+        S ret;
+        ret.size = m_size;
+        ret.data = m_data;
+        return ret;
+    }
+
+    /* Returns this vector as a pointer to the matching d_vector type, for C
+     * functions that grow a vector in place. */
+    template <class V>
+    V* c_vec() {
+        static_assert(sizeof(V) == sizeof(vector), "d_vector layout mismatch");
+        static_assert(std::is_same<decltype(V::data), T*>::value, "d_vector value type mismatch");
+        return reinterpret_cast<V*>(this);
+    }
+
+    /* Gives up ownership of the storage, which must then be freed with
+     * dv_free */
+    template <class V>
+    V release() {
+        V ret;
+        ret.size = m_size;
+        ret.data = m_data;
+        m_size = 0;
+        m_data = NULL;
+        return ret;
+    }
+
+    /* Takes ownership of the storage of a d_vector */
+    template <class V>
+    static vector adopt(V v) {
+        vector ret;
+        ret.m_size = v.size;
+        ret.m_data = v.data;
+        return ret;
+    }
+
+private:
+    /* Grows the storage and writes the terminating nuls at 'num' */
+    void grow(dv_size_t num)
+    { m_data = (T*) dv_resize_base(m_data, num * (dv_size_t) sizeof(T)); }
+
+    dv_size_t m_size;
+    T* m_data;
+};
+
+}
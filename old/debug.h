@@ -9,5 +9,8 @@ DMEM_API void dv_hex_dump(d_vector(char)* s, d_string data, bool colors);
  */
 DMEM_API void dv_log(d_string data, const char* format, ...);
 
+/* Logs the vector allocation statistics (see dv_get_stats) to stderr */
+DMEM_API void dv_log_stats(void);
+
 /* ------------------------------------------------------------------------- */
 
@@ -44,8 +44,10 @@ struct dv_dir {
 #endif
 };
 
-DMEM_API int dv_read_file(d_vector(char)* v, d_string path, dv_dir* dir);
-DMEM_API int dv_read(d_vector(char)* v, int fd);
+/* Appends the contents of the file/fd to v. Returns the number of bytes read
+ * or -1 on error. */
+DMEM_API dv_size_t dv_read_file(d_vector(char)* v, d_string path, dv_dir* dir);
+DMEM_API dv_size_t dv_read(d_vector(char)* v, int fd);
 
 DMEM_API int dv_open_dir(d_string path, dv_dir* dir);
 DMEM_API bool dv_read_dir(dv_dir* d, d_string* file, bool* isdir);
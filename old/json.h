@@ -29,6 +29,7 @@
 
 #include "common.h"
 #include "char.h"
+#include "shared.h"
 #include <delegate.h>
 
 enum dj_NodeType {
@@ -57,11 +58,17 @@ struct dj_Node {
     double          number;
 
     dj_Delegate     on_child;
+
+    /* The document passed to dj_parse_shared (empty otherwise). Use
+     * ds_retain(node->source, node->key) to keep a string without copying
+     * it when it points into the document. */
+    d_shared        source;
 };
 
 #define dj_Bind(func, obj) BIND1(dj_Delegate, func, obj, dj_Node**)
 
 DMEM_API int dj_parse(d_string str, dj_Delegate dlg, d_vector(char)* errstr);
+DMEM_API int dj_parse_shared(d_shared str, dj_Delegate dlg, d_vector(char)* errstr);
 
 DMEM_API dj_Parser* dj_new_parser(dj_Delegate dlg);
 DMEM_API int dj_parse_chunk(dj_Parser* p, d_string str);
@@ -28,6 +28,7 @@
 #pragma once
 
 #include "char.h"
+#include "shared.h"
 #include <delegate.h>
 
 typedef struct dx_Node dx_Node;
@@ -49,11 +50,17 @@ struct dx_Node {
     dx_Delegate         on_element;
     dx_Delegate         on_inner_xml;
     dx_Delegate         on_end;
+
+    /* The document passed to dx_parse_shared (empty otherwise). Use
+     * ds_retain(node->source, node->value) to keep a string without copying
+     * it when it points into the document. */
+    d_shared            source;
 };
 
 #define dx_Bind(func, obj) BIND1(dx_Delegate, func, obj, dx_Node**)
 
 DMEM_API bool dx_parse(d_string str, dx_Delegate dlg, d_vector(char)* errstr);
+DMEM_API bool dx_parse_shared(d_shared str, dx_Delegate dlg, d_vector(char)* errstr);
 
 DMEM_API dx_Parser* dx_new_parser(dx_Delegate dlg);
 DMEM_API d_string dx_parse_error(dx_Parser* p);
@@ -0,0 +1,149 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "dmem/char.h"
+
+/* Each benchmark runs a warmup and then splits its iterations into a number
+ * of samples (BENCH_SAMPLES in the environment, 10 by default). It prints
+ * the median time per call with the 10th, 90th and 99th percentiles over the
+ * samples and the throughput if it was given the bytes per call.
+ *
+ * Setting BENCH_JSON in the environment to a file name also appends one
+ * JSON object per benchmark to that file, so that two runs can be compared
+ * line by line, eg:
+ *
+ *   make bench BENCH_JSON=before.json
+ */
+
+#define BENCH_MAX_SAMPLES 1000
+
+static double bench_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static int bench_cmp_double(const void* a, const void* b)
+{
+    double da = *(const double*) a;
+    double db = *(const double*) b;
+    return da < db ? -1 : da > db;
+}
+
+/* Returns the 'pct' percentile of the sorted 'samples' */
+static double bench_percentile(const double* samples, int num, int pct)
+{ return samples[(num - 1) * pct / 100]; }
+
+static void bench_json_string(FILE* f, const char* str)
+{
+    fputc('"', f);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\') {
+            fputc('\\', f);
+        }
+        fputc(*str, f);
+    }
+    fputc('"', f);
+}
+
+/* Runs 'func' 'iterations' times, as well as a warmup, and prints the time
+ * per call. 'bytes' is the number of bytes each call processes or 0 if
+ * throughput is not meaningful.
+ */
+static void bench_run_bytes(const char* name, int iterations, int64_t bytes, void (*func)(void*), void* udata)
+{
+    double samples[BENCH_MAX_SAMPLES];
+    const char* env = getenv("BENCH_SAMPLES");
+    int num = env ? atoi(env) : 10;
+    int per, i, j;
+    double median, rate;
+
+    if (num < 1) {
+        num = 1;
+    } else if (num > BENCH_MAX_SAMPLES) {
+        num = BENCH_MAX_SAMPLES;
+    }
+    if (num > iterations) {
+        num = iterations;
+    }
+    per = iterations / num;
+
+    /* Single shot benchmarks are usually large enough to not need a
+     * warmup and too slow to run twice */
+    for (i = 0; i < iterations / 10; i++) {
+        func(udata);
+    }
+
+    for (i = 0; i < num; i++) {
+        double begin = bench_time();
+        for (j = 0; j < per; j++) {
+            func(udata);
+        }
+        samples[i] = (bench_time() - begin) * 1e9 / per;
+    }
+
+    qsort(samples, num, sizeof(samples[0]), &bench_cmp_double);
+    median = bench_percentile(samples, num, 50);
+    rate = bytes ? (double) bytes * 1e3 / median : 0;
+
+    printf("%-40s %12.1f ns/op  p10 %12.1f  p90 %12.1f  p99 %12.1f",
+            name,
+            median,
+            bench_percentile(samples, num, 10),
+            bench_percentile(samples, num, 90),
+            bench_percentile(samples, num, 99));
+    if (bytes) {
+        printf("  %10.1f MB/s", rate);
+    }
+    printf("\n");
+
+    env = getenv("BENCH_JSON");
+    if (env && *env) {
+        FILE* f = fopen(env, "a");
+        if (f) {
+            fprintf(f, "{\"name\": ");
+            bench_json_string(f, name);
+            fprintf(f, ", \"iterations\": %d, \"samples\": %d, \"median_ns\": %.1f, \"p10_ns\": %.1f, \"p90_ns\": %.1f, \"p99_ns\": %.1f, \"bytes_per_sec\": %.0f}\n",
+                    per * num,
+                    num,
+                    median,
+                    bench_percentile(samples, num, 10),
+                    bench_percentile(samples, num, 90),
+                    bench_percentile(samples, num, 99),
+                    rate * 1e6);
+            fclose(f);
+        }
+    }
+}
+
+/* Runs 'func' 'iterations' times and prints the time per call */
+static void bench_run(const char* name, int iterations, void (*func)(void*), void* udata)
+{ bench_run_bytes(name, iterations, 0, func, udata); }
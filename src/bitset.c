@@ -0,0 +1,404 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#define DMEM_LIBRARY
+#include <dmem/bitset.h>
+#include <assert.h>
+#include "cpu.h"
+
+/* The bulk operations and counts have SSE2 and AVX2 versions on x86 picked
+ * at runtime in the same way as find.c. Counting uses the nibble lookup
+ * table with pshufb and sums bytes with psadbw, so it needs AVX2 and falls
+ * back to the scalar version otherwise.
+ */
+
+typedef void (*bulk_fn)(uint64_t* to, const uint64_t* from, dv_size_t n);
+
+typedef struct bitset_funcs bitset_funcs;
+struct bitset_funcs {
+    bulk_fn and_op;
+    bulk_fn or_op;
+    bulk_fn xor_op;
+    bulk_fn andnot_op;
+    dv_size_t (*count)(const uint64_t* w, dv_size_t n);
+};
+
+static int popcount64(uint64_t x)
+{
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int) ((x * 0x0101010101010101ULL) >> 56);
+}
+
+static int ctz64(uint64_t x)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+#define SCALAR_OP(NAME, EXPR)                                               \
+    static void NAME##_scalar(uint64_t* to,                                 \
+            const uint64_t* from, dv_size_t n)                              \
+    {                                                                       \
+        dv_size_t i;                                                        \
+        for (i = 0; i < n; i++) {                                           \
+            uint64_t a = to[i], b = from[i];                                \
+            to[i] = (EXPR);                                                 \
+        }                                                                   \
+    }
+
+SCALAR_OP(and, a & b)
+SCALAR_OP(or, a | b)
+SCALAR_OP(xor, a ^ b)
+SCALAR_OP(andnot, a & ~b)
+
+static dv_size_t count_scalar(const uint64_t* w, dv_size_t n)
+{
+    dv_size_t i, ret = 0;
+    for (i = 0; i < n; i++) {
+        ret += popcount64(w[i]);
+    }
+    return ret;
+}
+
+static const bitset_funcs g_scalar = {&and_scalar, &or_scalar, &xor_scalar, &andnot_scalar, &count_scalar};
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef DV_HAVE_X86
+
+#define SSE2_OP(NAME, EXPR)                                                 \
+    DV_TARGET_SSE2 static void NAME##_sse2(uint64_t* to,                    \
+            const uint64_t* from, dv_size_t n)                              \
+    {                                                                       \
+        dv_size_t i;                                                        \
+        for (i = 0; i + 2 <= n; i += 2) {                                   \
+            __m128i a = _mm_loadu_si128((const __m128i*) (to + i));         \
+            __m128i b = _mm_loadu_si128((const __m128i*) (from + i));       \
+            _mm_storeu_si128((__m128i*) (to + i), (EXPR));                  \
+        }                                                                   \
+        NAME##_scalar(to + i, from + i, n - i);                             \
+    }
+
+SSE2_OP(and, _mm_and_si128(a, b))
+SSE2_OP(or, _mm_or_si128(a, b))
+SSE2_OP(xor, _mm_xor_si128(a, b))
+SSE2_OP(andnot, _mm_andnot_si128(b, a))
+
+static const bitset_funcs g_sse2 = {&and_sse2, &or_sse2, &xor_sse2, &andnot_sse2, &count_scalar};
+
+/* ------------------------------------------------------------------------- */
+
+#define AVX2_OP(NAME, EXPR)                                                 \
+    DV_TARGET_AVX2 static void NAME##_avx2(uint64_t* to,                    \
+            const uint64_t* from, dv_size_t n)                              \
+    {                                                                       \
+        dv_size_t i;                                                        \
+        for (i = 0; i + 4 <= n; i += 4) {                                   \
+            __m256i a = _mm256_loadu_si256((const __m256i*) (to + i));      \
+            __m256i b = _mm256_loadu_si256((const __m256i*) (from + i));    \
+            _mm256_storeu_si256((__m256i*) (to + i), (EXPR));               \
+        }                                                                   \
+        NAME##_scalar(to + i, from + i, n - i);                             \
+    }
+
+AVX2_OP(and, _mm256_and_si256(a, b))
+AVX2_OP(or, _mm256_or_si256(a, b))
+AVX2_OP(xor, _mm256_xor_si256(a, b))
+AVX2_OP(andnot, _mm256_andnot_si256(b, a))
+
+DV_TARGET_AVX2 static dv_size_t count_avx2(const uint64_t* w, dv_size_t n)
+{
+    const __m256i lookup = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i acc = _mm256_setzero_si256();
+    uint64_t sums[4];
+    dv_size_t i, ret;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (w + i));
+        __m256i lo = _mm256_and_si256(v, low);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+        __m256i c = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(c, _mm256_setzero_si256()));
+    }
+
+    _mm256_storeu_si256((__m256i*) sums, acc);
+    ret = (dv_size_t) (sums[0] + sums[1] + sums[2] + sums[3]);
+
+    for (; i < n; i++) {
+        ret += __builtin_popcountll(w[i]);
+    }
+
+    return ret;
+}
+
+static const bitset_funcs g_avx2 = {&and_avx2, &or_avx2, &xor_avx2, &andnot_avx2, &count_avx2};
+
+#endif
+
+static const bitset_funcs* funcs(void)
+{
+    switch (dvi_simd()) {
+#ifdef DV_HAVE_X86
+    case DV_SIMD_AVX2:
+        return &g_avx2;
+    case DV_SIMD_SSE2:
+        return &g_sse2;
+#endif
+    default:
+        return &g_scalar;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+void db_resize(d_bitset* b, dv_size_t size)
+{
+    dv_size_t oldwords = db_words(b->size);
+    dv_size_t words = db_words(size);
+
+    /* Keep the bits past the end clear */
+    if (size < b->size && size % 64) {
+        b->data[words - 1] &= ((uint64_t) 1 << (size % 64)) - 1;
+    }
+
+    b->data = (uint64_t*) dv_resize_base(b->data, words * sizeof(uint64_t));
+
+    if (words > oldwords) {
+        memset(b->data + oldwords, 0, (words - oldwords) * sizeof(uint64_t));
+    }
+
+    b->size = size;
+}
+
+void db_append(d_bitset* b, bool value)
+{
+    dv_size_t idx = b->size;
+    db_resize(b, idx + 1);
+    if (value) {
+        db_set(b, idx);
+    }
+}
+
+void db_fill(d_bitset* b, bool value)
+{
+    dv_size_t words = db_words(b->size);
+    memset(b->data, value ? 0xFF : 0, words * sizeof(uint64_t));
+    if (value && b->size % 64) {
+        b->data[words - 1] = ((uint64_t) 1 << (b->size % 64)) - 1;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+dv_size_t db_count(const d_bitset* b)
+{ return funcs()->count(b->data, db_words(b->size)); }
+
+dv_size_t db_rank(const d_bitset* b, dv_size_t idx)
+{
+    dv_size_t ret;
+
+    assert(0 <= idx && idx <= b->size);
+    ret = funcs()->count(b->data, idx / 64);
+
+    if (idx % 64) {
+        ret += popcount64(b->data[idx / 64] & (((uint64_t) 1 << (idx % 64)) - 1));
+    }
+
+    return ret;
+}
+
+/* Finds the set bit with rank 'n' counting from word 'i' */
+static dv_size_t select_from(const d_bitset* b, dv_size_t i, dv_size_t n)
+{
+    dv_size_t words = db_words(b->size);
+
+    for (; i < words; i++) {
+        uint64_t w = b->data[i];
+        int c = popcount64(w);
+
+        if (n < c) {
+            /* Drop the lowest set bits until the one we want is lowest */
+            while (n-- > 0) {
+                w &= w - 1;
+            }
+            return i * 64 + ctz64(w);
+        }
+
+        n -= c;
+    }
+
+    return -1;
+}
+
+dv_size_t db_select(const d_bitset* b, dv_size_t n)
+{ return n < 0 ? -1 : select_from(b, 0, n); }
+
+/* ------------------------------------------------------------------------- */
+
+/* data[k] is the number of set bits in the words before word k * 8, with
+ * a final entry for the total */
+#define RANK_WORDS 8
+
+void db_build_rank(d_bitset_rank* r, const d_bitset* b)
+{
+    dv_size_t words = db_words(b->size);
+    dv_size_t blocks = (words + RANK_WORDS - 1) / RANK_WORDS;
+    dv_size_t i, k, sum = 0;
+
+    r->data = (dv_size_t*) dv_resize_base(r->data, (blocks + 1) * sizeof(dv_size_t));
+    r->size = blocks + 1;
+
+    for (k = 0; k < blocks; k++) {
+        dv_size_t end = (k + 1) * RANK_WORDS < words ? (k + 1) * RANK_WORDS : words;
+        r->data[k] = sum;
+        for (i = k * RANK_WORDS; i < end; i++) {
+            sum += popcount64(b->data[i]);
+        }
+    }
+
+    r->data[blocks] = sum;
+}
+
+dv_size_t db_rank_indexed(const d_bitset_rank* r, const d_bitset* b, dv_size_t idx)
+{
+    dv_size_t i, ret;
+
+    assert(0 <= idx && idx <= b->size);
+    assert(r->size == (db_words(b->size) + RANK_WORDS - 1) / RANK_WORDS + 1);
+
+    ret = r->data[idx / 64 / RANK_WORDS];
+
+    for (i = idx / 64 / RANK_WORDS * RANK_WORDS; i < idx / 64; i++) {
+        ret += popcount64(b->data[i]);
+    }
+
+    if (idx % 64) {
+        ret += popcount64(b->data[idx / 64] & (((uint64_t) 1 << (idx % 64)) - 1));
+    }
+
+    return ret;
+}
+
+dv_size_t db_select_indexed(const d_bitset_rank* r, const d_bitset* b, dv_size_t n)
+{
+    dv_size_t lo = 0, hi = r->size - 1;
+
+    assert(r->size == (db_words(b->size) + RANK_WORDS - 1) / RANK_WORDS + 1);
+
+    if (n < 0 || n >= r->data[hi]) {
+        return -1;
+    }
+
+    /* find the last block that starts with n or fewer bits before it */
+    while (hi - lo > 1) {
+        dv_size_t mid = lo + (hi - lo) / 2;
+        if (r->data[mid] <= n) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return select_from(b, lo * RANK_WORDS, n - r->data[lo]);
+}
+
+dv_size_t db_next(const d_bitset* b, dv_size_t idx)
+{
+    dv_size_t i, words = db_words(b->size);
+    uint64_t w;
+
+    if (idx >= b->size) {
+        return -1;
+    }
+
+    i = idx / 64;
+    w = b->data[i] & ~(((uint64_t) 1 << (idx % 64)) - 1);
+
+    for (;;) {
+        if (w) {
+            return i * 64 + ctz64(w);
+        }
+        if (++i == words) {
+            return -1;
+        }
+        w = b->data[i];
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+void db_and(d_bitset* to, const d_bitset* from)
+{
+    dv_size_t words = db_words(to->size);
+    dv_size_t n = db_words(from->size);
+
+    if (n < words) {
+        memset(to->data + n, 0, (words - n) * sizeof(uint64_t));
+    } else {
+        n = words;
+    }
+
+    funcs()->and_op(to->data, from->data, n);
+}
+
+void db_or(d_bitset* to, const d_bitset* from)
+{
+    if (to->size < from->size) {
+        db_resize(to, from->size);
+    }
+
+    funcs()->or_op(to->data, from->data, db_words(from->size));
+}
+
+void db_xor(d_bitset* to, const d_bitset* from)
+{
+    if (to->size < from->size) {
+        db_resize(to, from->size);
+    }
+
+    funcs()->xor_op(to->data, from->data, db_words(from->size));
+}
+
+void db_andnot(d_bitset* to, const d_bitset* from)
+{
+    dv_size_t n = db_words(to->size < from->size ? to->size : from->size);
+    funcs()->andnot_op(to->data, from->data, n);
+}
@@ -0,0 +1,174 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#include <dmem/bitset.h>
+#include "test.h"
+
+int main(void)
+{
+    d_bitset a = DB_INIT;
+    d_bitset b = DB_INIT;
+    dv_size_t i, n, idx;
+    bool ok;
+    int level;
+
+    check(db_next(&a, 0) == -1);
+    check_int(db_count(&a), 0);
+
+    /* set, clear and test */
+    db_resize(&a, 130);
+    check_int(a.size, 130);
+    check_int(db_count(&a), 0);
+    db_set(&a, 0);
+    db_set(&a, 64);
+    db_set(&a, 129);
+    db_assign(&a, 5, true);
+    check(db_test(a, 0));
+    check(db_test(a, 5));
+    check(!db_test(a, 6));
+    check(db_test(a, 129));
+    db_clear(&a, 5);
+    check(!db_test(a, 5));
+    check_int(db_count(&a), 3);
+
+    /* word at a time iteration */
+    check_int(db_next(&a, 0), 0);
+    check_int(db_next(&a, 1), 64);
+    check_int(db_next(&a, 65), 129);
+    check(db_next(&a, 130) == -1);
+
+    /* rank and select */
+    check_int(db_rank(&a, 0), 0);
+    check_int(db_rank(&a, 1), 1);
+    check_int(db_rank(&a, 64), 1);
+    check_int(db_rank(&a, 65), 2);
+    check_int(db_rank(&a, 130), 3);
+    check_int(db_select(&a, 0), 0);
+    check_int(db_select(&a, 1), 64);
+    check_int(db_select(&a, 2), 129);
+    check(db_select(&a, 3) == -1);
+
+    /* the rank index gives the same answers, including over a partial last
+     * block and an empty set */
+    {
+        d_bitset_rank r = DB_RANK_INIT;
+        d_bitset c = DB_INIT;
+        uint64_t seed = 1;
+
+        db_build_rank(&r, &c);
+        check_int(db_rank_indexed(&r, &c, 0), 0);
+        check(db_select_indexed(&r, &c, 0) == -1);
+
+        for (i = 0; i < 5000; i++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            db_append(&c, (seed >> 60) < (uint64_t) (i < 2500 ? 2 : 12));
+        }
+        db_build_rank(&r, &c);
+        n = db_count(&c);
+        ok = true;
+        for (i = 0; i <= c.size; i++) {
+            ok = ok && db_rank_indexed(&r, &c, i) == db_rank(&c, i);
+        }
+        for (i = -1; i <= n; i++) {
+            ok = ok && db_select_indexed(&r, &c, i) == db_select(&c, i);
+        }
+        check(ok);
+        check_int(db_select_indexed(&r, &c, n - 1), db_select(&c, n - 1));
+        check(db_select_indexed(&r, &c, n) == -1);
+
+        db_free_rank(r);
+        db_free(c);
+    }
+
+    /* shrinking clears the bits past the end and growing keeps them clear */
+    db_resize(&a, 100);
+    check_int(db_count(&a), 2);
+    db_resize(&a, 200);
+    check(!db_test(a, 129));
+    check_int(db_count(&a), 2);
+
+    db_fill(&a, true);
+    check_int(db_count(&a), 200);
+    check(db_next(&a, 199) == 199);
+    db_fill(&a, false);
+    check_int(db_count(&a), 0);
+
+    db_append(&a, true);
+    check_int(a.size, 201);
+    check(db_test(a, 200));
+    db_free(a);
+    db_init(&a);
+
+    /* bulk operations at each SIMD level */
+    for (level = DV_SIMD_NONE; level <= DV_SIMD_AVX2; level++) {
+        dv_set_simd(level);
+
+        db_resize(&a, 0);
+        db_resize(&b, 0);
+        for (i = 0; i < 1000; i++) {
+            db_append(&a, i % 3 == 0);
+            db_append(&b, i % 5 == 0);
+        }
+        db_resize(&b, 700);
+
+        check_int(db_count(&a), 334);
+        check_int(db_rank(&a, 999), 333);
+        check_int(db_select(&a, 333), 999);
+
+        db_and(&a, &b);
+        check_int(a.size, 1000);
+        check_int(db_count(&a), 47);
+        ok = true;
+        for (i = 0; i < a.size; i++) {
+            ok = ok && db_test(a, i) == (i < 700 && i % 15 == 0);
+        }
+        check(ok);
+
+        db_or(&b, &a);
+        check_int(b.size, 1000);
+        check_int(db_count(&b), 140);
+
+        db_xor(&a, &b);
+        check_int(db_count(&a), 93);
+        db_andnot(&b, &a);
+        check_int(db_count(&b), 47);
+
+        /* iteration visits each set bit once */
+        n = 0;
+        ok = true;
+        for (idx = db_next(&b, 0); idx >= 0; idx = db_next(&b, idx + 1)) {
+            ok = ok && idx % 15 == 0;
+            n++;
+        }
+        check(ok);
+        check_int(n, 47);
+    }
+    dv_set_simd(DV_SIMD_AVX2);
+
+    db_free(a);
+    db_free(b);
+    return 0;
+}
@@ -25,35 +25,21 @@
  * ----------------------------------------------------------------------------
  */
 
-/* needed for NAN */
-#define _ISOC99_SOURCE
 #define _CRT_SECURE_NO_WARNINGS
 #define DMEM_LIBRARY
 
 #include <dmem/char.h>
 #include <stdio.h>
 #include <stdint.h>
-#include <math.h>
 #include <assert.h>
 #include <limits.h>
+#include "cpu.h"
 
 #ifndef _WIN32
 #include <unistd.h>
 #include <errno.h>
 #endif
 
-#ifdef _MSC_VER
-#include <malloc.h>
-#define alloca _alloca
-#else
-#include <alloca.h>
-#endif
-
-#if defined _MSC_VER && !defined NAN
-#include <ymath.h>
-#define NAN _Nan._Double
-#endif
-
 #ifndef va_copy
 #   ifdef _MSC_VER
 #       define va_copy(d,s) d = s
@@ -80,7 +66,7 @@ int dv_vprint(d_vector(char)* v, const char* format, va_list ap)
         int ret;
 
         char* buf = (char*) v->data + v->size;
-        int bufsz = (int) ((uint64_t*) v->data)[-1] - v->size;
+        dv_size_t bufsz = (dv_size_t) ((uint64_t*) v->data)[-1] - v->size;
 
         va_list aq;
         va_copy(aq, ap);
@@ -127,18 +113,42 @@ int dv_print(d_vector(char)* v, const char* format, ...)
     return dv_vprint(v, format, ap);
 }
 
+void dv_print_stats(d_vector(char)* v)
+{
+    dv_stats st;
+    int i;
+
+    if (!dv_get_stats(&st)) {
+        dv_append(v, C("vector stats not enabled - build with DMEM_STATS\n"));
+        return;
+    }
+
+    dv_print(v, "live vectors   %12lld\n", (long long) st.live);
+    dv_print(v, "reserved bytes %12lld\n", (long long) st.reserved);
+    dv_print(v, "used bytes     %12lld\n", (long long) st.used);
+    dv_print(v, "slack bytes    %12lld\n", (long long) (st.reserved - st.used));
+    dv_print(v, "reallocs       %12lld\n", (long long) st.reallocs);
+    dv_print(v, "bytes copied   %12lld\n", (long long) st.copied);
+
+    for (i = 0; i < DV_STATS_BUCKETS; i++) {
+        if (st.sizes[i]) {
+            dv_print(v, "  >= %-10llu %12lld\n", 1ULL << i, (long long) st.sizes[i]);
+        }
+    }
+}
+
 /* ------------------------------------------------------------------------- */
 
-#define test(map, val) ((map).d[(val) >> 5] & (1 << ((val) & 31)))
-#define set(map, val) (map).d[(val) >> 5] |= 1 << ((val) & 31)
+#define test(map, val) ((map).d[(val) >> 5] & (1U << ((val) & 31)))
+#define set(map, val) (map).d[(val) >> 5] |= 1U << ((val) & 31)
 
 dv_char_mask dv_create_mask(d_string sep)
 {
     dv_char_mask mask = {{0, 0, 0, 0, 0, 0, 0, 0}};
-    int i;
+    dv_size_t i;
 
     for (i = 0; i < sep.size; i++) {
-        set(mask, sep.data[i]);
+        set(mask, (uint8_t) sep.data[i]);
     }
 
     return mask;
@@ -146,69 +156,790 @@ dv_char_mask dv_create_mask(d_string sep)
 
 /* ------------------------------------------------------------------------- */
 
-static const char g_base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+/* Byte set search. The SIMD versions use the pshufb nibble lookup: the
+ * mask is transposed into two 16 byte tables indexed by the low nibble of
+ * each byte, where bit h of an entry is set if the byte with high nibble h
+ * (or h + 8 for the second table) is in the set. A second lookup turns the
+ * high nibble into that bit, so each register of bytes takes three
+ * shuffles. The search functions take the range [p, e) and return the
+ * match or NULL.
+ *
+ * The base64 functions convert as many whole blocks as they can from the
+ * start of the input and return the number of input bytes used, leaving
+ * the rest to the scalar code. The decoder returns -1 on an invalid
+ * character. They follow Wojciech Mula and Daniel Lemire's pshufb based
+ * base64 encoding and decoding. The hex functions work the same way.
+ */
 
-static void ToBase64(uint8_t src[3], char dest[4])
+typedef struct char_funcs char_funcs;
+struct char_funcs {
+    const uint8_t* (*find_set)(const uint8_t* p, const uint8_t* e, const dv_char_mask* mask);
+    const uint8_t* (*find_last_set)(const uint8_t* p, const uint8_t* e, const dv_char_mask* mask);
+    dv_size_t (*base64_encode)(char* dest, const uint8_t* src, dv_size_t n, bool url);
+    dv_size_t (*base64_decode)(uint8_t* dest, const uint8_t* src, dv_size_t n, bool url);
+    dv_size_t (*hex_encode)(char* dest, const uint8_t* src, dv_size_t n);
+    dv_size_t (*hex_decode)(uint8_t* dest, const uint8_t* src, dv_size_t n);
+};
+
+static const uint8_t* find_set_scalar(const uint8_t* p, const uint8_t* e, const dv_char_mask* mask)
 {
-    /* Input:  xxxx xxxx yyyy yyyy zzzz zzzz
-     * Output: 00xx xxxx 00xx yyyy 00yy yyzz 00zz zzzz
-     */
-    dest[0] = ((src[0] >> 2) & 0x3F);
+    for (; p < e; p++) {
+        if (test(*mask, *p)) {
+            return p;
+        }
+    }
+    return NULL;
+}
 
-    dest[1] = ((src[0] << 4) & 0x30)
-            | ((src[1] >> 4) & 0x0F);
+static const uint8_t* find_last_set_scalar(const uint8_t* p, const uint8_t* e, const dv_char_mask* mask)
+{
+    while (e > p) {
+        e--;
+        if (test(*mask, *e)) {
+            return e;
+        }
+    }
+    return NULL;
+}
 
-    dest[2] = ((src[1] << 2) & 0x3C)
-            | ((src[2] >> 6) & 0x03);
+static dv_size_t base64_none(char* dest, const uint8_t* src, dv_size_t n, bool url)
+{
+    (void) dest;
+    (void) src;
+    (void) n;
+    (void) url;
+    return 0;
+}
 
-    dest[3] = (src[2] & 0x3F);
+static dv_size_t unbase64_none(uint8_t* dest, const uint8_t* src, dv_size_t n, bool url)
+{
+    (void) dest;
+    (void) src;
+    (void) n;
+    (void) url;
+    return 0;
+}
 
-    dest[0] = g_base64[(int) dest[0]];
-    dest[1] = g_base64[(int) dest[1]];
-    dest[2] = g_base64[(int) dest[2]];
-    dest[3] = g_base64[(int) dest[3]];
+static dv_size_t hex_none(char* dest, const uint8_t* src, dv_size_t n)
+{
+    (void) dest;
+    (void) src;
+    (void) n;
+    return 0;
 }
 
-void dv_base64_encode(d_vector(char)* v, d_string from)
+static dv_size_t unhex_none(uint8_t* dest, const uint8_t* src, dv_size_t n)
+{
+    (void) dest;
+    (void) src;
+    (void) n;
+    return 0;
+}
+
+static const char_funcs g_scalar = {
+    &find_set_scalar,
+    &find_last_set_scalar,
+    &base64_none,
+    &unbase64_none,
+    &hex_none,
+    &unhex_none,
+};
+
+#ifdef DV_HAVE_X86
+
+/* Split loops search with the same mask over and over on short tokens, so
+ * each thread keeps the tables for the last mask it used. The zeroed
+ * initial value is already correct for the empty mask. */
+static __thread struct {
+    dv_char_mask mask;
+    uint8_t lo[16];
+    uint8_t hi[16];
+} g_set_tables;
+
+/* The mask as 16 bit words is one word per high nibble with a bit per low
+ * nibble. Shifting each low nibble bit up to the sign bit and packing to
+ * bytes collects the bits for all high nibbles in one movemask. */
+DV_TARGET_SSSE3 static void set_tables_ssse3(const dv_char_mask* mask, __m128i* lo, __m128i* hi)
+{
+    __m128i a = _mm_loadu_si128((const __m128i*) &mask->d[0]);
+    __m128i b = _mm_loadu_si128((const __m128i*) &mask->d[4]);
+    __m128i same = _mm_and_si128(
+            _mm_cmpeq_epi8(a, _mm_loadu_si128((const __m128i*) &g_set_tables.mask.d[0])),
+            _mm_cmpeq_epi8(b, _mm_loadu_si128((const __m128i*) &g_set_tables.mask.d[4])));
+
+    if (_mm_movemask_epi8(same) != 0xFFFF) {
+        int i;
+
+        g_set_tables.mask = *mask;
+        for (i = 15; i >= 0; i--) {
+            int m = _mm_movemask_epi8(_mm_packs_epi16(a, b));
+            g_set_tables.lo[i] = (uint8_t) m;
+            g_set_tables.hi[i] = (uint8_t) (m >> 8);
+            a = _mm_slli_epi16(a, 1);
+            b = _mm_slli_epi16(b, 1);
+        }
+    }
+
+    *lo = _mm_loadu_si128((const __m128i*) g_set_tables.lo);
+    *hi = _mm_loadu_si128((const __m128i*) g_set_tables.hi);
+}
+
+/* Returns the movemask of the bytes in 'v' that are in the set */
+DV_TARGET_SSSE3 static int match_ssse3(__m128i v, __m128i lo, __m128i hi)
+{
+    __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m128i row = _mm_or_si128(
+            _mm_shuffle_epi8(lo, v),
+            _mm_shuffle_epi8(hi, _mm_xor_si128(v, _mm_set1_epi8(-128))));
+    __m128i bit = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit));
+}
+
+DV_TARGET_SSSE3 static const uint8_t* find_set_ssse3(const uint8_t* p, const uint8_t* e, const dv_char_mask* mask)
+{
+    __m128i lo, hi;
+    set_tables_ssse3(mask, &lo, &hi);
+
+    for (; e - p >= 16; p += 16) {
+        int m = match_ssse3(_mm_loadu_si128((const __m128i*) p), lo, hi);
+        if (m) {
+            return p + __builtin_ctz(m);
+        }
+    }
+
+    return find_set_scalar(p, e, mask);
+}
+
+DV_TARGET_SSSE3 static const uint8_t* find_last_set_ssse3(const uint8_t* p, const uint8_t* e, const dv_char_mask* mask)
+{
+    __m128i lo, hi;
+    set_tables_ssse3(mask, &lo, &hi);
+
+    for (; e - p >= 16; e -= 16) {
+        int m = match_ssse3(_mm_loadu_si128((const __m128i*) (e - 16)), lo, hi);
+        if (m) {
+            return e - 16 + (31 - __builtin_clz(m));
+        }
+    }
+
+    return find_last_set_scalar(p, e, mask);
+}
+
+/* Spreads 12 bytes out to 16 6 bit values, one per byte */
+DV_TARGET_SSSE3 static __m128i base64_split_ssse3(__m128i in)
+{
+    __m128i t0, t1, t2, t3;
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+    t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+    t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+/* Maps 6 bit values to the alphabet by adding an offset looked up from
+ * the range each value is in */
+DV_TARGET_SSSE3 static __m128i base64_chars_ssse3(__m128i v, bool url)
+{
+    __m128i offsets = _mm_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            url ? '-' - 62 : '+' - 62,
+            url ? '_' - 63 : '/' - 63,
+            'A', 0, 0);
+    __m128i idx = _mm_subs_epu8(v, _mm_set1_epi8(51));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), v);
+    idx = _mm_or_si128(idx, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    return _mm_add_epi8(v, _mm_shuffle_epi8(offsets, idx));
+}
+
+DV_TARGET_SSSE3 static dv_size_t base64_ssse3(char* dest, const uint8_t* src, dv_size_t n, bool url)
+{
+    dv_size_t i;
+
+    /* Each step reads 16 bytes but only uses 12 */
+    for (i = 0; n - i >= 16; i += 12) {
+        __m128i in = _mm_loadu_si128((const __m128i*) (src + i));
+        __m128i out = base64_chars_ssse3(base64_split_ssse3(in), url);
+        _mm_storeu_si128((__m128i*) dest, out);
+        dest += 16;
+    }
+
+    return i;
+}
+
+/* Converts the characters to their 6 bit values and sets *bad to a non
+ * zero mask if any are outside the alphabet. The URL alphabet is first
+ * mapped onto the standard one. */
+DV_TARGET_SSSE3 static __m128i unbase64_values_ssse3(__m128i in, bool url, int* bad)
+{
+    __m128i lut_lo = _mm_setr_epi8(
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    __m128i lut_hi = _mm_setr_epi8(
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    __m128i lut_roll = _mm_setr_epi8(
+            0, 16, 19, 4, -65, -65, -71, -71,
+            0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i mask_2f = _mm_set1_epi8(0x2F);
+    __m128i hi_nibbles, lo_nibbles, lo, hi, eq_2f, roll;
+
+    if (url) {
+        __m128i dash = _mm_cmpeq_epi8(in, _mm_set1_epi8('-'));
+        __m128i under = _mm_cmpeq_epi8(in, _mm_set1_epi8('_'));
+        __m128i std = _mm_or_si128(
+                _mm_cmpeq_epi8(in, _mm_set1_epi8('+')),
+                _mm_cmpeq_epi8(in, _mm_set1_epi8('/')));
+        *bad |= _mm_movemask_epi8(std);
+        in = _mm_add_epi8(in, _mm_and_si128(dash, _mm_set1_epi8('+' - '-')));
+        in = _mm_add_epi8(in, _mm_and_si128(under, _mm_set1_epi8('/' - '_')));
+    }
+
+    hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask_2f);
+    lo_nibbles = _mm_and_si128(in, mask_2f);
+    lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    *bad |= _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) ^ 0xFFFF;
+
+    eq_2f = _mm_cmpeq_epi8(in, mask_2f);
+    roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    return _mm_add_epi8(in, roll);
+}
+
+/* Packs 16 6 bit values into the low 12 bytes */
+DV_TARGET_SSSE3 static __m128i unbase64_pack_ssse3(__m128i v)
+{
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+DV_TARGET_SSSE3 static dv_size_t unbase64_ssse3(uint8_t* dest, const uint8_t* src, dv_size_t n, bool url)
+{
+    dv_size_t i;
+
+    for (i = 0; n - i >= 16; i += 16) {
+        int bad = 0;
+        __m128i v = unbase64_values_ssse3(_mm_loadu_si128((const __m128i*) (src + i)), url, &bad);
+        __m128i out;
+        int32_t last;
+        if (bad) {
+            return -1;
+        }
+        out = unbase64_pack_ssse3(v);
+        last = _mm_cvtsi128_si32(_mm_srli_si128(out, 8));
+        _mm_storel_epi64((__m128i*) dest, out);
+        memcpy(dest + 8, &last, 4);
+        dest += 12;
+    }
+
+    return i;
+}
+
+/* Looks up the digit for each nibble and interleaves the high and low
+ * digits */
+DV_TARGET_SSSE3 static dv_size_t hex_ssse3(char* dest, const uint8_t* src, dv_size_t n)
+{
+    __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    __m128i low4 = _mm_set1_epi8(0x0F);
+    dv_size_t i;
+
+    for (i = 0; n - i >= 16; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*) (src + i));
+        __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(in, 4), low4));
+        __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(in, low4));
+        _mm_storeu_si128((__m128i*) dest, _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*) (dest + 16), _mm_unpackhi_epi8(hi, lo));
+        dest += 32;
+    }
+
+    return i;
+}
+
+/* Converts 16 hex digits to their values and ORs any invalid ones into
+ * *bad. Digits are those where c - '0' is at most 9 and letters where
+ * (c | 0x20) - 'a' is at most 5, as unsigned bytes. */
+DV_TARGET_SSSE3 static __m128i unhex_values_ssse3(__m128i in, int* bad)
+{
+    __m128i d = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+    __m128i a = _mm_sub_epi8(_mm_or_si128(in, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i isd = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    __m128i isa = _mm_cmpeq_epi8(_mm_min_epu8(a, _mm_set1_epi8(5)), a);
+    *bad |= _mm_movemask_epi8(_mm_or_si128(isd, isa)) ^ 0xFFFF;
+    return _mm_or_si128(
+            _mm_and_si128(isd, d),
+            _mm_and_si128(isa, _mm_add_epi8(a, _mm_set1_epi8(10))));
+}
+
+DV_TARGET_SSSE3 static dv_size_t unhex_ssse3(uint8_t* dest, const uint8_t* src, dv_size_t n)
+{
+    /* multiplies the high digit by 16 and adds the low digit */
+    __m128i merge = _mm_set1_epi16(0x0110);
+    dv_size_t i;
+
+    for (i = 0; n - i >= 32; i += 32) {
+        int bad = 0;
+        __m128i a = unhex_values_ssse3(_mm_loadu_si128((const __m128i*) (src + i)), &bad);
+        __m128i b = unhex_values_ssse3(_mm_loadu_si128((const __m128i*) (src + i + 16)), &bad);
+        if (bad) {
+            return -1;
+        }
+        a = _mm_maddubs_epi16(a, merge);
+        b = _mm_maddubs_epi16(b, merge);
+        _mm_storeu_si128((__m128i*) dest, _mm_packus_epi16(a, b));
+        dest += 16;
+    }
+
+    return i;
+}
+
+static const char_funcs g_ssse3 = {
+    &find_set_ssse3,
+    &find_last_set_ssse3,
+    &base64_ssse3,
+    &unbase64_ssse3,
+    &hex_ssse3,
+    &unhex_ssse3,
+};
+
+DV_TARGET_AVX2 static int match_avx2(__m256i v, __m256i lo, __m256i hi)
+{
+    __m256i bits = _mm256_setr_epi8(
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m256i row = _mm256_or_si256(
+            _mm256_shuffle_epi8(lo, v),
+            _mm256_shuffle_epi8(hi, _mm256_xor_si256(v, _mm256_set1_epi8(-128))));
+    __m256i bit = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F)));
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit));
+}
+
+DV_TARGET_AVX2 static const uint8_t* find_set_avx2(const uint8_t* p, const uint8_t* e, const dv_char_mask* mask)
+{
+    __m128i lo, hi;
+    __m256i lo2, hi2;
+    set_tables_ssse3(mask, &lo, &hi);
+    lo2 = _mm256_broadcastsi128_si256(lo);
+    hi2 = _mm256_broadcastsi128_si256(hi);
+
+    for (; e - p >= 32; p += 32) {
+        int m = match_avx2(_mm256_loadu_si256((const __m256i*) p), lo2, hi2);
+        if (m) {
+            return p + __builtin_ctz(m);
+        }
+    }
+
+    return find_set_scalar(p, e, mask);
+}
+
+DV_TARGET_AVX2 static const uint8_t* find_last_set_avx2(const uint8_t* p, const uint8_t* e, const dv_char_mask* mask)
+{
+    __m128i lo, hi;
+    __m256i lo2, hi2;
+    set_tables_ssse3(mask, &lo, &hi);
+    lo2 = _mm256_broadcastsi128_si256(lo);
+    hi2 = _mm256_broadcastsi128_si256(hi);
+
+    for (; e - p >= 32; e -= 32) {
+        int m = match_avx2(_mm256_loadu_si256((const __m256i*) (e - 32)), lo2, hi2);
+        if (m) {
+            return e - 32 + (31 - __builtin_clz(m));
+        }
+    }
+
+    return find_last_set_scalar(p, e, mask);
+}
+
+DV_TARGET_AVX2 static dv_size_t base64_avx2(char* dest, const uint8_t* src, dv_size_t n, bool url)
+{
+    __m256i offsets = _mm256_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            url ? '-' - 62 : '+' - 62,
+            url ? '_' - 63 : '/' - 63,
+            'A', 0, 0,
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            url ? '-' - 62 : '+' - 62,
+            url ? '_' - 63 : '/' - 63,
+            'A', 0, 0);
+    __m256i spread = _mm256_setr_epi8(
+            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    dv_size_t i;
+
+    /* Each lane takes 12 bytes. The second lane's load reads 4 bytes past
+     * the 24 used. */
+    for (i = 0; n - i >= 28; i += 24) {
+        __m256i in = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (src + i))),
+                _mm_loadu_si128((const __m128i*) (src + i + 12)), 1);
+        __m256i t0, t1, t2, t3, v, idx, upper;
+
+        in = _mm256_shuffle_epi8(in, spread);
+        t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00));
+        t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0));
+        t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        v = _mm256_or_si256(t1, t3);
+
+        idx = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), v);
+        idx = _mm256_or_si256(idx, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+        v = _mm256_add_epi8(v, _mm256_shuffle_epi8(offsets, idx));
+
+        _mm256_storeu_si256((__m256i*) dest, v);
+        dest += 32;
+    }
+
+    return i + base64_ssse3(dest, src + i, n - i, url);
+}
+
+DV_TARGET_AVX2 static dv_size_t unbase64_avx2(uint8_t* dest, const uint8_t* src, dv_size_t n, bool url)
+{
+    __m256i lut_lo = _mm256_setr_epi8(
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    __m256i lut_hi = _mm256_setr_epi8(
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    __m256i lut_roll = _mm256_setr_epi8(
+            0, 16, 19, 4, -65, -65, -71, -71,
+            0, 0, 0, 0, 0, 0, 0, 0,
+            0, 16, 19, 4, -65, -65, -71, -71,
+            0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i pack = _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    __m256i mask_2f = _mm256_set1_epi8(0x2F);
+    dv_size_t i;
+    dv_size_t ret;
+
+    for (i = 0; n - i >= 32; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*) (src + i));
+        __m256i bad = _mm256_setzero_si256();
+        __m256i hi_nibbles, lo_nibbles, lo, hi, eq_2f, roll;
+
+        if (url) {
+            __m256i dash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('-'));
+            __m256i under = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('_'));
+            bad = _mm256_or_si256(
+                    _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+')),
+                    _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/')));
+            in = _mm256_add_epi8(in, _mm256_and_si256(dash, _mm256_set1_epi8('+' - '-')));
+            in = _mm256_add_epi8(in, _mm256_and_si256(under, _mm256_set1_epi8('/' - '_')));
+        }
+
+        hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask_2f);
+        lo_nibbles = _mm256_and_si256(in, mask_2f);
+        lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        if (!_mm256_testz_si256(lo, hi) || !_mm256_testz_si256(bad, bad)) {
+            return -1;
+        }
+
+        eq_2f = _mm256_cmpeq_epi8(in, mask_2f);
+        roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        in = _mm256_add_epi8(in, roll);
+
+        in = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+        in = _mm256_madd_epi16(in, _mm256_set1_epi32(0x00011000));
+        in = _mm256_shuffle_epi8(in, pack);
+        in = _mm256_permutevar8x32_epi32(in, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+        _mm_storeu_si128((__m128i*) dest, _mm256_castsi256_si128(in));
+        _mm_storel_epi64((__m128i*) (dest + 16), _mm256_extracti128_si256(in, 1));
+        dest += 24;
+    }
+
+    ret = unbase64_ssse3(dest, src + i, n - i, url);
+    return ret < 0 ? -1 : i + ret;
+}
+
+DV_TARGET_AVX2 static dv_size_t hex_avx2(char* dest, const uint8_t* src, dv_size_t n)
+{
+    __m256i digits = _mm256_setr_epi8(
+            '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+            '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    __m256i low4 = _mm256_set1_epi8(0x0F);
+    dv_size_t i;
+
+    for (i = 0; n - i >= 32; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*) (src + i));
+        __m256i hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(in, 4), low4));
+        __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(in, low4));
+        /* The unpacks work within each lane, so put the lanes back in order */
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i*) dest, _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i*) (dest + 32), _mm256_permute2x128_si256(a, b, 0x31));
+        dest += 64;
+    }
+
+    return i + hex_ssse3(dest, src + i, n - i);
+}
+
+DV_TARGET_AVX2 static __m256i unhex_values_avx2(__m256i in, __m256i* bad)
+{
+    __m256i d = _mm256_sub_epi8(in, _mm256_set1_epi8('0'));
+    __m256i a = _mm256_sub_epi8(_mm256_or_si256(in, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i isd = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+    __m256i isa = _mm256_cmpeq_epi8(_mm256_min_epu8(a, _mm256_set1_epi8(5)), a);
+    *bad = _mm256_or_si256(*bad, _mm256_andnot_si256(_mm256_or_si256(isd, isa), _mm256_set1_epi8(-1)));
+    return _mm256_or_si256(
+            _mm256_and_si256(isd, d),
+            _mm256_and_si256(isa, _mm256_add_epi8(a, _mm256_set1_epi8(10))));
+}
+
+DV_TARGET_AVX2 static dv_size_t unhex_avx2(uint8_t* dest, const uint8_t* src, dv_size_t n)
+{
+    __m256i merge = _mm256_set1_epi16(0x0110);
+    dv_size_t i, ret;
+
+    for (i = 0; n - i >= 64; i += 64) {
+        __m256i bad = _mm256_setzero_si256();
+        __m256i a = unhex_values_avx2(_mm256_loadu_si256((const __m256i*) (src + i)), &bad);
+        __m256i b = unhex_values_avx2(_mm256_loadu_si256((const __m256i*) (src + i + 32)), &bad);
+        if (!_mm256_testz_si256(bad, bad)) {
+            return -1;
+        }
+        a = _mm256_maddubs_epi16(a, merge);
+        b = _mm256_maddubs_epi16(b, merge);
+        /* packus also works within each lane */
+        a = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*) dest, a);
+        dest += 32;
+    }
+
+    ret = unhex_ssse3(dest, src + i, n - i);
+    return ret < 0 ? -1 : i + ret;
+}
+
+static const char_funcs g_avx2 = {
+    &find_set_avx2,
+    &find_last_set_avx2,
+    &base64_avx2,
+    &unbase64_avx2,
+    &hex_avx2,
+    &unhex_avx2,
+};
+
+#endif
+
+static const char_funcs* funcs(void)
 {
-    uint8_t* up = (uint8_t*) from.data;
-    uint8_t* uend = up + from.size;
-    char* dest;
+    switch (dvi_simd()) {
+#ifdef DV_HAVE_X86
+    case DV_SIMD_AVX2:
+        return &g_avx2;
+    case DV_SIMD_SSE2:
+        return dvi_ssse3() ? &g_ssse3 : &g_scalar;
+#endif
+    default:
+        return &g_scalar;
+    }
+}
 
-    dest = dv_append_buffer(v, ((from.size + 2) / 3) * 4);
+/* ------------------------------------------------------------------------- */
+
+static const char g_base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char g_base64url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static void base64_encode(d_vector(char)* v, d_string from, bool url)
+{
+    const char* alphabet = url ? g_base64url : g_base64;
+    const uint8_t* up = (const uint8_t*) from.data;
+    const uint8_t* uend = up + from.size;
+    dv_size_t tail = from.size % 3;
+    dv_size_t outsz = (from.size / 3) * 4 + (tail == 0 ? 0 : url ? tail + 1 : 4);
+    char* dest = dv_append_buffer(v, outsz);
+    dv_size_t done = funcs()->base64_encode(dest, up, from.size, url);
 
-    while (up + 3 <= uend) {
-        ToBase64(up, dest);
+    up += done;
+    dest += done / 3 * 4;
+
+    /* Input:  xxxx xxxx yyyy yyyy zzzz zzzz
+     * Output: 00xx xxxx 00xx yyyy 00yy yyzz 00zz zzzz
+     */
+    while (uend - up >= 3) {
+        dest[0] = alphabet[up[0] >> 2];
+        dest[1] = alphabet[((up[0] << 4) & 0x30) | (up[1] >> 4)];
+        dest[2] = alphabet[((up[1] << 2) & 0x3C) | (up[2] >> 6)];
+        dest[3] = alphabet[up[2] & 0x3F];
         up += 3;
         dest += 4;
     }
 
-    if (up + 2 == uend) {
-        uint8_t pad[3];
-        pad[0] = up[0];
-        pad[1] = up[1];
-        pad[2] = 0;
+    if (tail) {
+        uint8_t b1 = tail == 2 ? up[1] : 0;
+        dest[0] = alphabet[up[0] >> 2];
+        dest[1] = alphabet[((up[0] << 4) & 0x30) | (b1 >> 4)];
+        if (tail == 2) {
+            dest[2] = alphabet[(b1 << 2) & 0x3C];
+        } else if (!url) {
+            dest[2] = '=';
+        }
+        if (!url) {
+            dest[3] = '=';
+        }
+    }
+}
 
-        ToBase64(pad, dest);
-        dest[3] = '=';
+void dv_base64_encode(d_vector(char)* v, d_string from)
+{ base64_encode(v, from, false); }
+
+void dv_base64url_encode(d_vector(char)* v, d_string from)
+{ base64_encode(v, from, true); }
+
+/* Character values for the standard and url alphabets, -1 for characters
+ * outside the alphabet */
+static const int8_t g_unbase64[2][256] = {{
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+}, {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, 63,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+}};
 
-    } else if (up + 1 == uend) {
-        uint8_t pad[3];
-        pad[0] = up[0];
-        pad[1] = 0;
-        pad[2] = 0;
+static int base64_decode(d_vector(char)* v, d_string from, bool url)
+{
+    const int8_t* tbl = g_unbase64[url];
+    const uint8_t* up = (const uint8_t*) from.data;
+    dv_size_t n = from.size;
+    dv_size_t oldsz = v->size;
+    dv_size_t outsz, done, i;
+    uint8_t* dest;
+    int a, b, c, d;
+
+    /* Padding is required for the standard alphabet and optional for the
+     * URL one, but must be complete if present */
+    if (n % 4 == 0 && n && up[n-1] == '=') {
+        n -= (up[n-2] == '=') ? 2 : 1;
+    } else if (n % 4 && !url) {
+        return -1;
+    }
+
+    if (n % 4 == 1) {
+        return -1;
+    }
 
-        ToBase64(pad, dest);
-        dest[2] = '=';
-        dest[3] = '=';
+    outsz = (n / 4) * 3 + (n % 4 ? n % 4 - 1 : 0);
+    dest = (uint8_t*) dv_append_buffer(v, outsz);
+
+    done = funcs()->base64_decode(dest, up, n - n % 4, url);
+    if (done < 0) {
+        goto err;
+    }
+
+    dest += done / 4 * 3;
+
+    for (i = done; i + 4 <= n; i += 4) {
+        a = tbl[up[i]];
+        b = tbl[up[i+1]];
+        c = tbl[up[i+2]];
+        d = tbl[up[i+3]];
+        if ((a | b | c | d) < 0) {
+            goto err;
+        }
+        dest[0] = (uint8_t) ((a << 2) | (b >> 4));
+        dest[1] = (uint8_t) ((b << 4) | (c >> 2));
+        dest[2] = (uint8_t) ((c << 6) | d);
+        dest += 3;
+    }
+
+    /* The unused low bits of the last character must be zero so that each
+     * input has only one encoding */
+    if (n - i == 2) {
+        a = tbl[up[i]];
+        b = tbl[up[i+1]];
+        if ((a | b) < 0 || (b & 0x0F)) {
+            goto err;
+        }
+        dest[0] = (uint8_t) ((a << 2) | (b >> 4));
+    } else if (n - i == 3) {
+        a = tbl[up[i]];
+        b = tbl[up[i+1]];
+        c = tbl[up[i+2]];
+        if ((a | b | c) < 0 || (c & 0x03)) {
+            goto err;
+        }
+        dest[0] = (uint8_t) ((a << 2) | (b >> 4));
+        dest[1] = (uint8_t) ((b << 4) | (c >> 2));
     }
+
+    return 0;
+
+err:
+    dv_resize(v, oldsz);
+    return -1;
 }
 
+int dv_base64_decode(d_vector(char)* v, d_string from)
+{ return base64_decode(v, from, false); }
+
+int dv_base64url_decode(d_vector(char)* v, d_string from)
+{ return base64_decode(v, from, true); }
+
 /* -------------------------------------------------------------------------- */
 
+/* Digit values for hex decoding, -1 for characters that are not hex
+ * digits */
+static const int8_t g_unhex[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
 void dv_hex_decode(d_vector(char)* to, d_string from)
 {
-    int i;
+    const int8_t* tbl = g_unhex;
+    dv_size_t i, done;
     uint8_t* ufrom = (uint8_t*) from.data;
     uint8_t* dest = (uint8_t*) dv_append_buffer(to, from.size / 2);
 
@@ -216,32 +947,20 @@ void dv_hex_decode(d_vector(char)* to, d_string from)
         goto err;
     }
 
-    for (i = 0; i < from.size / 2; ++i) {
-        uint8_t hi = ufrom[2*i];
-        uint8_t lo = ufrom[2*i + 1];
+    done = funcs()->hex_decode(dest, ufrom, from.size);
+    if (done < 0) {
+        goto err;
+    }
 
-        if ('0' <= hi && hi <= '9') {
-            hi = hi - '0';
-        } else if ('a' <= hi && hi <= 'f') {
-            hi = hi - 'a' + 10;
-        } else if ('A' <= hi && hi <= 'F') {
-            hi = hi - 'A' + 10;
-        } else {
-            goto err;
-        }
+    for (i = done / 2; i < from.size / 2; ++i) {
+        int hi = tbl[ufrom[2*i]];
+        int lo = tbl[ufrom[2*i + 1]];
 
-        if ('0' <= lo && lo <= '9') {
-            lo = lo - '0';
-        } else if ('a' <= lo && lo <= 'f') {
-            lo = lo - 'a' + 10;
-        } else if ('A' <= lo && lo <= 'F') {
-            lo = lo - 'A' + 10;
-        } else {
+        if ((hi | lo) < 0) {
             goto err;
         }
 
-
-        *(dest++) = (hi << 4) | lo;
+        dest[i] = (uint8_t) ((hi << 4) | lo);
     }
 
     return;
@@ -254,65 +973,87 @@ err:
 
 void dv_hex_encode(d_vector(char)* to, d_string from)
 {
-    int i;
+    static const char digits[] = "0123456789abcdef";
+    dv_size_t i, done;
     uint8_t* ufrom = (uint8_t*) from.data;
-    uint8_t* dest = (uint8_t*) dv_append_buffer(to, from.size * 2);
+    char* dest = dv_append_buffer(to, from.size * 2);
 
-    for (i = 0; i < from.size; ++i) {
-        uint8_t hi = ufrom[i] >> 4;
-        uint8_t lo = ufrom[i] & 0x0F;
+    done = funcs()->hex_encode(dest, ufrom, from.size);
 
-        if (hi < 10) {
-            hi += '0';
-        } else {
-            hi += 'a' - 10;
-        }
+    for (i = done; i < from.size; ++i) {
+        dest[2*i] = digits[ufrom[i] >> 4];
+        dest[2*i + 1] = digits[ufrom[i] & 0x0F];
+    }
+}
 
-        if (lo < 10) {
-            lo += '0';
-        } else {
-            lo += 'a' - 10;
-        }
+/* -------------------------------------------------------------------------- */
+
+/* The url and quote functions find each run of bytes that can be copied
+ * as is with dv_find_mask and write escapes directly into space reserved
+ * for the worst case. The vector is trimmed to the real size at the end. */
 
-        *(dest++) = hi;
-        *(dest++) = lo;
+static dv_char_mask invert_mask(const dv_char_mask* m)
+{
+    dv_char_mask ret;
+    int i;
+    for (i = 0; i < 8; i++) {
+        ret.d[i] = ~m->d[i];
     }
+    return ret;
 }
 
-/* -------------------------------------------------------------------------- */
+/* Copies bytes from *pfrom up to the next one in 'stop' to dest and
+ * returns the new end of dest */
+static char* copy_run(char* dest, d_string* pfrom, const dv_char_mask* stop)
+{
+    dv_size_t n = dv_find_mask(*pfrom, stop);
+    if (n < 0) {
+        n = pfrom->size;
+    }
+    if (n) {
+        memcpy(dest, pfrom->data, n);
+    }
+    pfrom->data += n;
+    pfrom->size -= n;
+    return dest + n;
+}
 
 void dv_url_decode(d_vector(char)* to, d_string from)
 {
-    const char* b = from.data;
-    const char* e = from.data + from.size;
-    const char* p = b;
+    static const dv_char_mask special = DV_MASK_INIT('%', '+');
+    const int8_t* tbl = g_unhex;
+    dv_size_t start = to->size;
+    char* begin = dv_append_buffer(to, from.size);
+    char* dest = copy_run(begin, &from, &special);
+
+    while (from.size) {
+        if (from.data[0] == '+') {
+            *(dest++) = ' ';
+            from.data++;
+            from.size--;
 
-    while (p < e) {
-        if (*p == '%') {
-            dv_append2(to, b, (int) (p - b));
+        } else {
+            int hi, lo;
 
             /* if we have an incomplete or invalid espace then just ignore it */
-            if (p + 3 > e) {
-                return;
+            if (from.size < 3) {
+                break;
             }
 
-            dv_hex_decode(to, dv_char2(p + 1, 2));
-
-            p += 3;
-            b = p;
-
-        } else if (*p == '+') {
-            dv_append2(to, b, (int) (p - b));
-            dv_append(to, C(" "));
-            p++;
-            b = p;
+            hi = tbl[(uint8_t) from.data[1]];
+            lo = tbl[(uint8_t) from.data[2]];
+            if ((hi | lo) >= 0) {
+                *(dest++) = (char) ((hi << 4) | lo);
+            }
 
-        } else {
-            p++;
+            from.data += 3;
+            from.size -= 3;
         }
+
+        dest = copy_run(dest, &from, &special);
     }
 
-    dv_append2(to, b, (int) (p - b));
+    dv_resize(to, start + (dv_size_t) (dest - begin));
 }
 
 /* -------------------------------------------------------------------------- */
@@ -325,28 +1066,56 @@ dv_char_mask dv_url_mask = {{
     0x00000000, 0x00000000
 }};
 
-void dv_url_encode(d_vector(char)* to, d_string from, dv_char_mask* keep)
-{
-    const unsigned char* b = (unsigned char*) from.data;
-    const unsigned char* e = b + from.size;
-    const unsigned char* p = b;
+static const char g_upper_hex[] = "0123456789ABCDEF";
+
+/* Encoding reserves for the worst case of every byte being escaped. Long
+ * inputs are done in chunks of ESCAPE_CHUNK bytes so that reserve can't
+ * overflow dv_size_t and the excess stays bounded.
+ */
+#define ESCAPE_CHUNK (1 << 24)
 
-    if (keep == NULL) {
-        keep = &dv_url_mask;
+static d_string next_chunk(d_string from)
+{
+    if (from.size > ESCAPE_CHUNK) {
+        from.size = ESCAPE_CHUNK;
     }
+    return from;
+}
 
-    while (p < e) {
-        if (test(*keep, *p)) {
-            p++;
-        } else {
-            dv_append2(to, b, (int) (p - b));
-            dv_print(to, "%%%02X", *(unsigned char*) p);
-            p++;
-            b = p;
-        }
+static char* url_encode_run(char* dest, d_string from, const dv_char_mask* pescape)
+{
+    /* a local copy so that stores through dest can't alias the mask */
+    dv_char_mask escape = *pescape;
+    dest = copy_run(dest, &from, &escape);
+
+    while (from.size) {
+        uint8_t ch = (uint8_t) from.data[0];
+        dest[0] = '%';
+        dest[1] = g_upper_hex[ch >> 4];
+        dest[2] = g_upper_hex[ch & 0x0F];
+        dest += 3;
+        from.data++;
+        from.size--;
+
+        dest = copy_run(dest, &from, &escape);
     }
 
-    dv_append2(to, b, (int) (p - b));
+    return dest;
+}
+
+void dv_url_encode(d_vector(char)* to, d_string from, dv_char_mask* keep)
+{
+    dv_char_mask escape = invert_mask(keep ? keep : &dv_url_mask);
+
+    do {
+        d_string chunk = next_chunk(from);
+        dv_size_t start = to->size;
+        char* begin = dv_append_buffer(to, chunk.size * 3);
+        char* dest = url_encode_run(begin, chunk, &escape);
+        dv_resize(to, start + (dv_size_t) (dest - begin));
+        from.data += chunk.size;
+        from.size -= chunk.size;
+    } while (from.size);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -359,107 +1128,80 @@ dv_char_mask dv_quote_mask = {{
     0xFFFFFFFF, 0xFFFFFFFF
 }};
 
-void dv_quote(d_vector(char)* to, d_string s, dv_char_mask* keep)
+static char* quote_run(char* dest, d_string s, const dv_char_mask* pescape)
 {
-    const unsigned char* b = (unsigned char*) s.data;
-    const unsigned char* e = b + s.size;
-    const unsigned char* p = b;
-
-    if (keep == NULL) {
-        keep = &dv_quote_mask;
-    }
-
-    dv_append1(to, '\"');
-
-    while (p < e) {
-        if (test(*keep, *p)) {
-            p++;
-        } else {
-            dv_append2(to, b, (int) (p - b));
-            switch (*p) {
-            case '\n':
-                dv_append(to, C("\\n"));
-                break;
-            case '\r':
-                dv_append(to, C("\\r"));
-                break;
-            case '\t':
-                dv_append(to, C("\\t"));
-                break;
-            case '\'':
-                dv_append(to, C("\\'"));
-                break;
-            case '\"':
-                dv_append(to, C("\\\""));
-                break;
-            case '\\':
-                dv_append(to, C("\\\\"));
-                break;
-            default:
-                dv_print(to, "\\x%02X", *p);
-                break;
-            }
-            p++;
-            b = p;
+    /* a local copy so that stores through dest can't alias the mask */
+    dv_char_mask escape = *pescape;
+    dest = copy_run(dest, &s, &escape);
+
+    while (s.size) {
+        uint8_t ch = (uint8_t) s.data[0];
+        dest[0] = '\\';
+        switch (ch) {
+        case '\n':
+            dest[1] = 'n';
+            dest += 2;
+            break;
+        case '\r':
+            dest[1] = 'r';
+            dest += 2;
+            break;
+        case '\t':
+            dest[1] = 't';
+            dest += 2;
+            break;
+        case '\'':
+        case '\"':
+        case '\\':
+            dest[1] = (char) ch;
+            dest += 2;
+            break;
+        default:
+            dest[1] = 'x';
+            dest[2] = g_upper_hex[ch >> 4];
+            dest[3] = g_upper_hex[ch & 0x0F];
+            dest += 4;
+            break;
         }
-    }
-
-    dv_append2(to, b, (int) (p - b));
-    dv_append1(to, '\"');
-}
-
-/* -------------------------------------------------------------------------- */
-
-double dv_to_number(d_string value)
-{
-    char* end;
-    double ret;
-    char* buf = (char*) alloca(value.size + 1);
-
-    if (value.size == 0) return NAN;
+        s.data++;
+        s.size--;
 
-    memcpy(buf, value.data, value.size);
-    buf[value.size] = '\0';
-    ret = strtod(buf, &end);
+        dest = copy_run(dest, &s, &escape);
+    }
 
-    if (*end == '\0' || dv_isspace(*end))
-      return ret;
-    else
-      return 0;
+    return dest;
 }
 
-/* ------------------------------------------------------------------------- */
-
-int dv_to_integer(d_string value, int radix, int defvalue)
+void dv_quote(d_vector(char)* to, d_string s, dv_char_mask* keep)
 {
-    char buf[sizeof(int)*CHAR_BIT+2]; /* worst case is binary including the -ve */
-    char* p = (char*) value.data;
-    char* e = p + value.size;
-    int copy, ret;
-
-    while (dv_isspace(*p) && p < e) {
-        p++;
-    }
+    dv_char_mask escape = invert_mask(keep ? keep : &dv_quote_mask);
+    d_string chunk = next_chunk(s);
+    dv_size_t start = to->size;
+    char* begin = dv_append_buffer(to, chunk.size * 4 + 2);
+    char* dest = begin;
 
-    copy = (int) (e - p);
+    *(dest++) = '\"';
 
-    if (copy < (int) sizeof(buf)-1) {
-        copy = (int) sizeof(buf)-1;
-    }
-
-    memcpy(buf, p, copy);
-    buf[copy] = '\0';
+    for (;;) {
+        dest = quote_run(dest, chunk, &escape);
+        s.data += chunk.size;
+        s.size -= chunk.size;
 
-    ret = (int) strtol(buf, &e, radix);
+        if (!s.size) {
+            break;
+        }
 
-    if (*e && !dv_isspace(*e)) {
-        return defvalue;
+        dv_resize(to, start + (dv_size_t) (dest - begin));
+        chunk = next_chunk(s);
+        start = to->size;
+        begin = dest = dv_append_buffer(to, chunk.size * 4 + 1);
     }
 
-    return ret;
+    *(dest++) = '\"';
+    dv_resize(to, start + (dv_size_t) (dest - begin));
 }
 
-/* ------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
 
 d_string dv_strip_whitespace(d_string s)
 {
@@ -469,7 +1211,7 @@ d_string dv_strip_whitespace(d_string s)
         p--;
     }
 
-    s.size = (int) (p - s.data);
+    s.size = (dv_size_t) (p - s.data);
     p = s.data;
     while (p < s.data + s.size && dv_isspace(p[0])) {
         p++;
@@ -492,13 +1234,13 @@ d_string dv_split_line(d_string* from)
     }
 
     ret.data = from->data;
-    ret.size = (int) (p - from->data);
+    ret.size = (dv_size_t) (p - from->data);
 
     if (ret.size && ret.data[ret.size-1] == '\r') {
         ret.size--;
     }
 
-    from->size = (int) (from->data + from->size - (p + 1));
+    from->size = (dv_size_t) (from->data + from->size - (p + 1));
     from->data = p + 1;
     return ret;
 }
@@ -525,7 +1267,7 @@ d_string dv_split_line(d_string* from)
  * Getting Dot-Dot right,''
  * http://plan9.bell-labs.com/sys/doc/lexnames.html
  */
-void dv_join_path(d_vector(char)* v, int off, d_string rel)
+void dv_join_path(d_vector(char)* v, dv_size_t off, d_string rel)
 {
     char *r, *w, *e, *d, *ve;
     bool rooted;
@@ -643,34 +1385,42 @@ int dv_current_directory(d_vector(char)* v)
 
 /* -------------------------------------------------------------------------- */
 
-void *find_chars(d_string from, d_string sep)
+/* Most tokens are short, so check the first bytes one at a time before
+ * paying for the SIMD tables */
+#define SET_PREFIX 16
+
+static void *find_chars(d_string from, const dv_char_mask* mask)
 {
-    dv_char_mask mask = dv_create_mask(sep);
-    uint8_t *u = (uint8_t*) from.data;
-    int i;
+    const uint8_t* p = (const uint8_t*) from.data;
+    const uint8_t* e = p + from.size;
+    const uint8_t* ret;
 
-    for (i = 0; i < from.size; i++) {
-        if (test(mask, u[i])) {
-            return &u[i];
-        }
+    if (from.size <= SET_PREFIX) {
+        return (void*) find_set_scalar(p, e, mask);
     }
 
-    return NULL;
+    ret = find_set_scalar(p, p + SET_PREFIX, mask);
+    if (!ret) {
+        ret = funcs()->find_set(p + SET_PREFIX, e, mask);
+    }
+    return (void*) ret;
 }
 
-static void *find_last_chars(d_string from, d_string sep)
+static void *find_last_chars(d_string from, const dv_char_mask* mask)
 {
-    dv_char_mask mask = dv_create_mask(sep);
-    uint8_t *u = (uint8_t*) from.data;
-    int i;
+    const uint8_t* p = (const uint8_t*) from.data;
+    const uint8_t* e = p + from.size;
+    const uint8_t* ret;
 
-    for (i = from.size - 1; i >= 0; i--) {
-        if (test(mask, u[i])) {
-            return &u[i];
-        }
+    if (from.size <= SET_PREFIX) {
+        return (void*) find_last_set_scalar(p, e, mask);
     }
 
-    return NULL;
+    ret = find_last_set_scalar(e - SET_PREFIX, e, mask);
+    if (!ret) {
+        ret = funcs()->find_last_set(p, e - SET_PREFIX, mask);
+    }
+    return (void*) ret;
 }
 
 static d_string do_split(d_string* from, char *p, int sepsz)
@@ -679,7 +1429,7 @@ static d_string do_split(d_string* from, char *p, int sepsz)
 
     if (p) {
         ret.data = from->data;
-        ret.size = (int) (p - from->data);
+        ret.size = (dv_size_t) (p - from->data);
         from->data = p + sepsz;
         from->size -= ret.size + sepsz;
     } else {
@@ -695,6 +1445,12 @@ d_string dv_split_char(d_string* from, int sep)
 { return do_split(from, (char*) memchr(from->data, sep, from->size), 1); }
 
 d_string dv_split_one_of(d_string* from, d_string sep)
+{
+    dv_char_mask mask = dv_create_mask(sep);
+    return do_split(from, (char*) find_chars(*from, &mask), 1);
+}
+
+d_string dv_split_mask(d_string* from, const dv_char_mask* sep)
 { return do_split(from, (char*) find_chars(*from, sep), 1); }
 
 d_string dv_split_string(d_string* from, d_string sep)
@@ -702,39 +1458,139 @@ d_string dv_split_string(d_string* from, d_string sep)
 
 /* -------------------------------------------------------------------------- */
 
-int dv_find_char(d_string str, int ch)
+dv_size_t dv_find_char(d_string str, int ch)
 {
     char* p = (char*) dv_memchr(str.data, ch, str.size);
     return p ? p - str.data : -1;
 }
 
-int dv_find_one_of(d_string str, d_string chars)
+dv_size_t dv_find_one_of(d_string str, d_string chars)
+{
+    dv_char_mask mask = dv_create_mask(chars);
+    return dv_find_mask(str, &mask);
+}
+
+dv_size_t dv_find_mask(d_string str, const dv_char_mask* chars)
 {
     char* p = (char*) find_chars(str, chars);
     return p ? p - str.data : -1;
 }
 
-int dv_find_last_char(d_string str, int ch)
+dv_size_t dv_find_last_char(d_string str, int ch)
 {
     char* p = (char*) dv_memrchr(str.data, ch, str.size);
     return p ? p - str.data : -1;
 }
 
-int dv_find_last_one_of(d_string str, d_string chars)
+dv_size_t dv_find_last_one_of(d_string str, d_string chars)
+{
+    dv_char_mask mask = dv_create_mask(chars);
+    return dv_find_last_mask(str, &mask);
+}
+
+dv_size_t dv_find_last_mask(d_string str, const dv_char_mask* chars)
 {
     char* p = (char*) find_last_chars(str, chars);
     return p ? p - str.data : -1;
 }
 
-int dv_find_string(d_string str, d_string val)
+dv_size_t dv_find_string(d_string str, d_string val)
 {
     char* p = (char*) dv_memmem(str.data, str.size, val.data, val.size);
     return p ? p - str.data : -1;
 }
 
-int dv_find_last_string(d_string str, d_string val)
+dv_size_t dv_find_last_string(d_string str, d_string val)
 {
     char* p = (char*) dv_memrmem(str.data, str.size, val.data, val.size);
     return p ? p - str.data : -1;
 }
 
+
+/* -------------------------------------------------------------------------- */
+
+static int cmp_suffix(d_string a, d_string b, dv_size_t depth)
+{ return dv_cmp_base((char*) a.data + depth, a.size - depth, (char*) b.data + depth, b.size - depth); }
+
+static void sort_strings(d_string* a, d_string* tmp, dv_size_t n, dv_size_t depth)
+{
+    dv_size_t count[258];
+    dv_size_t i, j;
+
+    for (;;) {
+        if (n < 32) {
+            for (i = 1; i < n; i++) {
+                d_string v = a[i];
+                for (j = i; j > 0 && cmp_suffix(a[j - 1], v, depth) > 0; j--) {
+                    a[j] = a[j - 1];
+                }
+                a[j] = v;
+            }
+            return;
+        }
+
+        /* bucket 0 is for strings that end at depth, 1-256 for the byte
+         * values at depth */
+        memset(count, 0, sizeof(count));
+        for (i = 0; i < n; i++) {
+            int k = a[i].size > depth ? (uint8_t) a[i].data[depth] + 1 : 0;
+            count[k + 1]++;
+        }
+
+        /* all the strings share this byte so move onto the next without
+         * recursing */
+        for (i = 1; i < 258 && count[i] != n; i++) {
+        }
+        if (i < 258) {
+            if (i == 1) {
+                return; /* all of the strings are equal */
+            }
+            depth++;
+            continue;
+        }
+
+        for (i = 1; i < 258; i++) {
+            count[i] += count[i - 1];
+        }
+
+        for (i = 0; i < n; i++) {
+            int k = a[i].size > depth ? (uint8_t) a[i].data[depth] + 1 : 0;
+            tmp[count[k]++] = a[i];
+        }
+
+        memcpy(a, tmp, n * sizeof(d_string));
+
+        /* count[k] is now the end of bucket k. Recurse into all but the
+         * largest bucket and loop on that one, so the smaller buckets are
+         * at most half of n and the depth is at most log2(n). */
+        for (i = 1, j = 1; i < 257; i++) {
+            if (count[i] - count[i - 1] > count[j] - count[j - 1]) {
+                j = i;
+            }
+        }
+
+        for (i = 1; i < 257; i++) {
+            dv_size_t begin = count[i - 1];
+            if (i != j && count[i] - begin > 1) {
+                sort_strings(a + begin, tmp, count[i] - begin, depth + 1);
+            }
+        }
+
+        a += count[j - 1];
+        n = count[j] - count[j - 1];
+        depth++;
+    }
+}
+
+void dv_sort_string_base(d_string* data, dv_size_t size)
+{
+    d_string* tmp;
+
+    if (size < 2) {
+        return;
+    }
+
+    tmp = (d_string*) malloc(size * sizeof(d_string));
+    sort_strings(data, tmp, size, 0);
+    free(tmp);
+}
@@ -0,0 +1,498 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#include "bench.h"
+
+/* Benchmarks the string functions in char.h over 1MB of generated text,
+ * and formatting and parsing numbers both one at a time and as number heavy
+ * lists. The throughput figures are in bytes of input.
+ */
+
+#define TEXT_SIZE (1 << 20)
+
+DVECTOR_INIT(double, double);
+
+struct Text {
+    d_vector(char) text;
+    d_vector(char) out;
+    d_vector(char) encoded;
+    d_vector(double) values;
+    dv_char_mask mask;
+};
+
+static void generate_text(d_vector(char)* out)
+{
+    static const char* words[] = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta"};
+    uint64_t seed = 1;
+    int col = 0;
+
+    while (out->size < TEXT_SIZE) {
+        const char* w;
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        w = words[(seed >> 33) & 7];
+        dv_append(out, dv_char(w));
+        col += (int) strlen(w);
+        if (col > 72) {
+            dv_append1(out, '\n');
+            col = 0;
+        } else {
+            dv_append1(out, ' ');
+        }
+    }
+    dv_resize(out, TEXT_SIZE);
+}
+
+static void find_char(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    if (dv_find_char(t->text, '@') != -1) abort();
+}
+
+static void find_one_of(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    if (dv_find_one_of(t->text, C("@#$")) != -1) abort();
+}
+
+static void find_mask(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    if (dv_find_mask(t->text, &t->mask) != -1) abort();
+}
+
+/* Searches for sets of 1 to 16 bytes that do not appear in the text at each
+ * SIMD level */
+static void bench_find_mask(struct Text* t)
+{
+    static const char* levels[] = {"scalar", "sse2", "avx2"};
+    static const int sizes[] = {1, 2, 4, 8, 16};
+    char name[64];
+    int i, j;
+
+    for (i = DV_SIMD_NONE; i <= DV_SIMD_AVX2; i++) {
+        dv_set_simd(i);
+        for (j = 0; j < (int) (sizeof(sizes) / sizeof(sizes[0])); j++) {
+            t->mask = dv_create_mask(dv_char2("@#$%^&*!~|<>[]{}", sizes[j]));
+            sprintf(name, "find_mask %d chars 1MB (%s)", sizes[j], levels[i]);
+            bench_run_bytes(name, 200, TEXT_SIZE, &find_mask, t);
+        }
+    }
+    dv_set_simd(DV_SIMD_AVX2);
+}
+
+static void find_string(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    if (dv_find_string(t->text, C("omega")) != -1) abort();
+}
+
+static void split_lines(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    d_string rest = t->text;
+    int lines = 0;
+    while (dv_split_line(&rest).data) {
+        lines++;
+    }
+    if (lines == 0) abort();
+}
+
+/* Tokenizing splits many short fields, where rebuilding the mask for each
+ * dv_split_one_of call dominates */
+static void split_words_one_of(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    d_string rest = t->text;
+    int words = 0;
+    while (rest.size) {
+        dv_split_one_of(&rest, C(" \t\r\n"));
+        words++;
+    }
+    if (words == 0) abort();
+}
+
+static void split_words_mask(void* udata)
+{
+    static const dv_char_mask ws = DV_MASK_INIT(' ', '\t', '\r', '\n');
+    struct Text* t = (struct Text*) udata;
+    d_string rest = t->text;
+    int words = 0;
+    while (rest.size) {
+        dv_split_mask(&rest, &ws);
+        words++;
+    }
+    if (words == 0) abort();
+}
+
+static void base64_encode(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    dv_clear(&t->out);
+    dv_base64_encode(&t->out, t->text);
+}
+
+static void base64_decode(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    dv_clear(&t->out);
+    if (dv_base64_decode(&t->out, t->encoded)) abort();
+}
+
+static void bench_base64(struct Text* t)
+{
+    static const char* levels[] = {"scalar", "sse2", "avx2"};
+    char name[64];
+    int i;
+
+    dv_init(&t->encoded);
+    dv_base64_encode(&t->encoded, t->text);
+
+    for (i = DV_SIMD_NONE; i <= DV_SIMD_AVX2; i++) {
+        dv_set_simd(i);
+        sprintf(name, "base64_encode 1MB (%s)", levels[i]);
+        bench_run_bytes(name, 100, TEXT_SIZE, &base64_encode, t);
+        sprintf(name, "base64_decode 1MB (%s)", levels[i]);
+        bench_run_bytes(name, 100, TEXT_SIZE, &base64_decode, t);
+    }
+    dv_set_simd(DV_SIMD_AVX2);
+
+    dv_free(t->encoded);
+}
+
+static void hex_encode(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    dv_clear(&t->out);
+    dv_hex_encode(&t->out, t->text);
+}
+
+static void hex_decode(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    dv_clear(&t->out);
+    dv_hex_decode(&t->out, t->encoded);
+}
+
+static void bench_hex(struct Text* t)
+{
+    static const char* levels[] = {"scalar", "sse2", "avx2"};
+    char name[64];
+    int i;
+
+    dv_init(&t->encoded);
+    dv_hex_encode(&t->encoded, t->text);
+
+    for (i = DV_SIMD_NONE; i <= DV_SIMD_AVX2; i++) {
+        dv_set_simd(i);
+        sprintf(name, "hex_encode 1MB (%s)", levels[i]);
+        bench_run_bytes(name, 100, TEXT_SIZE, &hex_encode, t);
+        sprintf(name, "hex_decode 1MB (%s)", levels[i]);
+        bench_run_bytes(name, 100, TEXT_SIZE, &hex_decode, t);
+    }
+    dv_set_simd(DV_SIMD_AVX2);
+
+    dv_free(t->encoded);
+}
+
+static void url_encode(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    dv_clear(&t->out);
+    dv_url_encode(&t->out, t->text, NULL);
+}
+
+static void quote(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    dv_clear(&t->out);
+    dv_quote(&t->out, t->text, &t->mask);
+}
+
+/* Builds TEXT_SIZE bytes by joining random parts. Query string values are
+ * mostly unreserved characters with the odd space or punctuation and log
+ * lines are mostly plain text with the odd quote, tab or non ASCII name. */
+static void generate_corpus(d_vector(char)* out, const char** parts, int num)
+{
+    uint64_t seed = 1;
+
+    dv_clear(out);
+    while (out->size < TEXT_SIZE) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        dv_append(out, dv_char(parts[(seed >> 33) % num]));
+    }
+    dv_resize(out, TEXT_SIZE);
+}
+
+static const char* g_query_parts[] = {
+    "session_id=8f3a9c2e71d04b6a", "&", "q=", "red-running-shoes", "size_10",
+    "&page=2", "&lang=en-US", "~user", "search.results", "v1.2.3",
+    "redirect=https://example.com/a/b", " ", "&sort=price", "caf\xC3\xA9",
+};
+
+static const char* g_log_parts[] = {
+    "2024-01-01T12:00:00Z ", "INFO ", "WARN ", "GET /index.html HTTP/1.1 ",
+    "200 ", "user=alice ", "latency_ms=12 ", "\"Mozilla/5.0 (X11; Linux)\" ",
+    "it's ", "\t", "connection reset by peer ", "Jos\xC3\xA9 ", "\n",
+};
+
+static void url_decode(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    dv_clear(&t->out);
+    dv_url_decode(&t->out, t->encoded);
+}
+
+static void quote_default(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    dv_clear(&t->out);
+    dv_quote(&t->out, t->encoded, NULL);
+}
+
+static void url_encode_corpus(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    dv_clear(&t->out);
+    dv_url_encode(&t->out, t->encoded, NULL);
+}
+
+static void bench_escapes(struct Text* t)
+{
+    d_vector(char) query = DV_INIT;
+
+    dv_init(&t->encoded);
+
+    generate_corpus(&query, g_query_parts, sizeof(g_query_parts) / sizeof(g_query_parts[0]));
+    dv_set(&t->encoded, query);
+    bench_run_bytes("url_encode 1MB (query)", 100, TEXT_SIZE, &url_encode_corpus, t);
+    dv_clear(&t->encoded);
+    dv_url_encode(&t->encoded, query, NULL);
+    bench_run_bytes("url_decode (query)", 100, t->encoded.size, &url_decode, t);
+
+    generate_corpus(&t->encoded, g_log_parts, sizeof(g_log_parts) / sizeof(g_log_parts[0]));
+    bench_run_bytes("quote 1MB (log)", 100, TEXT_SIZE, &quote_default, t);
+
+    dv_free(query);
+    dv_free(t->encoded);
+}
+
+static void print_int(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    int i;
+    dv_clear(&t->out);
+    for (i = 0; i < 1000; i++) {
+        dv_print(&t->out, "%d,", i * 7919);
+    }
+}
+
+static void print_double(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    int i;
+    dv_clear(&t->out);
+    for (i = 0; i < 1000; i++) {
+        dv_print(&t->out, "%.15g,", i * 1.37);
+    }
+}
+
+static void append_int(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    int i;
+    dv_clear(&t->out);
+    for (i = 0; i < 1000; i++) {
+        dv_append_integer(&t->out, i * 7919);
+        dv_append1(&t->out, ',');
+    }
+}
+
+static void append_double(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    int i;
+    dv_clear(&t->out);
+    for (i = 0; i < 1000; i++) {
+        dv_append_number(&t->out, i * 1.37);
+        dv_append1(&t->out, ',');
+    }
+}
+
+static void parse_numbers(void* udata)
+{
+    static const char* values[] = {"0", "12345", "-3.5", "1e10", "3.14159265358979", "0.1", "987654.321", "-0.000125"};
+    double sum = 0;
+    int i;
+    (void) udata;
+    for (i = 0; i < 1000; i++) {
+        sum += dv_to_number(dv_char(values[i & 7]));
+    }
+    if (sum == 0) abort();
+}
+
+/* Number heavy JSON style input: comma separated prices, coordinates,
+ * ids and doubles printed to full precision */
+static void generate_numbers(d_vector(char)* out)
+{
+    uint64_t seed = 1;
+    int i = 0;
+
+    dv_clear(out);
+    while (out->size < TEXT_SIZE) {
+        uint64_t r;
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        r = seed >> 11;
+        switch (i++ & 3) {
+        case 0:
+            dv_print(out, "%d.%02d,", (int) (r % 10000), (int) (r % 100));
+            break;
+        case 1:
+            dv_print(out, "%.6f,", (double) (r % 360000000) / 1e6 - 180);
+            break;
+        case 2:
+            dv_print(out, "%d,", (int) (r % 100000000));
+            break;
+        default:
+            dv_print(out, "%.17g,", (double) r / (1 << 20) * 1e-3);
+            break;
+        }
+    }
+}
+
+static void parse_number_list(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    d_string s = t->encoded;
+    double sum = 0, d;
+
+    while (s.size) {
+        dv_size_t n = dv_parse_number(s, &d);
+        sum += d;
+        s.data += n + 1;
+        s.size -= n + 1;
+    }
+    if (sum == 0) abort();
+}
+
+static void strtod_number_list(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    const char* p = t->encoded.data;
+    const char* e = p + t->encoded.size;
+    double sum = 0;
+
+    while (p < e) {
+        char* end;
+        sum += strtod(p, &end);
+        p = end + 1;
+    }
+    if (sum == 0) abort();
+}
+
+/* Writes the parsed values back out as a JSON array the way the json
+ * builder does */
+static void append_number_array(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    dv_size_t i;
+
+    dv_set(&t->out, C("["));
+    for (i = 0; i < t->values.size; i++) {
+        if (i) dv_append1(&t->out, ',');
+        dv_append_number(&t->out, t->values.data[i]);
+    }
+    dv_append1(&t->out, ']');
+}
+
+static void print_number_array(void* udata)
+{
+    struct Text* t = (struct Text*) udata;
+    dv_size_t i;
+
+    dv_set(&t->out, C("["));
+    for (i = 0; i < t->values.size; i++) {
+        dv_print(&t->out, i ? ",%.17g" : "%.17g", t->values.data[i]);
+    }
+    dv_append1(&t->out, ']');
+}
+
+static void bench_parse_numbers(struct Text* t)
+{
+    d_string s;
+    double d;
+
+    dv_init(&t->encoded);
+    dv_init(&t->values);
+    generate_numbers(&t->encoded);
+    bench_run_bytes("parse_number list", 20, t->encoded.size, &parse_number_list, t);
+    bench_run_bytes("strtod list", 20, t->encoded.size, &strtod_number_list, t);
+
+    for (s = t->encoded; s.size;) {
+        dv_size_t n = dv_parse_number(s, &d);
+        dv_append1(&t->values, d);
+        s.data += n + 1;
+        s.size -= n + 1;
+    }
+    bench_run_bytes("append_number array", 20, t->encoded.size, &append_number_array, t);
+    bench_run_bytes("print %.17g array", 20, t->encoded.size, &print_number_array, t);
+
+    dv_free(t->values);
+    dv_free(t->encoded);
+}
+
+int main(void)
+{
+    struct Text t;
+
+    dv_init(&t.text);
+    dv_init(&t.out);
+    generate_text(&t.text);
+
+    bench_run_bytes("find_char 1MB", 200, TEXT_SIZE, &find_char, &t);
+    bench_run_bytes("find_one_of 1MB", 200, TEXT_SIZE, &find_one_of, &t);
+    bench_find_mask(&t);
+    bench_run_bytes("find_string 1MB", 200, TEXT_SIZE, &find_string, &t);
+    bench_run_bytes("split_line 1MB", 200, TEXT_SIZE, &split_lines, &t);
+    bench_run_bytes("split words 1MB (one_of)", 100, TEXT_SIZE, &split_words_one_of, &t);
+    bench_run_bytes("split words 1MB (mask)", 100, TEXT_SIZE, &split_words_mask, &t);
+    bench_base64(&t);
+    bench_hex(&t);
+    bench_run_bytes("url_encode 1MB", 100, TEXT_SIZE, &url_encode, &t);
+    t.mask = dv_create_mask(C("abcdefghijklmnopqrstuvwxyz"));
+    bench_run_bytes("quote 1MB", 100, TEXT_SIZE, &quote, &t);
+    bench_escapes(&t);
+    bench_run("print 1000 ints", 1000, &print_int, &t);
+    bench_run("print 1000 doubles", 1000, &print_double, &t);
+    bench_run("append_integer 1000 ints", 1000, &append_int, &t);
+    bench_run("append_number 1000 doubles", 1000, &append_double, &t);
+    bench_run("to_number 1000 values", 1000, &parse_numbers, &t);
+    bench_parse_numbers(&t);
+
+    dv_free(t.text);
+    dv_free(t.out);
+    return 0;
+}
@@ -26,17 +26,25 @@
  */
 
 #include <dmem/char.h>
+#include <ctype.h>
 #include "test.h"
 
+DVECTOR_INIT(string, d_string);
+
 extern dv_char_mask dv_url_mask;
 extern dv_char_mask dv_quote_mask;
 
+static const dv_char_mask g_ws = DV_MASK_INIT(' ', '\t', '\r', '\n');
+static const dv_char_mask g_high = DV_MASK_INIT('\xE9', '\x80', 0);
+
 int main(void)
 {
     d_vector(char) p = DV_INIT;
     d_string s;
     dv_char_mask u;
-    int i;
+    d_vector(string) sv = DV_INIT;
+    char buf[4096];
+    int i, level;
 
     u = dv_create_mask(C("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_~."));
     for (i = 0; i < 8; i++) {
@@ -78,6 +86,15 @@ int main(void)
     dv_url_encode(&p, C("foob"), &u);
     check_string(p, C("foo%62"));
 
+    /* bad escapes are dropped and an incomplete one ends the string */
+    dv_set(&p, C(">"));
+    dv_url_decode(&p, C("a+b%zzc%4a%4"));
+    check_string(p, C(">a bcJ"));
+
+    dv_set(&p, C(">"));
+    dv_quote(&p, C("\\\t\r\xFF"), NULL);
+    check_string(p, C(">\"\\\\\\t\\r\xFF\""));
+
     dv_set(&p, C("stringg with\x00things\n\nto find"));
 
     s = p;
@@ -102,6 +119,36 @@ int main(void)
     check_string(dv_split_one_of(&s, C("\t")), C("things\n\nto find"));
     check_int(s.size, 0);
 
+    /* masks built at compile time match dv_create_mask */
+    u = dv_create_mask(C(" \t\r\n"));
+    for (i = 0; i < 8; i++) {
+        check_int(g_ws.d[i], u.d[i]);
+    }
+    u = dv_create_mask(C("\xE9\x80\x00"));
+    for (i = 0; i < 8; i++) {
+        check_int(g_high.d[i], u.d[i]);
+    }
+    check(dv_in_mask(&g_high, 0xE9));
+    check(dv_in_mask(&g_high, '\xE9'));
+    check(!dv_in_mask(&g_high, 0xE8));
+
+    s = p;
+    u = dv_create_mask(C("\x00h"));
+    check_string(dv_split_mask(&s, &u), C("stringg wit"));
+    check_string(dv_split_mask(&s, &u), C(""));
+    check_string(dv_split_mask(&s, &g_ws), C("things"));
+    check_string(dv_split_mask(&s, &g_ws), C(""));
+    check_string(dv_split_mask(&s, &g_ws), C("to"));
+    check_string(dv_split_mask(&s, &g_ws), C("find"));
+    check_int(s.size, 0);
+
+    check_int(dv_find_mask(p, &g_ws), 7);
+    check_int(dv_find_last_mask(p, &g_ws), 23);
+    check_int(dv_find_mask(p, &g_high), 12);
+    check_int(dv_find_one_of(C("abc\xE9"), C("\xE9")), 3);
+    check_int(dv_find_mask(C("abc"), &g_ws), -1);
+    check_int(dv_find_last_mask(C("abc"), &g_ws), -1);
+
     s = p;
     check_string(dv_split_string(&s, C("things")), C("stringg with\x00"));
     check_int(s.data[0], '\n');
@@ -325,6 +372,283 @@ int main(void)
     TEST("# ", "abc/cde", "bar/..", "# abc/cde");
     TEST("# ", "abc/cde", "bar/foo", "# abc/cde/bar/foo");
 
+    /* sort strings with shared prefixes, high bytes and empty strings */
+    for (i = 0; i < (int) sizeof(buf); i++) {
+        buf[i] = "ab\xFF"[rand() % 3];
+    }
+    for (i = 0; i < 1000; i++) {
+        d_string str = dv_char2(buf + rand() % 4000, rand() % 5);
+        dv_append1(&sv, str);
+    }
+    dv_append1(&sv, C("ab"));
+    dv_append1(&sv, C("ab"));
+    dv_append1(&sv, C("abb"));
+    dv_sort_string(&sv);
+    for (i = 1; i < sv.size; i++) {
+        check(dv_cmp(sv.data[i-1], sv.data[i]) <= 0);
+    }
+    dv_unique2(&sv, dv_equals(sv.data[INDEX1], sv.data[INDEX2]));
+    for (i = 1; i < sv.size; i++) {
+        check(dv_cmp(sv.data[i-1], sv.data[i]) < 0);
+    }
+
+    /* nested prefixes "a", "aa", "aaa", ... of one buffer only recurse
+     * into the smaller buckets */
+    {
+        char* nested = (char*) malloc(5000);
+        bool ok = true;
+        memset(nested, 'a', 5000);
+        dv_clear(&sv);
+        for (i = 5000; i > 0; i--) {
+            dv_append1(&sv, dv_char2(nested, i));
+        }
+        dv_sort_string(&sv);
+        for (i = 0; i < sv.size; i++) {
+            ok = ok && sv.data[i].size == i + 1;
+        }
+        check(ok);
+        free(nested);
+    }
+    dv_free(sv);
+
+    /* set search at each SIMD level against a byte at a time reference */
+    for (i = 0; i < (int) sizeof(buf); i++) {
+        buf[i] = "ab, \t\x80\xFF;"[rand() % 8];
+    }
+    for (level = DV_SIMD_NONE; level <= DV_SIMD_AVX2; level++) {
+        dv_set_simd(level);
+        for (i = 0; i < 2000; i++) {
+            d_string str = dv_char2(buf + rand() % 64, rand() % 200);
+            d_string set = dv_char2(buf + rand() % 4000, 1 + rand() % 3);
+            dv_size_t first = -1, last = -1, j;
+            u = dv_create_mask(set);
+            for (j = 0; j < str.size; j++) {
+                if (dv_in_mask(&u, str.data[j])) {
+                    last = j;
+                    if (first < 0) {
+                        first = j;
+                    }
+                }
+            }
+            check_int(dv_find_mask(str, &u), first);
+            check_int(dv_find_last_mask(str, &u), last);
+            check_int(dv_find_one_of(str, set), first);
+        }
+    }
+    dv_set_simd(DV_SIMD_AVX2);
+
+    /* base64 test vectors from RFC 4648 */
+    for (i = 0; i < 2; i++) {
+        static const char* plain[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+        static const char* std[] = {"", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+        static const char* url[] = {"", "Zg", "Zm8", "Zm9v", "Zm9vYg", "Zm9vYmE", "Zm9vYmFy"};
+        int j;
+        for (j = 0; j < 7; j++) {
+            dv_clear(&p);
+            (i ? dv_base64url_encode : dv_base64_encode)(&p, dv_char(plain[j]));
+            check_string(p, dv_char(i ? url[j] : std[j]));
+            dv_clear(&p);
+            check_int((i ? dv_base64url_decode : dv_base64_decode)(&p, dv_char(i ? url[j] : std[j])), 0);
+            check_string(p, dv_char(plain[j]));
+        }
+    }
+
+    dv_clear(&p);
+    dv_base64_encode(&p, C("\xFB\xFF\xBF"));
+    check_string(p, C("+/+/"));
+    dv_clear(&p);
+    dv_base64url_encode(&p, C("\xFB\xFF\xBF\xFE"));
+    check_string(p, C("-_-__g"));
+
+    /* padding is optional for url and required for standard base64 */
+    dv_set(&p, C("x"));
+    check_int(dv_base64url_decode(&p, C("Zm8=")), 0);
+    check_string(p, C("xfo"));
+    check_int(dv_base64_decode(&p, C("Zm8")), -1);
+    check_int(dv_base64_decode(&p, C("Zg=")), -1);
+    check_int(dv_base64_decode(&p, C("Z===")), -1);
+    check_int(dv_base64_decode(&p, C("Zg=A")), -1);
+    check_int(dv_base64_decode(&p, C("=Zg=")), -1);
+    check_int(dv_base64_decode(&p, C("Zh==")), -1);
+    check_int(dv_base64_decode(&p, C("Zm9=")), -1);
+    check_int(dv_base64_decode(&p, C("Zm9v\n")), -1);
+    check_int(dv_base64_decode(&p, C("Zm 9v")), -1);
+    check_int(dv_base64_decode(&p, C("-_8=")), -1);
+    check_int(dv_base64url_decode(&p, C("+/8")), -1);
+    check_int(dv_base64url_decode(&p, C("Zm9vY")), -1);
+    check_int(dv_base64url_decode(&p, C("Zg=")), -1);
+    check_string(p, C("xfo"));
+
+    /* every SIMD level matches the scalar code on random data, and rejects
+     * a bad character at any position */
+    for (i = 0; i < (int) sizeof(buf); i++) {
+        buf[i] = (char) rand();
+    }
+    for (level = DV_SIMD_NONE; level <= DV_SIMD_AVX2; level++) {
+        d_vector(char) ref = DV_INIT;
+        d_vector(char) dec = DV_INIT;
+        for (i = 0; i < 300; i++) {
+            d_string str = dv_char2(buf + rand() % 64, i);
+            int url = i & 1;
+            dv_size_t bad;
+
+            dv_set_simd(DV_SIMD_NONE);
+            dv_clear(&ref);
+            (url ? dv_base64url_encode : dv_base64_encode)(&ref, str);
+
+            dv_set_simd(level);
+            dv_clear(&p);
+            (url ? dv_base64url_encode : dv_base64_encode)(&p, str);
+            check_string(p, ref);
+
+            dv_clear(&dec);
+            check_int((url ? dv_base64url_decode : dv_base64_decode)(&dec, p), 0);
+            check_string(dec, str);
+
+            if (p.size) {
+                bad = rand() % p.size;
+                p.data[bad] = "=\n\x80*+/-_"[rand() % 8];
+                if ((!url && (p.data[bad] == '+' || p.data[bad] == '/'))
+                        || (url && (p.data[bad] == '-' || p.data[bad] == '_'))) {
+                    continue;
+                }
+                if (p.data[bad] == '=' && bad >= p.size - 2) {
+                    continue;
+                }
+                dv_clear(&dec);
+                check_int((url ? dv_base64url_decode : dv_base64_decode)(&dec, p), -1);
+                check_int(dec.size, 0);
+            }
+        }
+        dv_free(ref);
+        dv_free(dec);
+    }
+
+    /* url encoding and quoting of long strings with runs of escapes
+     * round trips at every SIMD level */
+    for (i = 0; i < (int) sizeof(buf); i++) {
+        buf[i] = (rand() % 8) ? "abcxyz019-_.~"[rand() % 13] : (char) rand();
+    }
+    for (level = DV_SIMD_NONE; level <= DV_SIMD_AVX2; level++) {
+        d_vector(char) ref = DV_INIT;
+        d_vector(char) dec = DV_INIT;
+        dv_set_simd(level);
+        for (i = 0; i < 300; i++) {
+            d_string str = dv_char2(buf + rand() % 64, i * 3);
+            dv_size_t j;
+
+            dv_clear(&p);
+            dv_url_encode(&p, str, NULL);
+            dv_clear(&dec);
+            dv_url_decode(&dec, p);
+            check_string(dec, str);
+
+            dv_clear(&ref);
+            dv_append1(&ref, '\"');
+            for (j = 0; j < str.size; j++) {
+                uint8_t ch = (uint8_t) str.data[j];
+                if (dv_in_mask(&dv_quote_mask, ch)) {
+                    dv_append1(&ref, (char) ch);
+                } else if (ch == '\'' || ch == '\"' || ch == '\\') {
+                    dv_print(&ref, "\\%c", ch);
+                } else if (ch != '\n' && ch != '\r' && ch != '\t') {
+                    dv_print(&ref, "\\x%02X", ch);
+                } else {
+                    dv_print(&ref, "\\%c", ch == '\n' ? 'n' : ch == '\r' ? 'r' : 't');
+                }
+            }
+            dv_append1(&ref, '\"');
+
+            dv_clear(&p);
+            dv_quote(&p, str, NULL);
+            check_string(p, ref);
+        }
+        dv_free(ref);
+        dv_free(dec);
+    }
+
+    /* inputs longer than the 16MB escape chunk, with escapes either side of
+     * the chunk boundary */
+    {
+        d_vector(char) big = DV_INIT;
+        d_vector(char) ref = DV_INIT;
+        d_vector(char) dec = DV_INIT;
+        dv_size_t j, n = (1 << 24) + 1000;
+
+        dv_resize(&big, n);
+        for (j = 0; j < n; j++) {
+            big.data[j] = (j % 997 == 0 || (j >> 1) == (1 << 23) - 1) ? '\n' : 'a';
+        }
+
+        dv_clear(&p);
+        dv_url_encode(&p, big, NULL);
+        dv_url_decode(&dec, p);
+        check(dv_equals(dec, big));
+
+        dv_reserve(&ref, n * 2 + 2);
+        dv_append1(&ref, '\"');
+        for (j = 0; j < n; j++) {
+            if (big.data[j] == '\n') {
+                dv_append(&ref, C("\\n"));
+            } else {
+                dv_append1(&ref, 'a');
+            }
+        }
+        dv_append1(&ref, '\"');
+
+        dv_clear(&p);
+        dv_quote(&p, big, NULL);
+        check(dv_equals(p, ref));
+
+        dv_clear(&p);
+        dv_free(big);
+        dv_free(ref);
+        dv_free(dec);
+    }
+    for (i = 0; i < (int) sizeof(buf); i++) {
+        buf[i] = (char) rand();
+    }
+
+    /* likewise for hex, with mixed case input and bad characters just
+     * outside the digit and letter ranges */
+    for (level = DV_SIMD_NONE; level <= DV_SIMD_AVX2; level++) {
+        d_vector(char) ref = DV_INIT;
+        d_vector(char) dec = DV_INIT;
+        for (i = 0; i < 300; i++) {
+            d_string str = dv_char2(buf + rand() % 64, i);
+            dv_size_t j;
+
+            dv_set_simd(DV_SIMD_NONE);
+            dv_clear(&ref);
+            dv_hex_encode(&ref, str);
+
+            dv_set_simd(level);
+            dv_clear(&p);
+            dv_hex_encode(&p, str);
+            check_string(p, ref);
+
+            for (j = 0; j < p.size; j++) {
+                if (rand() & 1) {
+                    p.data[j] = (char) toupper(p.data[j]);
+                }
+            }
+
+            dv_set(&dec, C("x"));
+            dv_hex_decode(&dec, p);
+            check_int(dec.size, str.size + 1);
+            check(dv_ends_with(dec, str));
+
+            if (p.size) {
+                p.data[rand() % p.size] = "/:@G`g \x80"[rand() % 8];
+                dv_set(&dec, C("x"));
+                dv_hex_decode(&dec, p);
+                check_string(dec, C("x"));
+            }
+        }
+        dv_free(ref);
+        dv_free(dec);
+    }
+    dv_set_simd(DV_SIMD_AVX2);
 
     return 0;
 }
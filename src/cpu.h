@@ -0,0 +1,52 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+/* Internal runtime CPU feature detection for the SIMD paths. DV_HAVE_X86
+ * is defined when the compiler can build SSE2 and AVX2 functions with the
+ * target attribute, independent of the flags the library is built with. The
+ * AVX2 level also includes popcnt, and some SSE2 level paths check for
+ * SSSE3 on top.
+ * Those functions must only be called when dvi_simd returns a high enough
+ * level.
+ */
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define DV_HAVE_X86
+#define DV_TARGET_SSE2 __attribute__((target("sse2")))
+#define DV_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define DV_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#include <immintrin.h>
+#endif
+
+/* Returns the highest DV_SIMD_* level supported by the CPU and allowed by
+ * dv_set_simd */
+int dvi_simd(void);
+
+/* Returns whether the SSE2 level can also use SSSE3 (pshufb) */
+int dvi_ssse3(void);
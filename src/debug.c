@@ -273,3 +273,10 @@ void dv_log(d_string data, const char* format, ...)
     }
 }
 
+void dv_log_stats(void)
+{
+    d_vector(char) s = DV_INIT;
+    dv_print_stats(&s);
+    dv_log(dv_char(""), "%.*s", DV_PRI(s));
+    dv_free(s);
+}
@@ -52,23 +52,38 @@
 
 /* -------------------------------------------------------------------------- */
 
-int dv_read(d_vector(char)* v, int fd)
+dv_size_t dv_read(d_vector(char)* v, int fd)
 {
-    int begin = v->size;
+    dv_size_t begin = v->size;
     struct stat st;
 
     if (fstat(fd, &st)) {
         return -1;
     }
 
-    if (st.st_size + begin > INT_MAX) {
-        st.st_size = INT_MAX - begin;
+    if (st.st_size > DV_SIZE_MAX - begin) {
+        st.st_size = DV_SIZE_MAX - begin;
     }
 
-    dv_reserve(v, begin + st.st_size);
+    dv_reserve(v, begin + (dv_size_t) st.st_size);
 
-    for (;;) {
-        int r = read(fd, v->data + v->size, dv_reserved(*v) - v->size);
+    /* stop once the vector is full rather than overflow dv_size_t */
+    while (v->size < DV_SIZE_MAX) {
+        size_t avail;
+        ssize_t r;
+
+        /* pipes and the like don't report a size so grow as we go */
+        if (dv_reserved(*v) <= (size_t) v->size) {
+            dv_reserve(v, v->size + 1);
+        }
+
+        /* the reserved size is rounded up and may go past DV_SIZE_MAX */
+        avail = dv_reserved(*v) - (size_t) v->size;
+        if (avail > (size_t) (DV_SIZE_MAX - v->size)) {
+            avail = (size_t) (DV_SIZE_MAX - v->size);
+        }
+
+        r = read(fd, v->data + v->size, avail);
 
         if (r < 0 && errno == EINTR) {
             r = 0;
@@ -79,7 +94,7 @@ int dv_read(d_vector(char)* v, int fd)
             break;
         }
 
-        dv_resize(v, v->size + r);
+        dv_resize(v, v->size + (dv_size_t) r);
     }
 
     return v->size - begin;
@@ -87,10 +102,11 @@ int dv_read(d_vector(char)* v, int fd)
 
 /* -------------------------------------------------------------------------- */
 
-int dv_read_file(d_vector(char)* v, d_string path, dv_dir* dir)
+dv_size_t dv_read_file(d_vector(char)* v, d_string path, dv_dir* dir)
 {
-    int begin = v->size;
-    int fd, ret;
+    dv_size_t begin = v->size;
+    dv_size_t ret;
+    int fd;
 
     /* Append the path to the vector to ensure its null terminated */
 
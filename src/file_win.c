@@ -11,17 +11,19 @@ struct dv_dir_i {
     DIR* dir;
 #endif
 };
-int dv_read(d_vector(char)* v, int fd)
+dv_size_t dv_read(d_vector(char)* v, int fd)
 {
-    int size, begin = v->size;
+    dv_size_t size, begin = v->size;
     DWORD hsz, lsz;
+    uint64_t fsz;
 
     lsz = GetFileSize(fd, &hsz);
+    fsz = ((uint64_t) hsz << 32) | (uint64_t) lsz;
 
-    if (hsz > 0 || lsz > INT_MAX/2) {
-        size = INT_MAX/2;
+    if (fsz > (uint64_t) (DV_SIZE_MAX - begin)) {
+        size = DV_SIZE_MAX - begin;
     } else {
-        size = (int) lsz;
+        size = (dv_size_t) fsz;
     }
 
     dv_reserve(v, begin + size);
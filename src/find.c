@@ -0,0 +1,467 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#define DMEM_LIBRARY
+#include <dmem/vector.h>
+#include <assert.h>
+#include "cpu.h"
+
+/* Equality find, count and find any of over vectors of 8, 16, 32 and 64 bit
+ * integers. There are SSE2 and AVX2 versions on x86 picked at runtime,
+ * which compare a whole register of values at a time and then use the byte
+ * mask of the comparison. The scalar versions handle other platforms and
+ * the tails.
+ */
+
+typedef struct find_funcs find_funcs;
+struct find_funcs {
+    dv_size_t (*find)(const void* data, dv_size_t size, int typesz, uint64_t val);
+    dv_size_t (*count)(const void* data, dv_size_t size, int typesz, uint64_t val);
+    dv_size_t (*find_any)(const void* data, dv_size_t size, int typesz, const uint64_t* vals, dv_size_t num);
+};
+
+/* ------------------------------------------------------------------------- */
+
+static uint64_t load(const uint8_t* p, int typesz)
+{
+    switch (typesz) {
+    case 1:
+        return *p;
+    case 2:
+        {
+            uint16_t v;
+            memcpy(&v, p, 2);
+            return v;
+        }
+    case 4:
+        {
+            uint32_t v;
+            memcpy(&v, p, 4);
+            return v;
+        }
+    default:
+        {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            return v;
+        }
+    }
+}
+
+static uint64_t mask_value(uint64_t val, int typesz)
+{ return typesz == 8 ? val : val & ((UINT64_C(1) << (typesz * 8)) - 1); }
+
+/* The scalar loops are specialised per width so that the compiler can
+ * unroll and, for count, vectorise them itself */
+#define SCALAR_FIND(TYPE)                                                   \
+    {                                                                       \
+        const TYPE* p = (const TYPE*) data;                                 \
+        for (i = 0; i < size; i++) {                                        \
+            if (p[i] == (TYPE) val) {                                       \
+                return i;                                                   \
+            }                                                               \
+        }                                                                   \
+        return -1;                                                          \
+    }
+
+#define SCALAR_COUNT(TYPE)                                                  \
+    {                                                                       \
+        const TYPE* p = (const TYPE*) data;                                 \
+        for (i = 0; i < size; i++) {                                        \
+            ret += p[i] == (TYPE) val;                                      \
+        }                                                                   \
+        return ret;                                                         \
+    }
+
+static dv_size_t find_scalar(const void* data, dv_size_t size, int typesz, uint64_t val)
+{
+    dv_size_t i;
+    switch (typesz) {
+    case 1: SCALAR_FIND(uint8_t)
+    case 2: SCALAR_FIND(uint16_t)
+    case 4: SCALAR_FIND(uint32_t)
+    default: SCALAR_FIND(uint64_t)
+    }
+}
+
+static dv_size_t count_scalar(const void* data, dv_size_t size, int typesz, uint64_t val)
+{
+    dv_size_t i, ret = 0;
+    switch (typesz) {
+    case 1: SCALAR_COUNT(uint8_t)
+    case 2: SCALAR_COUNT(uint16_t)
+    case 4: SCALAR_COUNT(uint32_t)
+    default: SCALAR_COUNT(uint64_t)
+    }
+}
+
+static dv_size_t find_any_scalar(const void* data, dv_size_t size, int typesz, const uint64_t* vals, dv_size_t num)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    dv_size_t i, j;
+    for (i = 0; i < size; i++) {
+        uint64_t v = load(p + i * typesz, typesz);
+        for (j = 0; j < num; j++) {
+            if (v == vals[j]) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef DV_HAVE_X86
+
+/* SSE2 has no 64 bit compare, so compare the 32 bit halves and then combine
+ * each half with its neighbour */
+DV_TARGET_SSE2 static __m128i cmpeq_sse2(__m128i a, __m128i b, int typesz)
+{
+    __m128i c;
+    switch (typesz) {
+    case 1:
+        return _mm_cmpeq_epi8(a, b);
+    case 2:
+        return _mm_cmpeq_epi16(a, b);
+    case 4:
+        return _mm_cmpeq_epi32(a, b);
+    default:
+        c = _mm_cmpeq_epi32(a, b);
+        return _mm_and_si128(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+}
+
+DV_TARGET_SSE2 static __m128i set1_sse2(uint64_t val, int typesz)
+{
+    switch (typesz) {
+    case 1:
+        return _mm_set1_epi8((char) val);
+    case 2:
+        return _mm_set1_epi16((short) val);
+    case 4:
+        return _mm_set1_epi32((int) val);
+    default:
+        return _mm_set1_epi64x((long long) val);
+    }
+}
+
+DV_TARGET_SSE2 static dv_size_t find_sse2(const void* data, dv_size_t size, int typesz, uint64_t val)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    __m128i v = set1_sse2(val, typesz);
+    dv_size_t i, n = size - size % (16 / typesz);
+    dv_size_t ret;
+
+    for (i = 0; i < n; i += 16 / typesz) {
+        __m128i a = _mm_loadu_si128((const __m128i*) (p + i * typesz));
+        int mask = _mm_movemask_epi8(cmpeq_sse2(a, v, typesz));
+        if (mask) {
+            return i + __builtin_ctz(mask) / typesz;
+        }
+    }
+
+    ret = find_scalar(p + n * typesz, size - n, typesz, val);
+    return ret >= 0 ? n + ret : -1;
+}
+
+DV_TARGET_SSE2 static __m128i sub_sse2(__m128i a, __m128i b, int typesz)
+{
+    switch (typesz) {
+    case 1:
+        return _mm_sub_epi8(a, b);
+    case 2:
+        return _mm_sub_epi16(a, b);
+    case 4:
+        return _mm_sub_epi32(a, b);
+    default:
+        return _mm_sub_epi64(a, b);
+    }
+}
+
+/* SSE2 CPUs do not necessarily have popcnt, so instead count matches per
+ * lane by subtracting the all ones compare results. The lanes are summed
+ * every 255 blocks so that 8 bit lanes do not overflow.
+ */
+DV_TARGET_SSE2 static dv_size_t count_sse2(const void* data, dv_size_t size, int typesz, uint64_t val)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    __m128i v = set1_sse2(val, typesz);
+    dv_size_t i, j, end, step = 16 / typesz;
+    dv_size_t n = size - size % step;
+    dv_size_t ret = 0;
+
+    for (i = 0; i < n;) {
+        __m128i acc = _mm_setzero_si128();
+        uint8_t lanes[16];
+
+        end = i + 255 * step;
+        if (end > n) {
+            end = n;
+        }
+
+        for (; i < end; i += step) {
+            __m128i a = _mm_loadu_si128((const __m128i*) (p + i * typesz));
+            acc = sub_sse2(acc, cmpeq_sse2(a, v, typesz), typesz);
+        }
+
+        _mm_storeu_si128((__m128i*) lanes, acc);
+        for (j = 0; j < 16; j += typesz) {
+            ret += (dv_size_t) load(lanes + j, typesz);
+        }
+    }
+
+    return ret + count_scalar(p + n * typesz, size - n, typesz, val);
+}
+
+DV_TARGET_SSE2 static dv_size_t find_any_sse2(const void* data, dv_size_t size, int typesz, const uint64_t* vals, dv_size_t num)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    dv_size_t i, j, n = size - size % (16 / typesz);
+    dv_size_t ret;
+
+    for (i = 0; i < n; i += 16 / typesz) {
+        __m128i a = _mm_loadu_si128((const __m128i*) (p + i * typesz));
+        __m128i c = _mm_setzero_si128();
+        int mask;
+        for (j = 0; j < num; j++) {
+            c = _mm_or_si128(c, cmpeq_sse2(a, set1_sse2(vals[j], typesz), typesz));
+        }
+        mask = _mm_movemask_epi8(c);
+        if (mask) {
+            return i + __builtin_ctz(mask) / typesz;
+        }
+    }
+
+    ret = find_any_scalar(p + n * typesz, size - n, typesz, vals, num);
+    return ret >= 0 ? n + ret : -1;
+}
+
+static const find_funcs g_sse2 = {&find_sse2, &count_sse2, &find_any_sse2};
+
+/* ------------------------------------------------------------------------- */
+
+DV_TARGET_AVX2 static __m256i cmpeq_avx2(__m256i a, __m256i b, int typesz)
+{
+    switch (typesz) {
+    case 1:
+        return _mm256_cmpeq_epi8(a, b);
+    case 2:
+        return _mm256_cmpeq_epi16(a, b);
+    case 4:
+        return _mm256_cmpeq_epi32(a, b);
+    default:
+        return _mm256_cmpeq_epi64(a, b);
+    }
+}
+
+DV_TARGET_AVX2 static __m256i set1_avx2(uint64_t val, int typesz)
+{
+    switch (typesz) {
+    case 1:
+        return _mm256_set1_epi8((char) val);
+    case 2:
+        return _mm256_set1_epi16((short) val);
+    case 4:
+        return _mm256_set1_epi32((int) val);
+    default:
+        return _mm256_set1_epi64x((long long) val);
+    }
+}
+
+DV_TARGET_AVX2 static dv_size_t find_avx2(const void* data, dv_size_t size, int typesz, uint64_t val)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    __m256i v = set1_avx2(val, typesz);
+    dv_size_t i, n = size - size % (32 / typesz);
+    dv_size_t ret;
+
+    for (i = 0; i < n; i += 32 / typesz) {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (p + i * typesz));
+        unsigned mask = (unsigned) _mm256_movemask_epi8(cmpeq_avx2(a, v, typesz));
+        if (mask) {
+            return i + __builtin_ctz(mask) / typesz;
+        }
+    }
+
+    ret = find_scalar(p + n * typesz, size - n, typesz, val);
+    return ret >= 0 ? n + ret : -1;
+}
+
+DV_TARGET_AVX2 static dv_size_t count_avx2(const void* data, dv_size_t size, int typesz, uint64_t val)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    __m256i v = set1_avx2(val, typesz);
+    dv_size_t i, n = size - size % (32 / typesz);
+    dv_size_t bytes = 0;
+
+    for (i = 0; i < n; i += 32 / typesz) {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (p + i * typesz));
+        bytes += __builtin_popcount((unsigned) _mm256_movemask_epi8(cmpeq_avx2(a, v, typesz)));
+    }
+
+    return bytes / typesz + count_scalar(p + n * typesz, size - n, typesz, val);
+}
+
+DV_TARGET_AVX2 static dv_size_t find_any_avx2(const void* data, dv_size_t size, int typesz, const uint64_t* vals, dv_size_t num)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    dv_size_t i, j, n = size - size % (32 / typesz);
+    dv_size_t ret;
+
+    for (i = 0; i < n; i += 32 / typesz) {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (p + i * typesz));
+        __m256i c = _mm256_setzero_si256();
+        unsigned mask;
+        for (j = 0; j < num; j++) {
+            c = _mm256_or_si256(c, cmpeq_avx2(a, set1_avx2(vals[j], typesz), typesz));
+        }
+        mask = (unsigned) _mm256_movemask_epi8(c);
+        if (mask) {
+            return i + __builtin_ctz(mask) / typesz;
+        }
+    }
+
+    ret = find_any_scalar(p + n * typesz, size - n, typesz, vals, num);
+    return ret >= 0 ? n + ret : -1;
+}
+
+static const find_funcs g_avx2 = {&find_avx2, &count_avx2, &find_any_avx2};
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+static const find_funcs g_scalar = {&find_scalar, &count_scalar, &find_any_scalar};
+
+static int g_simd_limit = DV_SIMD_AVX2;
+
+void dv_set_simd(int level)
+{ g_simd_limit = level; }
+
+#ifdef DV_HAVE_X86
+/* CPU features are detected once on first use. Racing threads store the
+ * same value. */
+#define CPU_DETECTED 1
+#define CPU_SSE2 2
+#define CPU_SSSE3 4
+#define CPU_AVX2 8
+
+static int g_cpu;
+
+static int cpu_features(void)
+{
+    int f = __atomic_load_n(&g_cpu, __ATOMIC_RELAXED);
+
+    if (!f) {
+        f = CPU_DETECTED;
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse2")) {
+            f |= CPU_SSE2;
+        }
+        if (__builtin_cpu_supports("ssse3")) {
+            f |= CPU_SSSE3;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+            f |= CPU_AVX2;
+        }
+        __atomic_store_n(&g_cpu, f, __ATOMIC_RELAXED);
+    }
+
+    return f;
+}
+#endif
+
+int dvi_simd(void)
+{
+    int level = DV_SIMD_NONE;
+#ifdef DV_HAVE_X86
+    int f = cpu_features();
+    if (f & CPU_AVX2) {
+        level = DV_SIMD_AVX2;
+    } else if (f & CPU_SSE2) {
+        level = DV_SIMD_SSE2;
+    }
+#endif
+    return level < g_simd_limit ? level : g_simd_limit;
+}
+
+int dvi_ssse3(void)
+{
+#ifdef DV_HAVE_X86
+    return dvi_simd() >= DV_SIMD_SSE2 && (cpu_features() & CPU_SSSE3);
+#else
+    return 0;
+#endif
+}
+
+static const find_funcs* funcs(void)
+{
+    switch (dvi_simd()) {
+#ifdef DV_HAVE_X86
+    case DV_SIMD_AVX2:
+        return &g_avx2;
+    case DV_SIMD_SSE2:
+        return &g_sse2;
+#endif
+    default:
+        return &g_scalar;
+    }
+}
+
+dv_size_t dv_find_int_base(const void* data, dv_size_t size, int typesz, uint64_t val)
+{
+    assert(typesz == 1 || typesz == 2 || typesz == 4 || typesz == 8);
+    return funcs()->find(data, size, typesz, mask_value(val, typesz));
+}
+
+dv_size_t dv_count_int_base(const void* data, dv_size_t size, int typesz, uint64_t val)
+{
+    assert(typesz == 1 || typesz == 2 || typesz == 4 || typesz == 8);
+    return funcs()->count(data, size, typesz, mask_value(val, typesz));
+}
+
+dv_size_t dv_find_any_int_base(const void* data, dv_size_t size, int typesz, const void* vals, dv_size_t num)
+{
+    uint64_t buf[16];
+    uint64_t* keys = num <= 16 ? buf : (uint64_t*) malloc(num * sizeof(uint64_t));
+    dv_size_t i, ret;
+
+    assert(typesz == 1 || typesz == 2 || typesz == 4 || typesz == 8);
+
+    for (i = 0; i < num; i++) {
+        keys[i] = load((const uint8_t*) vals + i * typesz, typesz);
+    }
+
+    ret = funcs()->find_any(data, size, typesz, keys, num);
+
+    if (keys != buf) {
+        free(keys);
+    }
+
+    return ret;
+}
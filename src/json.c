@@ -259,11 +259,8 @@ static const char* GetNumber(dj_Parser* parser, dji_Lexer* s, const char* b, con
 {
     const char* p = b;
     const char* data;
-    char* strtod_end;
-
-    /* We also need to always copy out the number as we can't guarantee that
-     * str is null terminated.
-     */
+    const char* end;
+    d_string num;
 
     for (;;) {
         if (p == e) {
@@ -276,61 +273,61 @@ static const char* GetNumber(dj_Parser* parser, dji_Lexer* s, const char* b, con
         }
     }
 
-    dv_append2(&s->partial, b, p - b);
+    /* We only need to copy the number out if it's split over buffers */
+    if (s->partial.size) {
+        dv_append2(&s->partial, b, p - b);
+        num = s->partial;
+    } else {
+        num = dv_char2(b, p - b);
+    }
 
-    /* strtod parses more than what JSON strictly allows, so we find the end
-     * of the number as far as the JSON spec is concerned and only feed that
-     * to strtod.
+    /* dv_parse_number parses more than what JSON strictly allows, so we
+     * check the number against the JSON grammar first.
      */
-    data = s->partial.data;
+    data = num.data;
+    end = num.data + num.size;
 
-    if (*data == '-') data++;
+    if (data < end && *data == '-') data++;
 
-    if (*data == '0') {
+    if (data < end && *data == '0') {
         data++;
-    } else if ('1' <= *data && *data <= '9') {
-        while ('0' <= *data && *data <= '9') {
+    } else if (data < end && '1' <= *data && *data <= '9') {
+        while (data < end && '0' <= *data && *data <= '9') {
             data++;
         }
     } else {
         ThrowError(parser, "Unexpected character in number");
     }
 
-    if (*data == '.') {
+    if (data < end && *data == '.') {
         data++;
 
-        if (*data < '0' || '9' < *data) {
+        if (data == end || *data < '0' || '9' < *data) {
             ThrowError(parser, "Expected digit after '.' in number");
         }
 
-        while ('0' <= *data && *data <= '9') {
+        while (data < end && '0' <= *data && *data <= '9') {
             data++;
         }
     }
 
-    if (*data == 'e' || *data == 'E') {
+    if (data < end && (*data == 'e' || *data == 'E')) {
         data++;
 
-        if (*data == '+' || *data == '-') {
+        if (data < end && (*data == '+' || *data == '-')) {
             data++;
         }
 
-        if (*data < '0' || '9' < *data) {
+        if (data == end || *data < '0' || '9' < *data) {
             ThrowError(parser, "Expected digit after exponent in number");
         }
 
-        while ('0' <= *data && *data <= '9') {
+        while (data < end && '0' <= *data && *data <= '9') {
             data++;
         }
     }
 
-    if (*data != '\0') {
-        ThrowError(parser, "Invalid number");
-    }
-
-    *out = strtod(s->partial.data, &strtod_end);
-
-    if (data != strtod_end) {
+    if (data != end || dv_parse_number(num, out) != num.size) {
         ThrowError(parser, "Invalid number");
     } else if (*out == HUGE_VAL || *out == -HUGE_VAL) {
         ThrowError(parser, "Number overflow");
@@ -422,6 +419,7 @@ int dj_parse_chunk(dj_Parser* p, d_string str)
     memset(&node, 0, sizeof(node));
 
     node.key = p->current_key;
+    node.source = p->source;
 
     ret = setjmp(p->jmp);
     if (ret == DJI_ERROR) {
@@ -763,7 +761,7 @@ int dj_parse_complete(dj_Parser* p)
 
 /* -------------------------------------------------------------------------- */
 
-int dj_parse(d_string str, dj_Delegate dlg, d_vector(char)* errstr)
+static int Parse(d_string str, d_shared source, dj_Delegate dlg, d_vector(char)* errstr)
 {
     int ret;
     dj_Parser p;
@@ -771,6 +769,7 @@ int dj_parse(d_string str, dj_Delegate dlg, d_vector(char)* errstr)
 
     memset(&p, 0, sizeof(p));
 
+    p.source = source;
     p.errstr = errstr;
     p.line_number = 1;
     root = (dji_Scope*) dv_append_zeroed(&p.scopes, 1);
@@ -788,6 +787,17 @@ int dj_parse(d_string str, dj_Delegate dlg, d_vector(char)* errstr)
     return ret;
 }
 
+int dj_parse(d_string str, dj_Delegate dlg, d_vector(char)* errstr)
+{
+    d_shared source = DS_INIT;
+    return Parse(str, source, dlg, errstr);
+}
+
+/* The parser doesn't take a reference, nodes borrow the caller's for the
+ * duration of the parse */
+int dj_parse_shared(d_shared str, dj_Delegate dlg, d_vector(char)* errstr)
+{ return Parse(ds_string(str), str, dlg, errstr); }
+
 /* -------------------------------------------------------------------------- */
 
 static void AppendNewline(dj_Builder* b)
@@ -945,7 +955,7 @@ void dj_append_string(dj_Builder* b, d_string value)
 void dj_append_number(dj_Builder* b, double value)
 {
     StartValue(b);
-    dv_print(&b->out, "%.15g", value);
+    dv_append_number(&b->out, value);
 }
 
 void dj_append_boolean(dj_Builder* b, bool value)
@@ -70,6 +70,7 @@ struct dj_Parser {
     d_Slice(char)       current_key;
     d_Vector(char)*     errstr;
     d_Vector(char)      error_string_buffer;
+    d_shared            source;
     int                 line_number;
     jmp_buf             jmp;
 };
@@ -0,0 +1,74 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#include "bench.h"
+
+/* Appends a large amount of data to a vector in small chunks to compare
+ * growing with realloc against growing a memory map with mremap. This needs
+ * 64 bit vector sizes so is built against libdmem64. The total defaults to
+ * 4GB and can be set with the first argument in MB.
+ */
+
+#define CHUNK 64
+
+struct Append {
+    uint64_t total;
+    char chunk[CHUNK];
+};
+
+static void append(void* udata)
+{
+    struct Append* a = (struct Append*) udata;
+    d_vector(char) v = DV_INIT;
+
+    while ((uint64_t) v.size < a->total) {
+        dv_append2(&v, a->chunk, CHUNK);
+    }
+
+    dv_free(v);
+}
+
+int main(int argc, char* argv[])
+{
+    struct Append a;
+    memset(a.chunk, 'a', CHUNK);
+    a.total = (uint64_t) (argc > 1 ? atoi(argv[1]) : 4096) << 20;
+
+    printf("appending %d MB in %d byte chunks\n", (int) (a.total >> 20), CHUNK);
+
+    dv_set_mmap_threshold(0, false);
+    bench_run("append (realloc)", 1, &append, &a);
+
+    dv_set_mmap_threshold(64 * 1024 * 1024, false);
+    bench_run("append (mremap)", 1, &append, &a);
+
+    dv_set_mmap_threshold(64 * 1024 * 1024, true);
+    bench_run("append (mremap + huge pages)", 1, &append, &a);
+
+    return 0;
+}
+
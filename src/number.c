@@ -0,0 +1,914 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+/* needed for NAN */
+#define _ISOC99_SOURCE
+#define DMEM_LIBRARY
+
+#include <dmem/char.h>
+#include <float.h>
+#include <math.h>
+
+#if defined _MSC_VER && !defined NAN
+#include <ymath.h>
+#define NAN _Nan._Double
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define INIT_GET(P) _InterlockedExchangeAdd((P), 0)
+#define INIT_SET(P) _InterlockedExchange((P), 1)
+#else
+#define INIT_GET(P) __atomic_load_n((P), __ATOMIC_ACQUIRE)
+#define INIT_SET(P) __atomic_store_n((P), 1, __ATOMIC_RELEASE)
+#endif
+
+#define dv_isspace(c) ((c) == '\n' || (c) == '\t' || (c) == ' ' || (c) == '\r')
+
+/* Number parsing works directly on the slice without copying it or
+ * looking at the locale. Up to 19 significant digits are collected into a
+ * 64 bit mantissa which is then converted by, in order:
+ *
+ * 1. Clinger's fast path, when the mantissa and power of ten are both
+ *    exact doubles so a single multiply or divide rounds correctly.
+ * 2. The Eisel-Lemire algorithm, which multiplies the mantissa by a 128
+ *    bit approximation of the power of ten and bails out in the rare cases
+ *    where the approximation can't decide the rounding. This follows the
+ *    version in Go's strconv, which also leaves subnormals to the slow path.
+ * 3. A slow path that does the conversion exactly on up to 800 decimal
+ *    digits by repeated binary shifts, again after Go's strconv.
+ */
+
+/* ------------------------------------------------------------------------- */
+
+static double from_bits(uint64_t bits)
+{
+    double ret;
+    memcpy(&ret, &bits, sizeof(ret));
+    return ret;
+}
+
+static void mul64(uint64_t a, uint64_t b, uint64_t* hi, uint64_t* lo)
+{
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128) a * b;
+    *hi = (uint64_t) (r >> 64);
+    *lo = (uint64_t) r;
+#else
+    uint64_t alo = a & 0xFFFFFFFF, ahi = a >> 32;
+    uint64_t blo = b & 0xFFFFFFFF, bhi = b >> 32;
+    uint64_t ll = alo * blo, lh = alo * bhi, hl = ahi * blo, hh = ahi * bhi;
+    uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+    *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    *lo = (mid << 32) | (ll & 0xFFFFFFFF);
+#endif
+}
+
+/* Returns the number of leading zero bits in 'x', which must not be zero */
+static int clz64(uint64_t x)
+{
+#if defined __GNUC__
+    return __builtin_clzll(x);
+#elif defined _MSC_VER && (defined _M_X64 || defined _M_ARM64)
+    unsigned long idx;
+    _BitScanReverse64(&idx, x);
+    return 63 - (int) idx;
+#else
+    int n = 0;
+    while (!(x >> 63)) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static int digit_value(char ch)
+{
+    if ('0' <= ch && ch <= '9') {
+        return ch - '0';
+    } else if ('a' <= (ch | 0x20) && (ch | 0x20) <= 'z') {
+        return (ch | 0x20) - 'a' + 10;
+    } else {
+        return 99;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* 128 bit approximations of 1e-342 to 1e324, rounded down and shifted so
+ * the top bit is set, stored as {hi, lo}. Parsing needs up to 1e308 and
+ * formatting needs up to 1e324. Rather than carry a 660 line table these
+ * are built exactly on first use by multiplying a big integer by ten for
+ * the positive powers and dividing 2^1344 by ten for the negative ones.
+ * Racing threads write the same values. */
+#define POW10_MIN -342
+#define POW10_MAX 324
+
+static uint64_t g_pow10[POW10_MAX - POW10_MIN + 1][2];
+static long g_pow10_init;
+
+/* Returns the 32 bits of the little endian big integer 'v' starting at bit
+ * 'pos', which may be negative */
+static uint32_t big_bits(const uint32_t* v, int n, int pos)
+{
+    int i = pos >> 5;
+    uint64_t lo = (i >= 0 && i < n) ? v[i] : 0;
+    uint64_t hi = (i + 1 >= 0 && i + 1 < n) ? v[i + 1] : 0;
+    return (uint32_t) (((hi << 32) | lo) >> (pos & 31));
+}
+
+static void big_top128(uint64_t* out, const uint32_t* v, int n)
+{
+    int pos;
+    while (v[n - 1] == 0) {
+        n--;
+    }
+    pos = n * 32 - (clz64(v[n - 1]) - 32) - 128;
+    out[0] = ((uint64_t) big_bits(v, n, pos + 96) << 32) | big_bits(v, n, pos + 64);
+    out[1] = ((uint64_t) big_bits(v, n, pos + 32) << 32) | big_bits(v, n, pos);
+}
+
+static void init_pow10(void)
+{
+    uint32_t big[43];
+    int i, q, n;
+
+    if (INIT_GET(&g_pow10_init)) {
+        return;
+    }
+
+    big[0] = 1;
+    n = 1;
+    for (q = 0; q <= POW10_MAX; q++) {
+        uint64_t carry = 0;
+        big_top128(g_pow10[q - POW10_MIN], big, n);
+        for (i = 0; i < n; i++) {
+            carry += (uint64_t) big[i] * 10;
+            big[i] = (uint32_t) carry;
+            carry >>= 32;
+        }
+        if (carry) {
+            big[n++] = (uint32_t) carry;
+        }
+    }
+
+    memset(big, 0, sizeof(big));
+    big[42] = 1;
+    for (q = -1; q >= POW10_MIN; q--) {
+        uint64_t rem = 0;
+        for (i = 42; i >= 0; i--) {
+            uint64_t cur = (rem << 32) | big[i];
+            big[i] = (uint32_t) (cur / 10);
+            rem = cur % 10;
+        }
+        big_top128(g_pow10[q - POW10_MIN], big, 43);
+    }
+
+    INIT_SET(&g_pow10_init);
+}
+
+/* Sets *out to man * 10^exp10 if it can be decided from the 128 bit
+ * approximation and is a normal double. 'man' must not be zero. */
+static bool eisel_lemire(uint64_t man, int exp10, bool neg, double* out)
+{
+    const uint64_t* pow;
+    uint64_t xhi, xlo, yhi, ylo, msb, retexp;
+    int clz;
+
+    if (exp10 < POW10_MIN || exp10 > 308) {
+        return false;
+    }
+
+    clz = clz64(man);
+    man <<= clz;
+    retexp = (uint64_t) (((217706 * exp10) >> 16) + 64 + 1023 - clz);
+    pow = g_pow10[exp10 - POW10_MIN];
+
+    mul64(man, pow[0], &xhi, &xlo);
+
+    /* The low bits of the product might carry into the 54 bits we keep,
+     * so bring in the low half of the power of ten */
+    if ((xhi & 0x1FF) == 0x1FF && xlo + man < man) {
+        uint64_t mhi = xhi, mlo;
+        mul64(man, pow[1], &yhi, &ylo);
+        mlo = xlo + yhi;
+        if (mlo < xlo) {
+            mhi++;
+        }
+        if ((mhi & 0x1FF) == 0x1FF && mlo + 1 == 0 && ylo + man < man) {
+            return false;
+        }
+        xhi = mhi;
+        xlo = mlo;
+    }
+
+    /* Shift down to 54 bits */
+    msb = xhi >> 63;
+    man = xhi >> (msb + 9);
+    retexp -= 1 ^ msb;
+
+    /* We can't tell a half way value from one just above it */
+    if (xlo == 0 && (xhi & 0x1FF) == 0 && (man & 3) == 1) {
+        return false;
+    }
+
+    /* Round to 53 bits */
+    man += man & 1;
+    man >>= 1;
+    if (man >> 53) {
+        man >>= 1;
+        retexp++;
+    }
+
+    /* Subnormal, zero or infinite */
+    if (retexp - 1 >= 0x7FF - 1) {
+        return false;
+    }
+
+    *out = from_bits((neg ? (uint64_t) 1 << 63 : 0) | retexp << 52 | (man & (((uint64_t) 1 << 52) - 1)));
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* A decimal number 0.d[0]d[1]...d[nd-1] * 10^dp. trunc is set when non
+ * zero digits past the end have been dropped. */
+#define DECIMAL_DIGITS 800
+#define MAX_SHIFT 60
+
+typedef struct decimal decimal;
+
+struct decimal {
+    uint8_t d[DECIMAL_DIGITS];
+    int nd;
+    int dp;
+    bool trunc;
+};
+
+static void decimal_trim(decimal* a)
+{
+    while (a->nd > 0 && a->d[a->nd - 1] == 0) {
+        a->nd--;
+    }
+    if (a->nd == 0) {
+        a->dp = 0;
+    }
+}
+
+static void decimal_right_shift(decimal* a, int k)
+{
+    uint64_t mask = ((uint64_t) 1 << k) - 1;
+    uint64_t n = 0;
+    int r = 0, w = 0;
+
+    /* Pick up enough leading digits to cover the first shift */
+    for (; (n >> k) == 0; r++) {
+        if (r >= a->nd) {
+            if (n == 0) {
+                a->nd = 0;
+                return;
+            }
+            while ((n >> k) == 0) {
+                n *= 10;
+                r++;
+            }
+            break;
+        }
+        n = n * 10 + a->d[r];
+    }
+    a->dp -= r - 1;
+
+    /* Pick up a digit, put down a digit */
+    for (; r < a->nd; r++) {
+        a->d[w++] = (uint8_t) (n >> k);
+        n = (n & mask) * 10 + a->d[r];
+    }
+
+    /* Put down the extra digits */
+    while (n > 0) {
+        uint8_t dig = (uint8_t) (n >> k);
+        n &= mask;
+        if (w < DECIMAL_DIGITS) {
+            a->d[w++] = dig;
+        } else if (dig > 0) {
+            a->trunc = true;
+        }
+        n *= 10;
+    }
+
+    a->nd = w;
+    decimal_trim(a);
+}
+
+static void decimal_left_shift(decimal* a, int k)
+{
+    /* Multiplying by 2^k adds at most k/3 + 1 digits. Write the result
+     * from the right that far along and then move it down. */
+    int delta = k / 3 + 1;
+    int r = a->nd - 1;
+    int w = a->nd + delta - 1;
+    int end = a->nd + delta < DECIMAL_DIGITS ? a->nd + delta : DECIMAL_DIGITS;
+    uint64_t n = 0;
+
+    while (r >= 0 || n > 0) {
+        uint64_t quo, rem;
+        if (r >= 0) {
+            n += (uint64_t) a->d[r--] << k;
+        }
+        quo = n / 10;
+        rem = n - 10 * quo;
+        if (w < DECIMAL_DIGITS) {
+            a->d[w] = (uint8_t) rem;
+        } else if (rem > 0) {
+            a->trunc = true;
+        }
+        w--;
+        n = quo;
+    }
+
+    w++;
+    memmove(a->d, a->d + w, end - w);
+    a->nd = end - w;
+    a->dp += delta - w;
+    decimal_trim(a);
+}
+
+static void decimal_shift(decimal* a, int k)
+{
+    for (; k > MAX_SHIFT; k -= MAX_SHIFT) {
+        decimal_left_shift(a, MAX_SHIFT);
+    }
+    for (; k < -MAX_SHIFT; k += MAX_SHIFT) {
+        decimal_right_shift(a, MAX_SHIFT);
+    }
+    if (k > 0) {
+        decimal_left_shift(a, k);
+    } else if (k < 0) {
+        decimal_right_shift(a, -k);
+    }
+}
+
+/* Returns the integer part rounded half to even */
+static uint64_t decimal_round(const decimal* a)
+{
+    uint64_t n = 0;
+    int i;
+    bool up;
+
+    for (i = 0; i < a->dp; i++) {
+        n = n * 10 + (i < a->nd ? a->d[i] : 0);
+    }
+
+    if (a->dp < 0 || a->dp >= a->nd) {
+        up = false;
+    } else if (a->d[a->dp] == 5 && a->dp + 1 == a->nd) {
+        up = a->trunc || (a->dp > 0 && (a->d[a->dp - 1] & 1));
+    } else {
+        up = a->d[a->dp] >= 5;
+    }
+
+    return n + up;
+}
+
+/* Converts the digits in [p,e), which may include a '.', times 10^exp */
+static double parse_slow(const char* p, const char* e, int exp, bool neg)
+{
+    /* binary shift that moves each decimal point position under 1 */
+    static const int powtab[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+    uint64_t sign = neg ? (uint64_t) 1 << 63 : 0;
+    uint64_t man;
+    bool point = false;
+    decimal a;
+    int bexp;
+
+    a.nd = 0;
+    a.dp = 0;
+    a.trunc = false;
+
+    for (; p < e; p++) {
+        if (*p == '.') {
+            point = true;
+        } else if (*p == '0' && a.nd == 0) {
+            a.dp -= point;
+        } else if (a.nd < DECIMAL_DIGITS) {
+            a.dp += !point;
+            a.d[a.nd++] = (uint8_t) (*p - '0');
+        } else {
+            a.dp += !point;
+            a.trunc |= *p != '0';
+        }
+    }
+    a.dp += exp;
+    decimal_trim(&a);
+
+    if (a.nd == 0 || a.dp < -330) {
+        return from_bits(sign);
+    } else if (a.dp > 310) {
+        goto overflow;
+    }
+
+    /* Scale by powers of two until in [0.5, 1) */
+    bexp = 0;
+    while (a.dp > 0) {
+        int n = a.dp >= 9 ? 27 : powtab[a.dp];
+        decimal_shift(&a, -n);
+        bexp += n;
+    }
+    while (a.dp < 0 || (a.dp == 0 && a.d[0] < 5)) {
+        int n = -a.dp >= 9 ? 27 : powtab[-a.dp];
+        decimal_shift(&a, n);
+        bexp -= n;
+    }
+
+    /* A double's significand is in [1, 2) and the smallest exponent of a
+     * normal value is -1022. Below that drop bits to make a subnormal. */
+    bexp--;
+    if (bexp < -1022) {
+        decimal_shift(&a, bexp + 1022);
+        bexp = -1022;
+    }
+    if (bexp > 1023) {
+        goto overflow;
+    }
+
+    decimal_shift(&a, 53);
+    man = decimal_round(&a);
+
+    if (man == (uint64_t) 1 << 53) {
+        man >>= 1;
+        if (++bexp > 1023) {
+            goto overflow;
+        }
+    }
+
+    if (!(man >> 52)) {
+        /* subnormal */
+        return from_bits(sign | man);
+    }
+
+    return from_bits(sign | (uint64_t) (bexp + 1023) << 52 | (man & (((uint64_t) 1 << 52) - 1)));
+
+overflow:
+    return from_bits(sign | (uint64_t) 0x7FF << 52);
+}
+
+/* ------------------------------------------------------------------------- */
+
+#if FLT_EVAL_METHOD == 0
+static const double g_exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+#endif
+
+/* Returns the length of 'word' if [p,e) starts with it ignoring case */
+static int match_word(const char* p, const char* e, const char* word)
+{
+    int n = (int) strlen(word);
+    int i;
+    if (e - p < n) {
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        if ((p[i] | 0x20) != word[i]) {
+            return 0;
+        }
+    }
+    return n;
+}
+
+dv_size_t dv_parse_number(d_string str, double* out)
+{
+    const char* p = str.data;
+    const char* e = p + str.size;
+    const char* digits;
+    const char* end;
+    uint64_t man = 0;
+    int ndigits = 0, exp10 = 0, exp = 0;
+    bool neg = false, trunc = false, any = false;
+    double up;
+
+    if (p < e && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        p++;
+    }
+
+    digits = p;
+
+    for (; p < e && '0' <= *p && *p <= '9'; p++) {
+        any = true;
+        if (ndigits < 19) {
+            man = man * 10 + (*p - '0');
+            ndigits += man != 0;
+        } else {
+            exp10++;
+            trunc |= *p != '0';
+        }
+    }
+
+    if (p < e && *p == '.') {
+        for (p++; p < e && '0' <= *p && *p <= '9'; p++) {
+            any = true;
+            if (ndigits < 19) {
+                man = man * 10 + (*p - '0');
+                ndigits += man != 0;
+                exp10--;
+            } else {
+                trunc |= *p != '0';
+            }
+        }
+    }
+
+    if (!any) {
+        int n;
+        if ((n = match_word(digits, e, "infinity")) != 0 || (n = match_word(digits, e, "inf")) != 0) {
+            *out = neg ? -INFINITY : INFINITY;
+        } else if ((n = match_word(digits, e, "nan")) != 0) {
+            *out = neg ? -NAN : NAN;
+        } else {
+            return 0;
+        }
+        return (dv_size_t) (digits + n - str.data);
+    }
+
+    end = p;
+
+    /* The exponent is optional and only consumed if it has digits */
+    if (p < e && (*p | 0x20) == 'e') {
+        const char* q = p + 1;
+        bool eneg = false;
+        if (q < e && (*q == '-' || *q == '+')) {
+            eneg = *q == '-';
+            q++;
+        }
+        if (q < e && '0' <= *q && *q <= '9') {
+            for (; q < e && '0' <= *q && *q <= '9'; q++) {
+                if (exp < 100000) {
+                    exp = exp * 10 + (*q - '0');
+                }
+            }
+            exp = eneg ? -exp : exp;
+            p = q;
+        }
+    }
+
+    exp10 += exp;
+
+    if (man == 0) {
+        *out = neg ? -0.0 : 0.0;
+        return (dv_size_t) (p - str.data);
+    }
+
+#if FLT_EVAL_METHOD == 0
+    if (!trunc && man <= (uint64_t) 1 << 53 && -22 <= exp10 && exp10 <= 22) {
+        double d = (double) man;
+        d = exp10 < 0 ? d / g_exact_pow10[-exp10] : d * g_exact_pow10[exp10];
+        *out = neg ? -d : d;
+        return (dv_size_t) (p - str.data);
+    }
+#endif
+
+    init_pow10();
+
+    /* If we dropped digits the value is between man and man+1 */
+    if (!eisel_lemire(man, exp10, neg, out)
+            || (trunc && (!eisel_lemire(man + 1, exp10, neg, &up) || up != *out))) {
+        *out = parse_slow(digits, end, exp, neg);
+    }
+
+    return (dv_size_t) (p - str.data);
+}
+
+/* ------------------------------------------------------------------------- */
+
+dv_size_t dv_parse_integer(d_string str, int radix, int64_t* out)
+{
+    const char* p = str.data;
+    const char* e = p + str.size;
+    const char* digits;
+    uint64_t v = 0, limit;
+    bool neg = false, overflow = false;
+
+    if (radix < 0 || radix == 1 || radix > 36) {
+        return 0;
+    }
+
+    if (p < e && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        p++;
+    }
+
+    if ((radix == 0 || radix == 16) && e - p > 2 && p[0] == '0' && (p[1] | 0x20) == 'x' && digit_value(p[2]) < 16) {
+        radix = 16;
+        p += 2;
+    } else if (radix == 0) {
+        radix = (p < e && *p == '0') ? 8 : 10;
+    }
+
+    limit = neg ? (uint64_t) INT64_MAX + 1 : (uint64_t) INT64_MAX;
+    digits = p;
+
+    for (; p < e; p++) {
+        int d = digit_value(*p);
+        if (d >= radix) {
+            break;
+        } else if (overflow || v > (limit - d) / radix) {
+            overflow = true;
+        } else {
+            v = v * radix + d;
+        }
+    }
+
+    if (p == digits) {
+        return 0;
+    } else if (overflow) {
+        return -1;
+    }
+
+    *out = neg ? -(int64_t) (v - 1) - 1 : (int64_t) v;
+    return (dv_size_t) (p - str.data);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Formatting finds the shortest decimal that rounds back to the double
+ * using Raffaello Giulietti's Schubfach algorithm. This needs upper bounds
+ * of the powers of ten, which are the values in g_pow10 plus one. The
+ * digits are then written two at a time.
+ */
+
+static const char g_digits2[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Writes the decimal digits of 'v' ending at 'end' and returns the start */
+static char* write_digits(char* end, uint64_t v)
+{
+    while (v >= 100) {
+        uint64_t r = v % 100;
+        v /= 100;
+        end -= 2;
+        memcpy(end, g_digits2 + 2 * r, 2);
+    }
+    if (v >= 10) {
+        end -= 2;
+        memcpy(end, g_digits2 + 2 * v, 2);
+    } else {
+        *(--end) = (char) ('0' + v);
+    }
+    return end;
+}
+
+/* Returns g * cp / 2^128 rounded to odd, as far as the error in g allows */
+static uint64_t round_to_odd(uint64_t ghi, uint64_t glo, uint64_t cp)
+{
+    uint64_t xhi, xlo, yhi, ylo, z;
+    mul64(glo, cp, &xhi, &xlo);
+    mul64(ghi, cp, &yhi, &ylo);
+    z = ylo + xhi;
+    yhi += z < ylo;
+    return yhi | (z > 1);
+}
+
+/* Sets *ps * 10^*pk to the shortest decimal that rounds to the positive
+ * finite double with bits 'bits', picking the closest if there's a choice */
+static void to_decimal(uint64_t bits, uint64_t* ps, int* pk)
+{
+    uint64_t m = bits & (((uint64_t) 1 << 52) - 1);
+    int e = (int) (bits >> 52);
+    uint64_t c, glo, ghi, vbl, vb, vbr, lower, upper, s;
+    const uint64_t* pow;
+    bool even, closer;
+    int q, k, h;
+
+    if (e) {
+        c = m | (uint64_t) 1 << 52;
+        q = e - 1075;
+
+        /* Small integers */
+        if (-52 <= q && q <= 0 && (c & (((uint64_t) 1 << -q) - 1)) == 0) {
+            *ps = c >> -q;
+            *pk = 0;
+            return;
+        }
+    } else {
+        c = m;
+        q = -1074;
+    }
+
+    /* The interval of values that round to this double is [cbl, cbr] * 2^q/4,
+     * inclusive if c is even. It's uneven at powers of two. */
+    even = (c & 1) == 0;
+    closer = m == 0 && e > 1;
+
+    /* k is floor(log10(2^q)), or of 3/4 2^q if the lower end is closer */
+    k = (q * 1262611 - (closer ? 524031 : 0)) >> 22;
+    h = q + ((-k * 1741647) >> 19) + 1;
+
+    pow = g_pow10[-k - POW10_MIN];
+    glo = pow[1] + 1;
+    ghi = pow[0] + (glo == 0);
+
+    vbl = round_to_odd(ghi, glo, (4 * c - 2 + closer) << h);
+    vb = round_to_odd(ghi, glo, (4 * c) << h);
+    vbr = round_to_odd(ghi, glo, (4 * c + 2) << h);
+
+    lower = vbl + !even;
+    upper = vbr - !even;
+    s = vb / 4;
+
+    /* Try one digit shorter than s first */
+    if (s >= 10) {
+        uint64_t sp = s / 10;
+        bool up_inside = lower <= 40 * sp;
+        bool wp_inside = 40 * sp + 40 <= upper;
+        if (up_inside != wp_inside) {
+            *ps = sp + wp_inside;
+            *pk = k + 1;
+            return;
+        }
+    }
+
+    {
+        bool u_inside = lower <= 4 * s;
+        bool w_inside = 4 * s + 4 <= upper;
+        if (u_inside != w_inside) {
+            *ps = s + w_inside;
+        } else {
+            /* Both or neither, so take the closest rounding half to even */
+            uint64_t mid = 4 * s + 2;
+            *ps = s + (vb > mid || (vb == mid && (s & 1)));
+        }
+        *pk = k;
+    }
+}
+
+void dv_append_number(d_vector(char)* to, double value)
+{
+    dv_size_t start = to->size;
+    char* begin = dv_append_buffer(to, 32);
+    char* p = begin;
+    char digits[20];
+    char* d = digits + sizeof(digits);
+    uint64_t bits, s;
+    int k, nd, n;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (bits >> 63) {
+        *(p++) = '-';
+        bits &= ~((uint64_t) 1 << 63);
+    }
+
+    if (bits >= (uint64_t) 0x7FF << 52) {
+        if (bits > (uint64_t) 0x7FF << 52) {
+            p = begin;
+            memcpy(p, "nan", 3);
+        } else {
+            memcpy(p, "inf", 3);
+        }
+        p += 3;
+        goto end;
+    } else if (bits == 0) {
+        *(p++) = '0';
+        goto end;
+    }
+
+    init_pow10();
+    to_decimal(bits, &s, &k);
+
+    while (s % 10 == 0) {
+        s /= 10;
+        k++;
+    }
+
+    d = write_digits(d, s);
+    nd = (int) (digits + sizeof(digits) - d);
+
+    /* The value is 0.<digits> * 10^n. Like JavaScript, write it out in full
+     * when n is from -5 to 21 and use an exponent otherwise. */
+    n = k + nd;
+
+    if (nd <= n && n <= 21) {
+        memcpy(p, d, nd);
+        memset(p + nd, '0', n - nd);
+        p += n;
+
+    } else if (0 < n && n <= 21) {
+        memcpy(p, d, n);
+        p[n] = '.';
+        memcpy(p + n + 1, d + n, nd - n);
+        p += nd + 1;
+
+    } else if (-6 < n && n <= 0) {
+        p[0] = '0';
+        p[1] = '.';
+        memset(p + 2, '0', -n);
+        memcpy(p + 2 - n, d, nd);
+        p += 2 - n + nd;
+
+    } else {
+        *(p++) = d[0];
+        if (nd > 1) {
+            *(p++) = '.';
+            memcpy(p, d + 1, nd - 1);
+            p += nd - 1;
+        }
+        *(p++) = 'e';
+        *(p++) = n - 1 < 0 ? '-' : '+';
+        d = write_digits(digits + sizeof(digits), n - 1 < 0 ? 1 - n : n - 1);
+        nd = (int) (digits + sizeof(digits) - d);
+        memcpy(p, d, nd);
+        p += nd;
+    }
+
+end:
+    dv_resize(to, start + (dv_size_t) (p - begin));
+}
+
+void dv_append_integer(d_vector(char)* to, int64_t value)
+{
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    uint64_t u = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+    char* p = write_digits(end, u);
+
+    if (value < 0) {
+        *(--p) = '-';
+    }
+
+    dv_append2(to, p, (dv_size_t) (end - p));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static d_string skip_whitespace(d_string s)
+{
+    while (s.size && dv_isspace(s.data[0])) {
+        s.data++;
+        s.size--;
+    }
+    return s;
+}
+
+double dv_to_number(d_string value)
+{
+    double ret;
+    dv_size_t n;
+
+    if (value.size == 0) return NAN;
+
+    value = skip_whitespace(value);
+    n = dv_parse_number(value, &ret);
+
+    if (n == 0 || (n < value.size && !dv_isspace(value.data[n]))) {
+        return 0;
+    }
+
+    return ret;
+}
+
+/* ------------------------------------------------------------------------- */
+
+int dv_to_integer(d_string value, int radix, int defvalue)
+{
+    int64_t ret;
+    dv_size_t n;
+
+    value = skip_whitespace(value);
+    n = dv_parse_integer(value, radix, &ret);
+
+    if (n <= 0 || ret < INT_MIN || ret > INT_MAX) {
+        return defvalue;
+    } else if (n < value.size && !dv_isspace(value.data[n])) {
+        return defvalue;
+    }
+
+    return (int) ret;
+}
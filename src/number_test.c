@@ -0,0 +1,258 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#include <dmem/char.h>
+#include <math.h>
+#include <locale.h>
+#include "test.h"
+
+static uint64_t g_seed = 88172645463325252ULL;
+
+static uint64_t next_random(void)
+{
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 7;
+    g_seed ^= g_seed << 17;
+    return g_seed;
+}
+
+/* Checks that dv_append_number gives 'str' for 'value' */
+static void check_format(double value, const char* str)
+{
+    d_vector(char) v = DV_INIT;
+    dv_append_number(&v, value);
+    check_string(v, dv_char(str));
+    dv_free(v);
+}
+
+/* Checks that dv_parse_number consumes all of 'str' and gives the same bits
+ * as strtod in the C locale */
+static void check_strtod(const char* str)
+{
+    double have, exp = strtod(str, NULL);
+    check(dv_parse_number(dv_char(str), &have) == (dv_size_t) strlen(str));
+    check(memcmp(&have, &exp, sizeof(have)) == 0);
+}
+
+int main(void)
+{
+    static const char* hard[] = {
+        /* around the smallest normal */
+        "2.2250738585072011e-308",
+        "2.2250738585072012e-308",
+        /* subnormals and half of the smallest subnormal */
+        "4.9406564584124654e-324",
+        "2.4703282292062327e-324",
+        "2.4703282292062328e-324",
+        /* around the largest double */
+        "1.7976931348623157e308",
+        "1.7976931348623158e308",
+        "1.7976931348623159e308",
+        /* half way between 2^53 and 2^53+2, then just above it */
+        "9007199254740993",
+        "9007199254740993.0000000000000000001",
+        "0.1000000000000000055511151231257827021181583404541015625",
+        "123456789012345678901234567890",
+        "7.2057594037927933e16",
+        "1e23",
+        "8.98846567431158e307",
+        "1e-400",
+        "1e400",
+    };
+    d_vector(char) p = DV_INIT;
+    char buf[1024];
+    double d, up;
+    int64_t v;
+    int i;
+
+    /* syntax and consumed length */
+    check_int(dv_parse_number(C("1.5x"), &d), 3);
+    check(d == 1.5);
+    check_int(dv_parse_number(C("-.5"), &d), 3);
+    check(d == -0.5);
+    check_int(dv_parse_number(C("+2."), &d), 3);
+    check(d == 2);
+    check_int(dv_parse_number(C("3e"), &d), 1);
+    check(d == 3);
+    check_int(dv_parse_number(C("3e+x"), &d), 1);
+    check_int(dv_parse_number(C("3E-2"), &d), 4);
+    check(d == 0.03);
+    check_int(dv_parse_number(C("1e999999999999"), &d), 14);
+    check(d == HUGE_VAL);
+    check_int(dv_parse_number(C("-1e-999999999999"), &d), 16);
+    check(d == 0 && signbit(d));
+    check_int(dv_parse_number(C("-0"), &d), 2);
+    check(d == 0 && signbit(d));
+    check_int(dv_parse_number(C("."), &d), 0);
+    check_int(dv_parse_number(C("-"), &d), 0);
+    check_int(dv_parse_number(C("e5"), &d), 0);
+    check_int(dv_parse_number(C(""), &d), 0);
+    check_int(dv_parse_number(C("-Infinity"), &d), 9);
+    check(d == -HUGE_VAL);
+    check_int(dv_parse_number(C("INFx"), &d), 3);
+    check(d == HUGE_VAL);
+    check_int(dv_parse_number(C("nan"), &d), 3);
+    check(isnan(d));
+
+    /* the slice doesn't need to be null terminated */
+    check_int(dv_parse_number(dv_char2("12345", 2), &d), 2);
+    check(d == 12);
+
+    for (i = 0; i < (int) (sizeof(hard) / sizeof(hard[0])); i++) {
+        check_strtod(hard[i]);
+    }
+
+    /* random doubles at every precision and the exact decimal expansions of
+     * the midpoints between neighbouring doubles, which need the slow path */
+    for (i = 0; i < 20000; i++) {
+        uint64_t bits = next_random() & ~((uint64_t) 1 << 63);
+        memcpy(&d, &bits, sizeof(d));
+        if (isnan(d) || isinf(d)) {
+            continue;
+        }
+        sprintf(buf, "%.*g", (int) (next_random() % 17) + 1, d);
+        check_strtod(buf);
+
+        bits++;
+        memcpy(&up, &bits, sizeof(up));
+        if (i % 20 == 0 && !isinf(up)) {
+            sprintf(buf, "%.760Le", ((long double) d + (long double) up) / 2);
+            check_strtod(buf);
+        }
+    }
+
+    /* formatting */
+    check_format(0, "0");
+    check_format(-0.0, "-0");
+    check_format(HUGE_VAL, "inf");
+    check_format(-HUGE_VAL, "-inf");
+    check_format(NAN, "nan");
+    check_format(1, "1");
+    check_format(-2.5, "-2.5");
+    check_format(0.1, "0.1");
+    check_format(0.1 + 0.2, "0.30000000000000004");
+    check_format(123.456, "123.456");
+    check_format(1e20, "100000000000000000000");
+    check_format(1e21, "1e+21");
+    check_format(1e23, "1e+23");
+    check_format(0.000001, "0.000001");
+    check_format(1e-7, "1e-7");
+    check_format(1.5e300, "1.5e+300");
+    check_format(5e-324, "5e-324");
+    check_format(1.7976931348623157e308, "1.7976931348623157e+308");
+    check_format(2.2250738585072014e-308, "2.2250738585072014e-308");
+    check_format(9007199254740992.0, "9007199254740992");
+
+    /* formatted doubles parse back exactly and are no longer than the
+     * shortest %.*e that does */
+    for (i = 0; i < 20000; i++) {
+        d_vector(char) p = DV_INIT;
+        uint64_t bits = next_random();
+        int prec, digits = 0, k = 0;
+        dv_size_t j;
+
+        memcpy(&d, &bits, sizeof(d));
+        if (isnan(d) || isinf(d)) {
+            continue;
+        }
+
+        dv_append_number(&p, d);
+        check(dv_parse_number(p, &up) == p.size);
+        check(memcmp(&up, &d, sizeof(d)) == 0);
+
+        for (prec = 1; prec < 17; prec++) {
+            sprintf(buf, "%.*e", prec - 1, d);
+            if (strtod(buf, NULL) == d) {
+                break;
+            }
+        }
+        /* count significant digits, ignoring leading and trailing zeros */
+        for (j = 0; j < p.size && p.data[j] != 'e'; j++) {
+            if ('1' <= p.data[j] && p.data[j] <= '9') {
+                digits = ++k;
+            } else if (p.data[j] == '0' && k) {
+                k++;
+            }
+        }
+        check(digits <= prec);
+        dv_free(p);
+    }
+
+    /* integers */
+    check_int(dv_parse_integer(C("-234 "), 10, &v), 4);
+    check(v == -234);
+    check_int(dv_parse_integer(C("9223372036854775807"), 10, &v), 19);
+    check(v == INT64_MAX);
+    check_int(dv_parse_integer(C("-9223372036854775808"), 10, &v), 20);
+    check(v == INT64_MIN);
+    check_int(dv_parse_integer(C("9223372036854775808"), 10, &v), -1);
+    check_int(dv_parse_integer(C("-9223372036854775809"), 10, &v), -1);
+    check_int(dv_parse_integer(C("99999999999999999999999"), 10, &v), -1);
+    check_int(dv_parse_integer(C("0x1fZ"), 16, &v), 4);
+    check(v == 0x1F);
+    check_int(dv_parse_integer(C("0x1f"), 0, &v), 4);
+    check(v == 0x1F);
+    check_int(dv_parse_integer(C("017"), 0, &v), 3);
+    check(v == 017);
+    check_int(dv_parse_integer(C("0xg"), 0, &v), 1);
+    check(v == 0);
+    check_int(dv_parse_integer(C("1012"), 2, &v), 3);
+    check(v == 5);
+    check_int(dv_parse_integer(C("zZ"), 36, &v), 2);
+    check(v == 35 * 36 + 35);
+    check_int(dv_parse_integer(C("-"), 10, &v), 0);
+    check_int(dv_parse_integer(C("1"), 37, &v), 0);
+
+    check_int(dv_to_integer(C(" -234 "), 10, 0), -234);
+    check_int(dv_to_integer(C("2147483647"), 10, 0), INT_MAX);
+    check_int(dv_to_integer(C("2147483648"), 10, 7), 7);
+    check_int(dv_to_integer(C("12x"), 10, 7), 7);
+    check_int(dv_to_integer(C(""), 10, 7), 7);
+    check_int(dv_to_integer(C("1 2"), 10, 7), 1);
+
+    dv_init(&p);
+    dv_append_integer(&p, 0);
+    dv_append_integer(&p, -7);
+    dv_append_integer(&p, 1234567890);
+    dv_append_integer(&p, INT64_MIN);
+    dv_append_integer(&p, INT64_MAX);
+    check_string(p, C("0-71234567890-92233720368547758089223372036854775807"));
+    dv_free(p);
+
+    check(dv_to_number(C(" 234.1")) == 234.1);
+    check(dv_to_number(C("234.1x")) == 0);
+    check(isnan(dv_to_number(C(""))));
+
+    /* a locale with a decimal comma doesn't change anything */
+    if (setlocale(LC_NUMERIC, "de_DE.UTF-8") || setlocale(LC_NUMERIC, "fr_FR.UTF-8")) {
+        check_int(dv_parse_number(C("1.5"), &d), 3);
+        check(d == 1.5);
+        setlocale(LC_NUMERIC, "C");
+    }
+
+    return 0;
+}
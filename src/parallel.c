@@ -0,0 +1,834 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#define _GNU_SOURCE
+#define DMEM_LIBRARY
+#include <dmem/parallel.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <assert.h>
+
+#define ATOMIC_ADD(P, N) __atomic_add_fetch(P, N, __ATOMIC_SEQ_CST)
+#define ATOMIC_GET(P) __atomic_load_n(P, __ATOMIC_SEQ_CST)
+#define ATOMIC_SET(P, V) __atomic_store_n(P, V, __ATOMIC_SEQ_CST)
+
+#define DEQUE_SIZE 256
+
+typedef struct job job;
+typedef struct task task;
+typedef struct worker worker;
+
+struct job {
+    dp_range_fn func;
+    void* udata;
+    dv_size_t grain;
+    dv_size_t pending;
+};
+
+struct task {
+    job* j;
+    dv_size_t begin;
+    dv_size_t end;
+};
+
+/* Each worker owns a deque of tasks. The owner pushes and pops at the
+ * bottom and thieves take from the top, where the largest pieces are. The
+ * deques are short and rarely contended so a spin lock is enough. */
+struct worker {
+    dp_pool* pool;
+    pthread_t thread;
+    int lock;
+    unsigned top;
+    unsigned bottom;
+    unsigned seed;
+    task tasks[DEQUE_SIZE];
+};
+
+struct dp_pool {
+    int threads;
+    dv_size_t serial_threshold;
+    worker* workers;
+
+    /* workers[0] is borrowed by the thread calling into the pool */
+    pthread_mutex_t caller;
+
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t wake;
+    int sleepers;
+    unsigned epoch;
+    bool stop;
+};
+
+static __thread worker* g_worker;
+
+/* ------------------------------------------------------------------------- */
+
+static void lock_deque(worker* w)
+{
+    while (__atomic_exchange_n(&w->lock, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&w->lock, __ATOMIC_RELAXED)) {
+        }
+    }
+}
+
+static void unlock_deque(worker* w)
+{ __atomic_store_n(&w->lock, 0, __ATOMIC_RELEASE); }
+
+static bool push(worker* w, task t)
+{
+    dp_pool* p = w->pool;
+
+    lock_deque(w);
+    if (w->bottom - w->top == DEQUE_SIZE) {
+        unlock_deque(w);
+        return false;
+    }
+    w->tasks[w->bottom++ % DEQUE_SIZE] = t;
+    unlock_deque(w);
+
+    /* Pairs with the epoch check in the worker before it sleeps */
+    ATOMIC_ADD(&p->epoch, 1);
+    if (ATOMIC_GET(&p->sleepers)) {
+        pthread_mutex_lock(&p->sleep_lock);
+        pthread_cond_signal(&p->wake);
+        pthread_mutex_unlock(&p->sleep_lock);
+    }
+
+    return true;
+}
+
+static bool pop(worker* w, task* t)
+{
+    bool ret = false;
+    lock_deque(w);
+    if (w->bottom != w->top) {
+        *t = w->tasks[--w->bottom % DEQUE_SIZE];
+        ret = true;
+    }
+    unlock_deque(w);
+    return ret;
+}
+
+static bool steal(worker* w, task* t)
+{
+    bool ret = false;
+    lock_deque(w);
+    if (w->bottom != w->top) {
+        *t = w->tasks[w->top++ % DEQUE_SIZE];
+        ret = true;
+    }
+    unlock_deque(w);
+    return ret;
+}
+
+static bool find_task(worker* w, task* t)
+{
+    dp_pool* p = w->pool;
+    int i, start;
+
+    if (pop(w, t)) {
+        return true;
+    }
+
+    w->seed = w->seed * 1103515245 + 12345;
+    start = (int) ((w->seed >> 16) % (unsigned) p->threads);
+
+    for (i = 0; i < p->threads; i++) {
+        worker* v = &p->workers[(start + i) % p->threads];
+        if (v != w && steal(v, t)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void run_task(worker* w, task t)
+{
+    job* j = t.j;
+
+    /* Split off the top half until we're down to the grain */
+    while (t.end - t.begin > j->grain) {
+        task top = t;
+        top.begin = t.begin + (t.end - t.begin) / 2;
+        if (!push(w, top)) {
+            break;
+        }
+        t.end = top.begin;
+    }
+
+    j->func(j->udata, t.begin, t.end);
+    ATOMIC_ADD(&j->pending, -(t.end - t.begin));
+}
+
+static void* worker_main(void* udata)
+{
+    worker* w = (worker*) udata;
+    dp_pool* p = w->pool;
+    task t;
+
+    g_worker = w;
+
+    /* wait for dp_new_pool to finish starting workers, as it lowers
+     * p->threads if it can't start them all */
+    pthread_mutex_lock(&p->sleep_lock);
+    pthread_mutex_unlock(&p->sleep_lock);
+
+    for (;;) {
+        unsigned epoch = ATOMIC_GET(&p->epoch);
+        int spins;
+
+        for (spins = 0; spins < 64; spins++) {
+            if (find_task(w, &t)) {
+                break;
+            }
+            sched_yield();
+        }
+
+        if (spins < 64) {
+            run_task(w, t);
+            continue;
+        }
+
+        pthread_mutex_lock(&p->sleep_lock);
+        ATOMIC_ADD(&p->sleepers, 1);
+        while (!p->stop && ATOMIC_GET(&p->epoch) == epoch) {
+            pthread_cond_wait(&p->wake, &p->sleep_lock);
+        }
+        ATOMIC_ADD(&p->sleepers, -1);
+        if (p->stop) {
+            pthread_mutex_unlock(&p->sleep_lock);
+            return NULL;
+        }
+        pthread_mutex_unlock(&p->sleep_lock);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+dp_pool* dp_new_pool(int threads)
+{
+    dp_pool* p;
+    int i;
+
+    if (threads <= 0) {
+        threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        if (threads <= 0) {
+            threads = 1;
+        }
+    }
+
+    p = NEW(dp_pool);
+    if (!p) {
+        return NULL;
+    }
+
+    p->workers = (worker*) calloc(threads, sizeof(worker));
+    if (!p->workers) {
+        free(p);
+        return NULL;
+    }
+
+    p->threads = threads;
+    p->serial_threshold = 16384;
+    pthread_mutex_init(&p->caller, NULL);
+    pthread_mutex_init(&p->sleep_lock, NULL);
+    pthread_cond_init(&p->wake, NULL);
+
+    for (i = 0; i < threads; i++) {
+        p->workers[i].pool = p;
+        p->workers[i].seed = (unsigned) i;
+    }
+
+    /* dp_free_pool only joins the first p->threads workers, so stop at the
+     * first thread that fails to start */
+    pthread_mutex_lock(&p->sleep_lock);
+    for (i = 1; i < threads; i++) {
+        if (pthread_create(&p->workers[i].thread, NULL, &worker_main, &p->workers[i])) {
+            p->threads = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&p->sleep_lock);
+
+    return p;
+}
+
+void dp_free_pool(dp_pool* p)
+{
+    int i;
+
+    if (!p) {
+        return;
+    }
+
+    pthread_mutex_lock(&p->sleep_lock);
+    p->stop = true;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->sleep_lock);
+
+    /* Any pool cache a worker built up moves to the shared lists as it
+     * exits (see pool_thread_exit in vector.c) */
+    for (i = 1; i < p->threads; i++) {
+        pthread_join(p->workers[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&p->wake);
+    pthread_mutex_destroy(&p->sleep_lock);
+    pthread_mutex_destroy(&p->caller);
+    free(p->workers);
+    free(p);
+}
+
+int dp_threads(const dp_pool* p)
+{ return p ? p->threads : 1; }
+
+void dp_set_serial_threshold(dp_pool* p, dv_size_t num)
+{
+    if (p) {
+        p->serial_threshold = num;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+void dp_for(dp_pool* p, dv_size_t num, dv_size_t grain, dp_range_fn func, void* udata)
+{
+    worker* w = g_worker;
+    worker* prev = w;
+    job j;
+    task t;
+
+    if (grain < 1) {
+        grain = 1;
+    }
+
+    if (!p || p->threads == 1 || num <= grain) {
+        if (num > 0) {
+            func(udata, 0, num);
+        }
+        return;
+    }
+
+    /* Calls from outside the pool borrow the first worker, calls from a
+     * task on the pool use the worker running it */
+    if (!w || w->pool != p) {
+        pthread_mutex_lock(&p->caller);
+        w = &p->workers[0];
+        g_worker = w;
+    }
+
+    j.func = func;
+    j.udata = udata;
+    j.grain = grain;
+    j.pending = num;
+
+    t.j = &j;
+    t.begin = 0;
+    t.end = num;
+    run_task(w, t);
+
+    /* Help out with whatever is queued until our job is done */
+    while (ATOMIC_GET(&j.pending) > 0) {
+        if (find_task(w, &t)) {
+            run_task(w, t);
+        } else {
+            sched_yield();
+        }
+    }
+
+    if (w != prev) {
+        g_worker = prev;
+        pthread_mutex_unlock(&p->caller);
+    }
+}
+
+/* Splits 'num' values into ranges of at least the serial threshold with a
+ * few per thread so that stealing can balance the load */
+static dv_size_t grain_size(dp_pool* p, dv_size_t num)
+{
+    dv_size_t grain;
+
+    if (!p || num <= p->serial_threshold) {
+        return num;
+    }
+
+    grain = num / (p->threads * 8);
+    return grain > p->serial_threshold ? grain : p->serial_threshold;
+}
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct each_ctx each_ctx;
+
+struct each_ctx {
+    char* data;
+    const char* from;
+    int typesz;
+    int fromtypesz;
+    dp_each_fn each;
+    dp_transform_fn transform;
+    void* udata;
+};
+
+static void each_range(void* udata, dv_size_t begin, dv_size_t end)
+{
+    each_ctx* c = (each_ctx*) udata;
+    c->each(c->udata, c->data + begin * c->typesz, end - begin);
+}
+
+void dp_for_each_base(dp_pool* p, void* data, dv_size_t num, int typesz, dp_each_fn func, void* udata)
+{
+    each_ctx c;
+    c.data = (char*) data;
+    c.typesz = typesz;
+    c.each = func;
+    c.udata = udata;
+    dp_for(p, num, grain_size(p, num), &each_range, &c);
+}
+
+static void transform_range(void* udata, dv_size_t begin, dv_size_t end)
+{
+    each_ctx* c = (each_ctx*) udata;
+    c->transform(c->udata, c->data + begin * c->typesz, c->from + begin * c->fromtypesz, end - begin);
+}
+
+void dp_transform_base(dp_pool* p, void* to, int totypesz, const void* from, int fromtypesz, dv_size_t num, dp_transform_fn func, void* udata)
+{
+    each_ctx c;
+    c.data = (char*) to;
+    c.typesz = totypesz;
+    c.from = (const char*) from;
+    c.fromtypesz = fromtypesz;
+    c.transform = func;
+    c.udata = udata;
+    dp_for(p, num, grain_size(p, num), &transform_range, &c);
+}
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct reduce_ctx reduce_ctx;
+
+struct reduce_ctx {
+    const char* data;
+    dv_size_t num;
+    int typesz;
+    char* accs;
+    int accsz;
+    dv_size_t grain;
+    dp_reduce_fn reduce;
+    void* udata;
+};
+
+static void reduce_range(void* udata, dv_size_t begin, dv_size_t end)
+{
+    reduce_ctx* c = (reduce_ctx*) udata;
+    dv_size_t i;
+
+    for (i = begin; i < end; i++) {
+        dv_size_t from = i * c->grain;
+        dv_size_t to = from + c->grain < c->num ? from + c->grain : c->num;
+        c->reduce(c->udata, c->accs + i * c->accsz, c->data + from * c->typesz, to - from);
+    }
+}
+
+void dp_reduce_base(dp_pool* p, const void* data, dv_size_t num, int typesz, void* acc, int accsz, dp_reduce_fn reduce, dp_combine_fn combine, void* udata)
+{
+    reduce_ctx c;
+    dv_size_t i, runs;
+
+    c.grain = grain_size(p, num);
+
+    if (c.grain >= num) {
+        if (num > 0) {
+            reduce(udata, acc, data, num);
+        }
+        return;
+    }
+
+    runs = (num + c.grain - 1) / c.grain;
+    c.data = (const char*) data;
+    c.num = num;
+    c.typesz = typesz;
+    c.accs = (char*) malloc((size_t) runs * accsz);
+    c.accsz = accsz;
+    c.reduce = reduce;
+    c.udata = udata;
+
+    for (i = 0; i < runs; i++) {
+        memcpy(c.accs + i * accsz, acc, accsz);
+    }
+
+    dp_for(p, runs, 1, &reduce_range, &c);
+
+    for (i = 0; i < runs; i++) {
+        combine(udata, acc, c.accs + i * accsz);
+    }
+
+    free(c.accs);
+}
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct filter_ctx filter_ctx;
+
+struct filter_ctx {
+    char* data;
+    dv_size_t num;
+    int typesz;
+    dv_size_t grain;
+    dv_size_t* kept;
+    dp_keep_fn keep;
+    void* udata;
+};
+
+/* Compacts each run in place, recording how many values it kept */
+static void filter_range(void* udata, dv_size_t begin, dv_size_t end)
+{
+    filter_ctx* c = (filter_ctx*) udata;
+    dv_size_t i, j;
+
+    for (i = begin; i < end; i++) {
+        dv_size_t from = i * c->grain;
+        dv_size_t to = from + c->grain < c->num ? from + c->grain : c->num;
+        char* w = c->data + from * c->typesz;
+
+        for (j = from; j < to; j++) {
+            char* r = c->data + j * c->typesz;
+            if (c->keep(c->udata, r)) {
+                if (w != r) {
+                    memcpy(w, r, c->typesz);
+                }
+                w += c->typesz;
+            }
+        }
+
+        c->kept[i] = (dv_size_t) ((w - (c->data + from * c->typesz)) / c->typesz);
+    }
+}
+
+void dp_filter_base(dp_pool* p, struct dv_base* v, int typesz, dp_keep_fn keep, void* udata)
+{
+    filter_ctx c;
+    dv_size_t i, runs, size;
+
+    c.data = (char*) v->data;
+    c.num = v->size;
+    c.typesz = typesz;
+    c.grain = grain_size(p, v->size);
+    c.keep = keep;
+    c.udata = udata;
+
+    if (c.num == 0) {
+        return;
+    }
+
+    runs = (c.num + c.grain - 1) / c.grain;
+    c.kept = (dv_size_t*) malloc(runs * sizeof(dv_size_t));
+
+    dp_for(p, runs, 1, &filter_range, &c);
+
+    /* Close up the gaps left at the end of each run. Runs only move down so
+     * they can be moved in order. */
+    size = c.kept[0];
+    for (i = 1; i < runs; i++) {
+        memmove(c.data + size * typesz, c.data + i * c.grain * typesz, c.kept[i] * typesz);
+        size += c.kept[i];
+    }
+
+    free(c.kept);
+
+    v->size = size;
+    v->data = dv_resize_base(v->data, size * typesz);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Sorting sorts a run per thread in parallel and then merges pairs of runs
+ * back and forth between the data and a temporary buffer until one run is
+ * left. Each merge is split into pieces of the output, finding where the
+ * piece starts in the two inputs with a binary search, so all the threads
+ * are still busy in the last rounds. */
+typedef struct sort_ctx sort_ctx;
+typedef struct merge_piece merge_piece;
+
+struct merge_piece {
+    const char* a;
+    dv_size_t an;
+    const char* b;
+    dv_size_t bn;
+    char* out;
+    dv_size_t begin;
+    dv_size_t end;
+};
+
+struct sort_ctx {
+    char* data;
+    int typesz;
+    bool is_signed;
+    int (*cmp)(const void*, const void*);
+    bool (*less)(sort_ctx* c, const void* a, const void* b);
+    void (*merge)(sort_ctx* c, char* out, const char* a, dv_size_t an, const char* b, dv_size_t bn);
+    dv_size_t* bounds;
+    merge_piece* pieces;
+};
+
+static bool cmp_less(sort_ctx* c, const void* a, const void* b)
+{ return c->cmp(a, b) < 0; }
+
+static void cmp_merge(sort_ctx* c, char* out, const char* a, dv_size_t an, const char* b, dv_size_t bn)
+{
+    int sz = c->typesz;
+    const char* ae = a + an * sz;
+    const char* be = b + bn * sz;
+
+    while (a < ae && b < be) {
+        if (c->cmp(b, a) < 0) {
+            memcpy(out, b, sz);
+            b += sz;
+        } else {
+            memcpy(out, a, sz);
+            a += sz;
+        }
+        out += sz;
+    }
+
+    memcpy(out, a, ae - a);
+    memcpy(out + (ae - a), b, be - b);
+}
+
+#define INT_MERGE(T)                                                        \
+    static bool less_##T(sort_ctx* c, const void* a, const void* b)         \
+    { (void) c; return *(const T*) a < *(const T*) b; }                     \
+                                                                            \
+    static void merge_##T(sort_ctx* c, char* out,                          \
+            const char* a, dv_size_t an, const char* b, dv_size_t bn)       \
+    {                                                                       \
+        T* o = (T*) out;                                                    \
+        const T* pa = (const T*) a;                                         \
+        const T* pb = (const T*) b;                                         \
+        const T* ae = pa + an;                                              \
+        const T* be = pb + bn;                                              \
+        (void) c;                                                           \
+        while (pa < ae && pb < be) {                                        \
+            *o++ = (*pb < *pa) ? *pb++ : *pa++;                             \
+        }                                                                   \
+        memcpy(o, pa, (ae - pa) * sizeof(T));                               \
+        memcpy(o + (ae - pa), pb, (be - pb) * sizeof(T));                   \
+    }
+
+INT_MERGE(int8_t)
+INT_MERGE(uint8_t)
+INT_MERGE(int16_t)
+INT_MERGE(uint16_t)
+INT_MERGE(int32_t)
+INT_MERGE(uint32_t)
+INT_MERGE(int64_t)
+INT_MERGE(uint64_t)
+
+static void sort_run(void* udata, dv_size_t begin, dv_size_t end)
+{
+    sort_ctx* c = (sort_ctx*) udata;
+    dv_size_t i;
+
+    for (i = begin; i < end; i++) {
+        char* data = c->data + c->bounds[i] * c->typesz;
+        dv_size_t num = c->bounds[i+1] - c->bounds[i];
+        if (c->cmp) {
+            qsort(data, num, c->typesz, c->cmp);
+        } else {
+            dv_radix_sort_base(data, num, c->typesz, c->is_signed);
+        }
+    }
+}
+
+/* Returns how many values come from 'a' in the first 'k' values of the
+ * merge of 'a' and 'b'. Ties are taken from 'a' first. */
+static dv_size_t merge_split(sort_ctx* c, dv_size_t k, const char* a, dv_size_t an, const char* b, dv_size_t bn)
+{
+    int sz = c->typesz;
+    dv_size_t lo = k > bn ? k - bn : 0;
+    dv_size_t hi = k < an ? k : an;
+
+    while (lo < hi) {
+        dv_size_t i = lo + (hi - lo) / 2;
+        dv_size_t j = k - i;
+        if (j > 0 && !c->less(c, b + (j - 1) * sz, a + i * sz)) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+
+    return lo;
+}
+
+static void merge_range(void* udata, dv_size_t begin, dv_size_t end)
+{
+    sort_ctx* c = (sort_ctx*) udata;
+    int sz = c->typesz;
+    dv_size_t n;
+
+    for (n = begin; n < end; n++) {
+        merge_piece* m = &c->pieces[n];
+        dv_size_t i0 = merge_split(c, m->begin, m->a, m->an, m->b, m->bn);
+        dv_size_t i1 = merge_split(c, m->end, m->a, m->an, m->b, m->bn);
+        dv_size_t j0 = m->begin - i0;
+        dv_size_t j1 = m->end - i1;
+        c->merge(c, m->out + m->begin * sz, m->a + i0 * sz, i1 - i0, m->b + j0 * sz, j1 - j0);
+    }
+}
+
+static void copy_range(void* udata, dv_size_t begin, dv_size_t end)
+{
+    merge_piece* m = (merge_piece*) udata;
+    memcpy(m->out + begin, m->a + begin, end - begin);
+}
+
+static void parallel_sort(dp_pool* p, sort_ctx* c, dv_size_t num)
+{
+    int sz = c->typesz;
+    int runs = p->threads;
+    dv_size_t piece = num / p->threads + 1;
+    char* src = c->data;
+    char* tmp = (char*) malloc((size_t) num * sz);
+    char* dst = tmp;
+    int i;
+
+    c->bounds = (dv_size_t*) malloc((runs + 1) * sizeof(dv_size_t));
+    c->pieces = (merge_piece*) malloc((p->threads + runs) * sizeof(merge_piece));
+
+    for (i = 0; i <= runs; i++) {
+        c->bounds[i] = (dv_size_t) ((int64_t) num * i / runs);
+    }
+
+    dp_for(p, runs, 1, &sort_run, c);
+
+    while (runs > 1) {
+        int pieces = 0;
+
+        for (i = 0; i + 1 < runs; i += 2) {
+            dv_size_t lo = c->bounds[i];
+            dv_size_t mid = c->bounds[i+1];
+            dv_size_t hi = c->bounds[i+2];
+            dv_size_t k;
+
+            for (k = 0; k < hi - lo; k += piece) {
+                merge_piece* m = &c->pieces[pieces++];
+                m->a = src + lo * sz;
+                m->an = mid - lo;
+                m->b = src + mid * sz;
+                m->bn = hi - mid;
+                m->out = dst + lo * sz;
+                m->begin = k;
+                m->end = k + piece < hi - lo ? k + piece : hi - lo;
+            }
+        }
+
+        /* An odd run out is merged with nothing */
+        if (runs & 1) {
+            dv_size_t lo = c->bounds[runs-1];
+            merge_piece* m = &c->pieces[pieces++];
+            m->a = src + lo * sz;
+            m->an = num - lo;
+            m->b = m->a;
+            m->bn = 0;
+            m->out = dst + lo * sz;
+            m->begin = 0;
+            m->end = num - lo;
+        }
+
+        dp_for(p, pieces, 1, &merge_range, c);
+
+        for (i = 0; 2 * i < runs; i++) {
+            c->bounds[i] = c->bounds[2 * i];
+        }
+        runs = (runs + 1) / 2;
+        c->bounds[runs] = num;
+
+        dst = src;
+        src = (dst == tmp) ? c->data : tmp;
+    }
+
+    if (src != c->data) {
+        merge_piece m;
+        m.a = src;
+        m.out = c->data;
+        dp_for(p, (dv_size_t) num * sz, grain_size(p, (dv_size_t) num * sz), &copy_range, &m);
+    }
+
+    free(c->pieces);
+    free(c->bounds);
+    free(tmp);
+}
+
+void dp_sort_base(dp_pool* p, void* data, dv_size_t num, int typesz, int (*cmp)(const void*, const void*))
+{
+    sort_ctx c;
+
+    if (!p || p->threads == 1 || num <= p->serial_threshold) {
+        qsort(data, num, typesz, cmp);
+        return;
+    }
+
+    memset(&c, 0, sizeof(c));
+    c.data = (char*) data;
+    c.typesz = typesz;
+    c.cmp = cmp;
+    c.less = &cmp_less;
+    c.merge = &cmp_merge;
+    parallel_sort(p, &c, num);
+}
+
+void dp_radix_sort_base(dp_pool* p, void* data, dv_size_t num, int typesz, bool is_signed)
+{
+    sort_ctx c;
+
+    if (!p || p->threads == 1 || num <= p->serial_threshold) {
+        dv_radix_sort_base(data, num, typesz, is_signed);
+        return;
+    }
+
+    memset(&c, 0, sizeof(c));
+    c.data = (char*) data;
+    c.typesz = typesz;
+    c.is_signed = is_signed;
+
+    switch (typesz * 2 + is_signed) {
+    case 2: c.less = &less_uint8_t; c.merge = &merge_uint8_t; break;
+    case 3: c.less = &less_int8_t; c.merge = &merge_int8_t; break;
+    case 4: c.less = &less_uint16_t; c.merge = &merge_uint16_t; break;
+    case 5: c.less = &less_int16_t; c.merge = &merge_int16_t; break;
+    case 8: c.less = &less_uint32_t; c.merge = &merge_uint32_t; break;
+    case 9: c.less = &less_int32_t; c.merge = &merge_int32_t; break;
+    case 16: c.less = &less_uint64_t; c.merge = &merge_uint64_t; break;
+    case 17: c.less = &less_int64_t; c.merge = &merge_int64_t; break;
+    default: assert(0); return;
+    }
+
+    parallel_sort(p, &c, num);
+}
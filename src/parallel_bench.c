@@ -0,0 +1,124 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#include "bench.h"
+#include <dmem/parallel.h>
+
+/* Reports the speedup of the parallel algorithms at 1, 4, 16 and 64
+ * threads over the serial versions: sorting int64 values (100M by default,
+ * set with the first argument in millions) and transforming a 256MB char
+ * buffer.
+ */
+
+DVECTOR_INIT(i64, int64_t);
+
+#define CHARS (256 << 20)
+
+static void fill(d_vector(i64)* v, dv_size_t num)
+{
+    uint64_t seed = 1;
+    dv_size_t i;
+
+    dv_resize(v, num);
+    for (i = 0; i < num; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        v->data[i] = (int64_t) seed;
+    }
+}
+
+/* A cheap per byte transform that is limited by memory bandwidth */
+static void rot13(void* udata, void* to, const void* from, dv_size_t num)
+{
+    char* t = (char*) to;
+    const char* f = (const char*) from;
+    dv_size_t i;
+    (void) udata;
+
+    for (i = 0; i < num; i++) {
+        char c = f[i];
+        if ('a' <= c && c <= 'z') {
+            c = 'a' + (c - 'a' + 13) % 26;
+        }
+        t[i] = c;
+    }
+}
+
+static void report(const char* name, int threads, double serial, double t)
+{
+    printf("%-40s %3d threads %10.1f ms %6.2fx\n", name, threads, t * 1e3, serial / t);
+}
+
+int main(int argc, char* argv[])
+{
+    static const int threads[] = {1, 4, 16, 64};
+    d_vector(i64) v = DV_INIT;
+    d_vector(char) from = DV_INIT;
+    d_vector(char) to = DV_INIT;
+    dv_size_t num = (dv_size_t) (argc > 1 ? atoi(argv[1]) : 100) * 1000000;
+    double begin, serial;
+    int i;
+
+    printf("sorting %d M int64, transforming %d MB\n", (int) (num / 1000000), CHARS >> 20);
+
+    fill(&v, num);
+    begin = bench_time();
+    dv_sort_int(&v);
+    serial = bench_time() - begin;
+    report("sort int64 (dv_sort_int)", 1, serial, serial);
+
+    for (i = 0; i < 4; i++) {
+        dp_pool* p = dp_new_pool(threads[i]);
+        fill(&v, num);
+        begin = bench_time();
+        dp_sort_int(p, &v);
+        report("sort int64 (dp_sort_int)", threads[i], serial, bench_time() - begin);
+        dp_free_pool(p);
+    }
+
+    dv_free(v);
+
+    dv_resize(&from, CHARS);
+    memset(from.data, 'n', CHARS);
+    dv_resize(&to, CHARS);
+    memset(to.data, 0, CHARS);
+
+    begin = bench_time();
+    rot13(NULL, to.data, from.data, from.size);
+    serial = bench_time() - begin;
+    report("transform chars (serial)", 1, serial, serial);
+
+    for (i = 0; i < 4; i++) {
+        dp_pool* p = dp_new_pool(threads[i]);
+        begin = bench_time();
+        dp_transform(p, &to, from, &rot13, NULL);
+        report("transform chars (dp_transform)", threads[i], serial, bench_time() - begin);
+        dp_free_pool(p);
+    }
+
+    dv_free(from);
+    dv_free(to);
+    return 0;
+}
@@ -0,0 +1,248 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#include <dmem/parallel.h>
+#include "test.h"
+
+DVECTOR_INIT(int, int);
+DVECTOR_INIT(i64, int64_t);
+DVECTOR_INIT(u8, uint8_t);
+
+typedef struct Order Order;
+struct Order {
+    int first;
+    int last;
+    int sum;
+    bool ordered;
+};
+
+static void add_one(void* udata, void* data, dv_size_t num)
+{
+    int* p = (int*) data;
+    dv_size_t i;
+    (void) udata;
+    for (i = 0; i < num; i++) {
+        p[i]++;
+    }
+}
+
+static void square(void* udata, void* to, const void* from, dv_size_t num)
+{
+    int64_t* t = (int64_t*) to;
+    const int* f = (const int*) from;
+    dv_size_t i;
+    (void) udata;
+    for (i = 0; i < num; i++) {
+        t[i] = (int64_t) f[i] * f[i];
+    }
+}
+
+/* Checks the runs are combined in order */
+static void reduce_order(void* udata, void* acc, const void* data, dv_size_t num)
+{
+    Order* o = (Order*) acc;
+    const int* p = (const int*) data;
+    dv_size_t i;
+    (void) udata;
+    for (i = 0; i < num; i++) {
+        if (o->first < 0) {
+            o->first = p[i];
+        } else if (p[i] != o->last + 1) {
+            o->ordered = false;
+        }
+        o->last = p[i];
+        o->sum += p[i] & 1;
+    }
+}
+
+static void combine_order(void* udata, void* acc, const void* other)
+{
+    Order* o = (Order*) acc;
+    const Order* r = (const Order*) other;
+    (void) udata;
+    if (r->first < 0) {
+        return;
+    }
+    if (o->first < 0) {
+        *o = *r;
+        return;
+    }
+    o->ordered = o->ordered && r->ordered && r->first == o->last + 1;
+    o->last = r->last;
+    o->sum += r->sum;
+}
+
+static void alloc_free(void* udata, dv_size_t begin, dv_size_t end)
+{
+    (void) udata;
+    for (; begin < end; begin++) {
+        d_vector(int) v = DV_INIT;
+        dv_resize(&v, (dv_size_t) (100 << (begin & 7)));
+        dv_free(v);
+    }
+}
+
+static bool keep_even(void* udata, const void* value)
+{
+    (void) udata;
+    return (*(const int*) value & 1) == 0;
+}
+
+static int cmp_int(const void* a, const void* b)
+{
+    int ia = *(const int*) a;
+    int ib = *(const int*) b;
+    return ia < ib ? -1 : ia > ib;
+}
+
+int main(void)
+{
+    static const int threads[] = {1, 3, 4, 16};
+    d_vector(int) v = DV_INIT;
+    d_vector(i64) sq = DV_INIT;
+    d_vector(i64) i64 = DV_INIT;
+    d_vector(u8) u8 = DV_INIT;
+    uint64_t seed = 1;
+    dv_size_t i;
+    int t;
+
+    /* a NULL pool, as returned when the pool can't be allocated, runs
+     * everything on the calling thread */
+    check(dp_threads(NULL) == 1);
+    dp_set_serial_threshold(NULL, 100);
+    dp_free_pool(NULL);
+
+    for (t = 0; t < (int) (sizeof(threads) / sizeof(threads[0])); t++) {
+        dp_pool* p = dp_new_pool(threads[t]);
+        Order o;
+        bool ok;
+
+        check_int(dp_threads(p), threads[t]);
+        dp_set_serial_threshold(p, 100);
+
+        dv_clear(&v);
+        for (i = 0; i < 100000; i++) {
+            dv_append1(&v, (int) i);
+        }
+
+        /* for each and transform */
+        dp_for_each(p, v, &add_one, NULL);
+        ok = true;
+        for (i = 0; i < v.size; i++) {
+            ok = ok && v.data[i] == (int) i + 1;
+        }
+        check(ok);
+
+        dp_transform(p, &sq, v, &square, NULL);
+        check_int(sq.size, v.size);
+        ok = true;
+        for (i = 0; i < sq.size; i++) {
+            ok = ok && sq.data[i] == (int64_t) (i + 1) * (i + 1);
+        }
+        check(ok);
+
+        /* reduce */
+        o.first = -1;
+        o.last = -1;
+        o.sum = 0;
+        o.ordered = true;
+        dp_reduce(p, v, &o, &reduce_order, &combine_order, NULL);
+        check(o.ordered);
+        check_int(o.first, 1);
+        check_int(o.last, 100000);
+        check_int(o.sum, 50000);
+
+        /* filter */
+        dp_filter(p, &v, &keep_even, NULL);
+        check_int(v.size, 50000);
+        check_int(v.data[0], 2);
+        check_int(v.data[49999], 100000);
+        check_int(v.data[v.size], 0);
+        ok = true;
+        for (i = 1; i < v.size; i++) {
+            ok = ok && v.data[i] == v.data[i-1] + 2;
+        }
+        check(ok);
+
+        /* sorting */
+        dv_clear(&i64);
+        dv_clear(&u8);
+        for (i = 0; i < 100001; i++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            dv_append1(&i64, (int64_t) seed);
+            dv_append1(&u8, (uint8_t) (seed >> 56));
+            v.data[i % v.size] = (int) (seed >> 40);
+        }
+
+        dp_sort_int(p, &i64);
+        dp_sort_uint(p, &u8);
+        dp_sort(p, &v, &cmp_int);
+
+        ok = true;
+        for (i = 1; i < i64.size; i++) {
+            ok = ok && i64.data[i-1] <= i64.data[i];
+        }
+        check(ok);
+
+        ok = true;
+        for (i = 1; i < u8.size; i++) {
+            ok = ok && u8.data[i-1] <= u8.data[i];
+        }
+        check(ok);
+
+        ok = true;
+        for (i = 1; i < v.size; i++) {
+            ok = ok && v.data[i-1] <= v.data[i];
+        }
+        check(ok);
+
+        /* small inputs run serially */
+        dv_resize(&v, 10);
+        dp_for_each(p, v, &add_one, NULL);
+        dp_sort(p, &v, &cmp_int);
+
+        dp_free_pool(p);
+    }
+
+    /* blocks freed into the worker caches go back to the shared pool lists
+     * when the workers exit, so trimming releases all of them */
+    {
+        dp_pool* p = dp_new_pool(4);
+        dp_set_serial_threshold(p, 1);
+        dv_set_pool_limit(16 * 1024 * 1024);
+        dp_for(p, 100000, 1, &alloc_free, NULL);
+        dp_free_pool(p);
+        dv_pool_trim();
+        check_int(dv_pool_size(), 0);
+        dv_set_pool_limit(0);
+    }
+
+    dv_free(v);
+    dv_free(sq);
+    dv_free(i64);
+    dv_free(u8);
+    return 0;
+}
@@ -0,0 +1,81 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#define DMEM_LIBRARY
+#include <dmem/ring.h>
+
+/* ------------------------------------------------------------------------- */
+
+void dr_reserve_base(struct dr_base* r, dv_size_t newsz, int typesz)
+{
+    dv_size_t oldcap = r->capacity;
+    char* data;
+
+    if (newsz <= oldcap) {
+        return;
+    }
+
+    /* dv_resize_base grows geometrically and writes the two terminating
+     * nulls past newsz, which is past all of the old values */
+    r->data = dv_resize_base(r->data, newsz * typesz);
+    r->capacity = (dv_size_t) (dv_reserved_base(r->data) / typesz);
+    data = (char*) r->data;
+
+    /* If the values wrapped, move the part at the end of the old storage up
+     * to the end of the new storage so that the gap is in the middle */
+    if (r->begin + r->size > oldcap) {
+        dv_size_t tail = oldcap - r->begin;
+        dv_size_t newbegin = r->capacity - tail;
+        memmove(data + newbegin * typesz, data + r->begin * typesz, tail * typesz);
+        r->begin = newbegin;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+void dr_append_base(struct dr_base* r, const void* from, dv_size_t num, int typesz)
+{
+    dv_size_t end, first;
+    char* data;
+
+    if (num == 0) {
+        return;
+    }
+
+    dr_reserve_base(r, r->size + num, typesz);
+    data = (char*) r->data;
+
+    end = dri_wrap(r->begin + r->size, r->capacity);
+    first = r->capacity - end;
+    if (first > num) {
+        first = num;
+    }
+
+    memcpy(data + end * typesz, from, first * typesz);
+    memcpy(data, (const char*) from + first * typesz, (num - first) * typesz);
+    r->size += num;
+}
@@ -0,0 +1,116 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#include <dmem/ring.h>
+#include <dmem/char.h>
+#include "test.h"
+
+DRING_INIT(char, char);
+DRING_INIT(int, int);
+
+int main(void)
+{
+    d_ring(char) r = DR_INIT;
+    d_ring(int) ri;
+    d_string a, b;
+    int i;
+
+    dr_slices(r, &a, &b);
+    check_int(a.size, 0);
+    check_int(b.size, 0);
+
+    dr_append2(&r, "hello world", 11);
+    check_int(r.size, 11);
+    check(r.capacity >= 11);
+    check_int(dr_front(r), 'h');
+    check_int(dr_back(r), 'd');
+    dr_slices(r, &a, &b);
+    check_string(a, C("hello world"));
+    check_int(b.size, 0);
+
+    /* consume from the front and fill so that the data wraps */
+    dr_erase_front(&r, 6);
+    check_int(r.size, 5);
+    check_int(dr_front(r), 'w');
+    while (r.size + 2 < r.capacity) {
+        dr_push_back(&r, '.');
+    }
+    dr_append2(&r, "ab", 2);
+    check_int(r.size, r.capacity);
+    check_int(dr_back(r), 'b');
+    dr_slices(r, &a, &b);
+    check(a.data == r.data + r.begin);
+    check_int(a.size + b.size, r.size);
+    check(dv_begins_with(a, C("world")));
+    check(b.data == r.data);
+    check_int(b.data[b.size - 1], 'b');
+
+    /* growing a wrapped ring keeps the order */
+    dr_push_back(&r, 'c');
+    check(r.capacity > r.size);
+    check_int(dr_at(r, 0), 'w');
+    check_int(dr_at(r, 4), 'd');
+    check_int(dr_at(r, r.size - 3), 'a');
+    check_int(dr_at(r, r.size - 2), 'b');
+    check_int(dr_back(r), 'c');
+
+    dr_push_front(&r, '>');
+    check_int(dr_front(r), '>');
+    check_int(dr_at(r, 1), 'w');
+    dr_pop_back(&r);
+    check_int(dr_back(r), 'b');
+
+    /* emptying the ring restarts it at the beginning */
+    dr_erase_front(&r, r.size);
+    check_int(r.size, 0);
+    check_int(r.begin, 0);
+    dr_free(r);
+
+    /* push and pop at both ends */
+    dr_init(&ri);
+    for (i = 0; i < 100; i++) {
+        dr_push_back(&ri, i);
+        dr_push_front(&ri, -i);
+    }
+    check_int(ri.size, 200);
+    check_int(dr_front(ri), -99);
+    check_int(dr_back(ri), 99);
+    check_int(dr_at(ri, 99), 0);
+    check_int(dr_at(ri, 100), 0);
+    check_int(dr_at(ri, 101), 1);
+    for (i = 0; i < 50; i++) {
+        dr_pop_front(&ri);
+        dr_pop_back(&ri);
+    }
+    check_int(ri.size, 100);
+    check_int(dr_front(ri), -49);
+    check_int(dr_back(ri), 49);
+    dr_free(ri);
+
+    return 0;
+}
+
@@ -0,0 +1,82 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#define DMEM_LIBRARY
+#include <dmem/segment.h>
+
+/* ------------------------------------------------------------------------- */
+
+void dsg_reserve_base(struct dsg_base* s, dv_size_t newsz, int typesz)
+{
+    int k = s->capacity ? dsgi_block(s->capacity - 1) + 1 : 0;
+
+    while (s->capacity < newsz) {
+        dv_size_t num = dsg_block_size(k);
+        s->blocks[k] = dv_resize_base(NULL, num * typesz);
+        s->capacity += num;
+        k++;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+void dsg_append_base(struct dsg_base* s, const void* from, dv_size_t num, int typesz)
+{
+    const char* src = (const char*) from;
+
+    if (num == 0) {
+        return;
+    }
+
+    dsg_reserve_base(s, s->size + num, typesz);
+
+    /* Fill the rest of the last block and then whole blocks */
+    while (num) {
+        int k = dsgi_block(s->size);
+        dv_size_t off = dsgi_offset(s->size);
+        dv_size_t chunk = dsg_block_size(k) - off;
+        if (chunk > num) {
+            chunk = num;
+        }
+
+        memcpy((char*) s->blocks[k] + off * typesz, src, chunk * typesz);
+        src += chunk * typesz;
+        s->size += chunk;
+        num -= chunk;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+void dsg_free_base(struct dsg_base* s)
+{
+    int k;
+    for (k = 0; k < DSG_BLOCKS && s->blocks[k]; k++) {
+        dv_free_base(s->blocks[k]);
+    }
+    memset(s, 0, sizeof(*s));
+}
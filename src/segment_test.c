@@ -0,0 +1,135 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#include <dmem/segment.h>
+#include "test.h"
+
+DSEGMENT_INIT(int, int);
+DVECTOR_INIT(int, int);
+
+int main(void)
+{
+    d_segment(int) s = DSG_INIT;
+    d_vector(int) v = DV_INIT;
+    d_slice(int) slice;
+    int* first;
+    int* mid;
+    dv_size_t i, total;
+    int k;
+
+    /* index mapping */
+    check_int(dsgi_block(0), 0);
+    check_int(dsgi_offset(0), 0);
+    check_int(dsgi_block(15), 0);
+    check_int(dsgi_offset(15), 15);
+    check_int(dsgi_block(16), 1);
+    check_int(dsgi_offset(16), 0);
+    check_int(dsgi_block(47), 1);
+    check_int(dsgi_offset(47), 31);
+    check_int(dsgi_block(48), 2);
+    check_int(dsgi_offset(48), 0);
+    check_int(dsg_blocks(s), 0);
+
+    /* pointers stay valid while appending */
+    dsg_push_back(&s, 0);
+    first = &dsg_front(s);
+    for (i = 1; i < 1000; i++) {
+        dsg_push_back(&s, (int) i);
+        if (i == 500) {
+            mid = &dsg_back(s);
+        }
+    }
+    check_int(s.size, 1000);
+    check(first == &dsg_at(s, 0));
+    check(mid == &dsg_at(s, 500));
+    check_int(*first, 0);
+    check_int(*mid, 500);
+    for (i = 0; i < 1000; i++) {
+        if (dsg_at(s, i) != i) break;
+    }
+    check_int(i, 1000);
+    check_int(dsg_back(s), 999);
+
+    /* blocks cover the values in order */
+    total = 0;
+    for (k = 0; k < dsg_blocks(s); k++) {
+        dsg_block(s, k, &slice);
+        check(slice.size > 0 && slice.size <= dsg_block_size(k));
+        check_int(slice.data[0], (int) total);
+        total += slice.size;
+    }
+    check_int(total, 1000);
+
+    /* bulk append spanning several blocks */
+    for (i = 0; i < 5000; i++) {
+        dv_append1(&v, (int) (1000 + i));
+    }
+    dsg_append(&s, v);
+    check_int(s.size, 6000);
+    check(first == &dsg_at(s, 0));
+    check(mid == &dsg_at(s, 500));
+    for (i = 0; i < 6000; i++) {
+        if (dsg_at(s, i) != i) break;
+    }
+    check_int(i, 6000);
+
+    /* erase and clear keep the blocks */
+    dsg_erase_back(&s, 100);
+    check_int(s.size, 5900);
+    check_int(dsg_back(s), 5899);
+    dsg_pop_back(&s);
+    check_int(dsg_back(s), 5898);
+    total = s.capacity;
+    dsg_clear(&s);
+    check_int(s.size, 0);
+    check_int(s.capacity, total);
+    dsg_push_back(&s, 42);
+    check(first == &dsg_front(s));
+    check_int(dsg_front(s), 42);
+
+    /* resize and reserve */
+    dsg_resize(&s, 20000);
+    check_int(s.size, 20000);
+    check(s.capacity >= 20000);
+    dsg_at(s, 19999) = 7;
+    check_int(dsg_back(s), 7);
+    dsg_reserve(&s, 100000);
+    check_int(s.size, 20000);
+    check(s.capacity >= 100000);
+
+    dsg_free(&s);
+    check_int(s.size, 0);
+    check_int(s.capacity, 0);
+    check(s.blocks[0] == NULL);
+
+    /* appending nothing allocates nothing */
+    dsg_append2(&s, v.data, 0);
+    check(s.blocks[0] == NULL);
+
+    dv_free(v);
+    return 0;
+}
@@ -0,0 +1,152 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#define DMEM_LIBRARY
+#include <dmem/shared.h>
+#include <stdlib.h>
+#include <assert.h>
+
+/* The buffer is either followed by the chars (ds_new) or points at a vector
+ * block it took over (ds_take) */
+struct dsi_buffer {
+    long refs;
+    char* vector;
+};
+
+#ifdef _MSC_VER
+#define REF_ADD(PBUF, N) (_InterlockedExchangeAdd(&(PBUF)->refs, (N)) + (N))
+#define REF_GET(PBUF) _InterlockedExchangeAdd(&(PBUF)->refs, 0)
+#else
+#define REF_ADD(PBUF, N) __atomic_add_fetch(&(PBUF)->refs, (N), __ATOMIC_ACQ_REL)
+#define REF_GET(PBUF) __atomic_load_n(&(PBUF)->refs, __ATOMIC_ACQUIRE)
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+d_shared ds_new(d_string str)
+{
+    d_shared ret = DS_INIT;
+    char* data;
+
+    if (str.size == 0) {
+        return ret;
+    }
+
+    ret.buf = (dsi_buffer*) malloc(sizeof(dsi_buffer) + str.size + 1);
+    ret.buf->refs = 1;
+    ret.buf->vector = NULL;
+
+    data = (char*) (ret.buf + 1);
+    memcpy(data, str.data, str.size);
+    data[str.size] = '\0';
+
+    ret.data = data;
+    ret.size = str.size;
+    return ret;
+}
+
+/* ------------------------------------------------------------------------- */
+
+d_shared ds_take(d_vector(char)* v)
+{
+    d_shared ret = DS_INIT;
+
+    if (v->size == 0) {
+        dv_free(*v);
+        dv_init(v);
+        return ret;
+    }
+
+    ret.buf = NEW(dsi_buffer);
+    ret.buf->refs = 1;
+    ret.buf->vector = v->data;
+    ret.data = v->data;
+    ret.size = v->size;
+
+    dv_init(v);
+    return ret;
+}
+
+/* ------------------------------------------------------------------------- */
+
+d_shared ds_copy(d_shared s)
+{
+    if (s.buf) {
+        REF_ADD(s.buf, 1);
+    }
+    return s;
+}
+
+/* ------------------------------------------------------------------------- */
+
+d_shared ds_slice(d_shared s, dv_size_t from, dv_size_t to)
+{
+    assert(0 <= from && from <= to && to <= s.size);
+    s = ds_copy(s);
+    s.data += from;
+    s.size = to - from;
+    return s;
+}
+
+/* ------------------------------------------------------------------------- */
+
+d_shared ds_retain(d_shared parent, d_string str)
+{
+    if (parent.buf && parent.data <= str.data && str.data + str.size <= parent.data + parent.size) {
+        dv_size_t from = (dv_size_t) (str.data - parent.data);
+        return ds_slice(parent, from, from + str.size);
+    } else {
+        return ds_new(str);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+void ds_free(d_shared s)
+{
+    if (s.buf && REF_ADD(s.buf, -1) == 0) {
+        dv_free_base(s.buf->vector);
+        free(s.buf);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+bool ds_is_shared(d_shared s)
+{ return s.buf && REF_GET(s.buf) > 1; }
+
+/* ------------------------------------------------------------------------- */
+
+char* ds_unshare(d_shared* ps)
+{
+    if (ds_is_shared(*ps)) {
+        d_shared copy = ds_new(ds_string(*ps));
+        ds_free(*ps);
+        *ps = copy;
+    }
+
+    return (char*) ps->data;
+}
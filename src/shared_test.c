@@ -0,0 +1,97 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+#include <dmem/shared.h>
+#include "test.h"
+
+int main(void)
+{
+	d_vector(char) v = DV_INIT;
+	d_shared s = DS_INIT;
+	d_shared a, b, c;
+	d_string str;
+	char* p;
+
+	/* empty strings don't allocate */
+	s = ds_new(C(""));
+	check(s.buf == NULL);
+	check_int(s.size, 0);
+	ds_free(s);
+
+	s = ds_new(C("hello world"));
+	check_string(ds_string(s), C("hello world"));
+	check_int(s.data[s.size], '\0');
+	check(!ds_is_shared(s));
+
+	/* copies and slices share the buffer */
+	a = ds_copy(s);
+	check(a.data == s.data);
+	check(ds_is_shared(s));
+	b = ds_slice(s, 6, 11);
+	check_string(ds_string(b), C("world"));
+	check(b.buf == s.buf);
+
+	/* slices keep the buffer alive after the parent is released */
+	ds_free(s);
+	ds_free(a);
+	check_string(ds_string(b), C("world"));
+	check(!ds_is_shared(b));
+
+	/* retaining a string inside the parent slices it, otherwise copies */
+	str = dv_right(ds_string(b), 2);
+	c = ds_retain(b, str);
+	check(c.buf == b.buf);
+	check_string(ds_string(c), C("rld"));
+	ds_free(c);
+	c = ds_retain(b, C("rld"));
+	check(c.buf != b.buf);
+	check_string(ds_string(c), C("rld"));
+	ds_free(c);
+
+	/* copy on write */
+	a = ds_copy(b);
+	p = ds_unshare(&a);
+	check(a.buf != b.buf);
+	p[0] = 'W';
+	check_string(ds_string(a), C("World"));
+	check_string(ds_string(b), C("world"));
+	check(ds_unshare(&a) == p);
+	ds_free(a);
+	ds_free(b);
+
+	/* taking a vector doesn't copy it */
+	dv_set(&v, C("<a><b/></a>"));
+	p = v.data;
+	s = ds_take(&v);
+	check(v.data == NULL && v.size == 0);
+	check(s.data == p);
+	a = ds_slice(s, 1, 2);
+	ds_free(s);
+	check_string(ds_string(a), C("a"));
+	ds_free(a);
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#include <dmem/soa.h>
+#include "test.h"
+
+#define TRADE_FIELDS(X) X(double, price) X(int, qty) X(char, side)
+DVECTOR_SOA_INIT(trade, TRADE_FIELDS);
+
+int main(void)
+{
+    d_soa(trade) t = DSOA_INIT;
+    dv_size_t i, idx;
+
+    check_int(t.size, 0);
+    check(t.price == NULL && t.qty == NULL && t.side == NULL);
+
+    /* append returns the index of the first new row */
+    for (i = 0; i < 100; i++) {
+        idx = dsoa_append_trade(&t, 1);
+        check_int(idx, i);
+        t.price[idx] = i * 0.5;
+        t.qty[idx] = (int) i;
+        t.side[idx] = (i & 1) ? 'B' : 'S';
+    }
+    check_int(t.size, 100);
+    check(t.capacity >= 100);
+    check(dv_reserved_base(t.price) >= 100 * sizeof(double));
+    check(t.price[99] == 49.5);
+    check_int(t.qty[99], 99);
+    check_int(t.side[99], 'B');
+
+    /* bulk append */
+    idx = dsoa_append_trade(&t, 50);
+    check_int(idx, 100);
+    check_int(t.size, 150);
+    for (i = 100; i < 150; i++) {
+        t.price[i] = i * 0.5;
+        t.qty[i] = (int) i;
+        t.side[i] = 'X';
+    }
+
+    /* erase shifts every column down */
+    dsoa_erase_trade(&t, 10, 20);
+    check_int(t.size, 130);
+    check_int(t.qty[9], 9);
+    check_int(t.qty[10], 30);
+    check(t.price[10] == 15.0);
+    check_int(t.side[10], 'S');
+    check_int(t.qty[129], 149);
+
+    /* swap remove moves the last row into the hole */
+    dsoa_swap_remove_trade(&t, 0);
+    check_int(t.size, 129);
+    check_int(t.qty[0], 149);
+    check(t.price[0] == 74.5);
+    check_int(t.side[0], 'X');
+    check_int(t.qty[1], 1);
+
+    /* removing the last row */
+    dsoa_swap_remove_trade(&t, t.size - 1);
+    check_int(t.size, 128);
+    check_int(t.qty[127], 147);
+
+    /* resize keeps the existing rows */
+    dsoa_resize_trade(&t, 1000);
+    check_int(t.size, 1000);
+    check_int(t.qty[127], 147);
+    check(t.price[127] == 73.5);
+    dsoa_resize_trade(&t, 5);
+    check_int(t.size, 5);
+    check_int(t.qty[4], 4);
+
+    /* reserve does not change the size */
+    dsoa_reserve_trade(&t, 5000);
+    check_int(t.size, 5);
+    check(t.capacity >= 5000);
+
+    dsoa_free_trade(&t);
+    check_int(t.size, 0);
+    check_int(t.capacity, 0);
+    check(t.price == NULL);
+    return 0;
+}
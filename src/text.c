@@ -0,0 +1,128 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#define DMEM_LIBRARY
+#include <dmem/text.h>
+
+/* ------------------------------------------------------------------------- */
+
+/* Moves the gap so that it starts at 'idx' */
+static void move_gap(d_text* t, dv_size_t idx)
+{
+    dv_size_t gapsz = t->capacity - t->size;
+
+    if (idx < t->gap) {
+        memmove(t->data + idx + gapsz, t->data + idx, t->gap - idx);
+    } else if (idx > t->gap) {
+        memmove(t->data + t->gap, t->data + t->gap + gapsz, idx - t->gap);
+    }
+
+    t->gap = idx;
+}
+
+/* Makes sure the gap can hold 'num' more chars */
+static void reserve(d_text* t, dv_size_t num)
+{
+    dv_size_t oldcap = t->capacity;
+    dv_size_t after = t->size - t->gap;
+
+    if (t->size + num <= oldcap) {
+        return;
+    }
+
+    /* dv_resize_base grows geometrically and its terminating nulls are
+     * written past oldcap, so the text after the gap is intact */
+    t->data = (char*) dv_resize_base(t->data, t->size + num);
+    t->capacity = (dv_size_t) dv_reserved_base(t->data);
+    memmove(t->data + t->capacity - after, t->data + oldcap - after, after);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void dt_take(d_text* t, d_vector(char)* v)
+{
+    t->data = v->data;
+    t->size = v->size;
+    t->gap = v->size;
+    t->capacity = (dv_size_t) dv_reserved_base(v->data);
+    dv_init(v);
+}
+
+char* dt_insert_buffer(d_text* t, dv_size_t idx, dv_size_t num)
+{
+    char* ret;
+    reserve(t, num);
+    move_gap(t, idx);
+    ret = t->data + t->gap;
+    t->gap += num;
+    t->size += num;
+    return ret;
+}
+
+void dt_insert(d_text* t, dv_size_t idx, d_string str)
+{
+    char* p = dt_insert_buffer(t, idx, str.size);
+    memcpy(p, str.data, str.size);
+}
+
+void dt_erase(d_text* t, dv_size_t idx, dv_size_t num)
+{
+    move_gap(t, idx);
+    t->size -= num;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void dt_slices(const d_text* t, d_string* before, d_string* after)
+{
+    before->data = t->data;
+    before->size = t->gap;
+    after->data = t->data + t->gap + (t->capacity - t->size);
+    after->size = t->size - t->gap;
+}
+
+d_vector(char) dt_release(d_text* t)
+{
+    d_vector(char) ret = DV_INIT;
+
+    if (t->data) {
+        move_gap(t, t->size);
+        ret.size = t->size;
+        ret.data = (char*) dv_resize_base(t->data, t->size);
+    }
+
+    dt_init(t);
+    return ret;
+}
+
+void dt_flatten(d_vector(char)* out, const d_text* t)
+{
+    d_string before, after;
+    dt_slices(t, &before, &after);
+    dv_append(out, before);
+    dv_append(out, after);
+}
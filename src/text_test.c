@@ -0,0 +1,92 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#include <dmem/text.h>
+#include "test.h"
+
+int main(void)
+{
+    d_text t = DT_INIT;
+    d_vector(char) v = DV_INIT;
+    d_string a, b;
+    int i;
+
+    dt_append(&t, C("hello world"));
+    check_int(t.size, 11);
+    check_int(dt_at(t, 0), 'h');
+    check_int(dt_at(t, 10), 'd');
+
+    /* edits in the middle move the gap */
+    dt_insert(&t, 5, C(","));
+    dt_insert(&t, 6, C(" big"));
+    check_int(t.gap, 10);
+    dt_slices(&t, &a, &b);
+    check_string(a, C("hello, big"));
+    check_string(b, C(" world"));
+    check_int(dt_at(t, 10), ' ');
+    check_int(dt_at(t, 11), 'w');
+
+    dt_erase(&t, 0, 7);
+    dt_slices(&t, &a, &b);
+    check_string(a, C(""));
+    check_string(b, C("big world"));
+    dt_insert(&t, t.size, C("!"));
+
+    dt_flatten(&v, &t);
+    check_string(v, C("big world!"));
+
+    /* growing with text on both sides of the gap */
+    for (i = 0; i < 1000; i++) {
+        dt_insert(&t, 4, C("ab"));
+    }
+    check_int(t.size, 2010);
+    check(dt_at(t, 3) == ' ' && dt_at(t, 4) == 'a' && dt_at(t, 2003) == 'b');
+    check_int(dt_at(t, 2004), 'w');
+    dt_erase(&t, 4, 2000);
+    dt_slices(&t, &a, &b);
+    check_int(a.size + b.size, 10);
+
+    dv_free(v);
+    v = dt_release(&t);
+    check_string(v, C("big world!"));
+    check_int(v.data[v.size], '\0');
+    check(t.data == NULL);
+
+    /* edit an existing vector in place */
+    dt_take(&t, &v);
+    check(v.data == NULL);
+    dt_insert(&t, 3, C(" wide"));
+    v = dt_release(&t);
+    check_string(v, C("big wide world!"));
+    dv_free(v);
+
+    v = dt_release(&t);
+    check(v.data == NULL);
+
+    return 0;
+}
+
@@ -32,60 +32,751 @@
 #include <assert.h>
 #include <stdio.h>
 
+#ifdef __linux__
+#define DV_HAVE_MREMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef _MSC_VER
+#include <windows.h>
+#define DV_THREAD_LOCAL __declspec(thread)
+#else
+#include <pthread.h>
+#define DV_THREAD_LOCAL __thread
+#endif
+
+/* Each block begins with a header holding the owning allocator (NULL for
+ * malloc) and the reserved size. Vector data points just past the header, so
+ * the reserved size is always found at ((uint64_t*) data)[-1]. Blocks have
+ * two extra bytes after the reserved space for the null terminator. Stats
+ * builds also track the used size of each block.
+ */
+typedef struct dvi_header dvi_header;
+
+struct dvi_header {
+#ifdef DMEM_STATS
+    uint64_t used;
+    uint64_t pad;
+#endif
+    union {
+        dv_allocator* alloc;
+        uint64_t pad;
+    } u;
+    uint64_t reserved;
+};
+
+STATIC_ASSERT(sizeof(dvi_header) == DVI_HEADER_WORDS * sizeof(uint64_t));
+
+#define HEADER(p) ((dvi_header*) (p) - 1)
+#define BLOCK_SIZE(reserved) ((size_t) (reserved) + sizeof(dvi_header) + 2)
+
+static DV_THREAD_LOCAL dv_allocator* g_allocator;
+
+dv_allocator* dv_set_allocator(dv_allocator* a)
+{
+    dv_allocator* prev = g_allocator;
+    g_allocator = a;
+    return prev;
+}
+
+dv_allocator* dv_current_allocator(void)
+{ return g_allocator; }
+
+dv_allocator* dv_allocator_base(void* p)
+{ return p ? HEADER(p)->u.alloc : g_allocator; }
+
+/* ------------------------------------------------------------------------- */
+
+/* Inline storage is marked by its own allocator which is never asked to
+ * allocate. When an inline vector outgrows its storage it is moved to the
+ * thread's allocator and the inline header's reserved size is cleared so
+ * dv_inline_moved knows it is no longer in use.
+ */
+static void inline_free(dv_allocator* a, void* p, size_t sz)
+{ (void) a; (void) p; (void) sz; }
+
+static dv_allocator g_inline = {NULL, &inline_free};
+
+void* dv_init_inline_base(uint64_t* hdr, size_t reserved)
+{
+    dvi_header* h = (dvi_header*) hdr;
+    char* cp = (char*) (h + 1);
+    h->u.alloc = &g_inline;
+    h->reserved = reserved;
+    cp[0] = 0;
+    cp[1] = 0;
+    return cp;
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef DMEM_STATS
+static dv_stats g_stats;
+
+#ifdef _MSC_VER
+#define STAT_ADD(FIELD, N) _InterlockedExchangeAdd64(&g_stats.FIELD, (int64_t) (N))
+#define STAT_GET(FIELD) _InterlockedExchangeAdd64(&g_stats.FIELD, 0)
+#else
+#define STAT_ADD(FIELD, N) __atomic_fetch_add(&g_stats.FIELD, (int64_t) (N), __ATOMIC_RELAXED)
+#define STAT_GET(FIELD) __atomic_load_n(&g_stats.FIELD, __ATOMIC_RELAXED)
+#endif
+
+static int stat_bucket(uint64_t reserved)
+{
+    int b = 0;
+    while (reserved >>= 1) {
+        b++;
+    }
+    return b < DV_STATS_BUCKETS ? b : DV_STATS_BUCKETS - 1;
+}
+
+/* Adds (sign = 1) or removes (sign = -1) a block from the live totals */
+static void stat_block(dvi_header* h, int sign)
+{
+    STAT_ADD(live, sign);
+    STAT_ADD(reserved, sign * (int64_t) h->reserved);
+    STAT_ADD(used, sign * (int64_t) h->used);
+    STAT_ADD(sizes[stat_bucket(h->reserved)], sign);
+}
+
+bool dv_get_stats(dv_stats* stats)
+{
+    int i;
+    stats->live = STAT_GET(live);
+    stats->reserved = STAT_GET(reserved);
+    stats->used = STAT_GET(used);
+    stats->reallocs = STAT_GET(reallocs);
+    stats->copied = STAT_GET(copied);
+    for (i = 0; i < DV_STATS_BUCKETS; i++) {
+        stats->sizes[i] = STAT_GET(sizes[i]);
+    }
+    return true;
+}
+#else
+bool dv_get_stats(dv_stats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    return false;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+/* Size classes follow the growth policy (alloc * 2 + 16) so a vector grown
+ * from empty stays within them: reserved + 16 is a power of two from 32
+ * bytes up to 1MB. Freed blocks are linked through their first data word.
+ * Each thread caches up to POOL_CACHE blocks per class without locking and
+ * overflows onto the shared lists, which are guarded by a spin lock. The
+ * first put into a thread's cache registers a thread exit hook that moves
+ * the cache onto the shared lists.
+ */
+#define POOL_CLASSES 16
+#define POOL_MIN_SHIFT 5
+#define POOL_CACHE 8
+#define POOL_RESERVED(k) (((size_t) 1 << ((k) + POOL_MIN_SHIFT)) - 16)
+#define POOL_NEXT(h) (*(dvi_header**) ((h) + 1))
+
+typedef struct pool_list pool_list;
+
+struct pool_list {
+    dvi_header* head[POOL_CLASSES];
+    int count[POOL_CLASSES];
+};
+
+static size_t g_pool_limit;
+static int64_t g_pool_bytes;
+static long g_pool_lock;
+static pool_list g_pool;
+static DV_THREAD_LOCAL pool_list g_pool_cache;
+static DV_THREAD_LOCAL bool g_pool_registered;
+
+#ifdef _MSC_VER
+#define POOL_ADD(N) (_InterlockedExchangeAdd64(&g_pool_bytes, (N)) + (N))
+#define POOL_LOCK() while (_InterlockedExchange(&g_pool_lock, 1)) {}
+#define POOL_UNLOCK() _InterlockedExchange(&g_pool_lock, 0)
+#else
+#define POOL_ADD(N) __atomic_add_fetch(&g_pool_bytes, (N), __ATOMIC_RELAXED)
+#define POOL_LOCK() while (__atomic_exchange_n(&g_pool_lock, 1, __ATOMIC_ACQUIRE)) {}
+#define POOL_UNLOCK() __atomic_store_n(&g_pool_lock, 0, __ATOMIC_RELEASE)
+#endif
+
+/* Moves the blocks in an exiting thread's cache onto the shared lists. The
+ * bytes stay counted in g_pool_bytes as the blocks are still pooled. */
+static void pool_thread_exit(void* udata)
+{
+    pool_list* c = (pool_list*) udata;
+    int k;
+
+    POOL_LOCK();
+    for (k = 0; k < POOL_CLASSES; k++) {
+        while (c->head[k]) {
+            dvi_header* h = c->head[k];
+            c->head[k] = POOL_NEXT(h);
+            POOL_NEXT(h) = g_pool.head[k];
+            g_pool.head[k] = h;
+            g_pool.count[k]++;
+        }
+        c->count[k] = 0;
+    }
+    POOL_UNLOCK();
+
+    /* later exit hooks that free vectors register again */
+    g_pool_registered = false;
+}
+
+#ifdef _MSC_VER
+static DWORD g_pool_key;
+static INIT_ONCE g_pool_once = INIT_ONCE_STATIC_INIT;
+
+static VOID WINAPI pool_fls_exit(PVOID udata)
+{
+    if (udata) {
+        pool_thread_exit(udata);
+    }
+}
+
+static BOOL CALLBACK pool_create_key(PINIT_ONCE once, PVOID param, PVOID* ctx)
+{
+    (void) once;
+    (void) param;
+    (void) ctx;
+    g_pool_key = FlsAlloc(&pool_fls_exit);
+    return TRUE;
+}
+
+static void pool_register(void)
+{
+    InitOnceExecuteOnce(&g_pool_once, &pool_create_key, NULL, NULL);
+    FlsSetValue(g_pool_key, &g_pool_cache);
+    g_pool_registered = true;
+}
+#else
+static pthread_key_t g_pool_key;
+static pthread_once_t g_pool_once = PTHREAD_ONCE_INIT;
+
+static void pool_create_key(void)
+{ pthread_key_create(&g_pool_key, &pool_thread_exit); }
+
+static void pool_register(void)
+{
+    pthread_once(&g_pool_once, &pool_create_key);
+    pthread_setspecific(g_pool_key, &g_pool_cache);
+    g_pool_registered = true;
+}
+#endif
+
+void dv_set_pool_limit(size_t max_bytes)
+{ g_pool_limit = max_bytes; }
+
+size_t dv_pool_size(void)
+{ return (size_t) POOL_ADD(0); }
+
+/* Returns the size class for a reserved size or -1 if it isn't one */
+static int pool_class(size_t reserved)
+{
+    size_t n = reserved + 16;
+    int k = 0;
+
+    if (n & (n - 1)) {
+        return -1;
+    }
+
+    while (((size_t) 1 << (k + POOL_MIN_SHIFT)) < n) {
+        k++;
+    }
+
+    return k < POOL_CLASSES && POOL_RESERVED(k) == reserved ? k : -1;
+}
+
+/* Rounds a new reserved size up to the next size class */
+static size_t pool_round(size_t reserved)
+{
+    int k = 0;
+
+    if (reserved > POOL_RESERVED(POOL_CLASSES - 1)) {
+        return reserved;
+    }
+
+    while (POOL_RESERVED(k) < reserved) {
+        k++;
+    }
+
+    return POOL_RESERVED(k);
+}
+
+static dvi_header* pool_get(size_t reserved)
+{
+    int k = pool_class(reserved);
+    dvi_header* h;
+
+    if (k < 0) {
+        return NULL;
+    }
+
+    h = g_pool_cache.head[k];
+
+    if (h) {
+        g_pool_cache.head[k] = POOL_NEXT(h);
+        g_pool_cache.count[k]--;
+    } else {
+        POOL_LOCK();
+        h = g_pool.head[k];
+        if (h) {
+            g_pool.head[k] = POOL_NEXT(h);
+            g_pool.count[k]--;
+        }
+        POOL_UNLOCK();
+    }
+
+    if (h) {
+        POOL_ADD(-(int64_t) BLOCK_SIZE(reserved));
+    }
+
+    return h;
+}
+
+/* Returns false if the block doesn't fit in the pool and should be freed */
+static bool pool_put(dvi_header* h)
+{
+    int k = g_pool_limit ? pool_class((size_t) h->reserved) : -1;
+    int64_t sz;
+
+    if (k < 0) {
+        return false;
+    }
+
+    sz = (int64_t) BLOCK_SIZE(h->reserved);
+    if (POOL_ADD(sz) > (int64_t) g_pool_limit) {
+        POOL_ADD(-sz);
+        return false;
+    }
+
+    if (g_pool_cache.count[k] < POOL_CACHE) {
+        if (!g_pool_registered) {
+            pool_register();
+        }
+        POOL_NEXT(h) = g_pool_cache.head[k];
+        g_pool_cache.head[k] = h;
+        g_pool_cache.count[k]++;
+    } else {
+        POOL_LOCK();
+        POOL_NEXT(h) = g_pool.head[k];
+        g_pool.head[k] = h;
+        g_pool.count[k]++;
+        POOL_UNLOCK();
+    }
+
+    return true;
+}
+
+static void pool_release(pool_list* l)
+{
+    int k;
+    for (k = 0; k < POOL_CLASSES; k++) {
+        while (l->head[k]) {
+            dvi_header* h = l->head[k];
+            l->head[k] = POOL_NEXT(h);
+            POOL_ADD(-(int64_t) BLOCK_SIZE(h->reserved));
+            free(h);
+        }
+        l->count[k] = 0;
+    }
+}
+
+void dv_pool_trim(void)
+{
+    pool_list shared;
+
+    POOL_LOCK();
+    shared = g_pool;
+    memset(&g_pool, 0, sizeof(g_pool));
+    POOL_UNLOCK();
+
+    pool_release(&shared);
+    pool_release(&g_pool_cache);
+}
+
 /* ------------------------------------------------------------------------- */
 
 void dv_free_base(void* p)
 {
     if (p) {
-        free((char*) p - 8);
+        dvi_header* h = HEADER(p);
+        dv_allocator* a = h->u.alloc;
+
+#ifdef DMEM_STATS
+        if (a != &g_inline) {
+            stat_block(h, -1);
+        }
+#endif
+
+        if (a) {
+            a->free(a, h, BLOCK_SIZE(h->reserved));
+        } else if (!pool_put(h)) {
+            free(h);
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Large vectors using the default allocator are moved into their own
+ * anonymous memory map, which can then be grown with mremap by remapping
+ * pages rather than copying the data.
+ */
+static size_t g_map_threshold = 64 * 1024 * 1024;
+static bool g_huge_pages;
+
+void dv_set_mmap_threshold(size_t threshold, bool huge_pages)
+{
+    g_map_threshold = threshold;
+    g_huge_pages = huge_pages;
+}
+
+#ifdef DV_HAVE_MREMAP
+static size_t map_size(size_t sz)
+{
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    return (sz + page - 1) & ~(page - 1);
+}
+
+static void* map_realloc(dv_allocator* a, void* p, size_t oldsz, size_t newsz)
+{
+    void* ret;
+    (void) a;
+
+    newsz = map_size(newsz);
+
+    if (p) {
+        ret = mremap(p, map_size(oldsz), newsz, MREMAP_MAYMOVE);
+    } else {
+        ret = mmap(NULL, newsz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
     }
+
+    if (ret == MAP_FAILED) {
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (g_huge_pages) {
+        madvise(ret, newsz, MADV_HUGEPAGE);
+    }
+#endif
+
+    return ret;
+}
+
+static void map_free(dv_allocator* a, void* p, size_t sz)
+{
+    (void) a;
+    munmap(p, map_size(sz));
 }
 
+static dv_allocator g_map = {&map_realloc, &map_free};
+#endif
+
 /* ------------------------------------------------------------------------- */
 
-void* dv_resize_base(void* p, int newsz)
+void* dv_resize_alloc_base(dv_allocator* a, void* p, dv_size_t newsz)
 {
     char* cp = (char*) p;
-    size_t alloc = p ? (size_t) ((uint64_t*) cp)[-1] : 0;
+    dvi_header* h = p ? HEADER(p) : NULL;
+    size_t alloc = h ? (size_t) h->reserved : 0;
 
-    if (newsz > (int) alloc) {
+    if (h && h->u.alloc != a) {
+        /* Move the data over to the new allocator keeping the reserved size */
+        cp = (char*) dv_resize_alloc_base(a, NULL, newsz > (dv_size_t) alloc ? newsz : (dv_size_t) alloc);
+        if (cp) {
+            memcpy(cp, p, alloc);
+#ifdef DMEM_STATS
+            STAT_ADD(copied, alloc);
+#endif
+            if (h->u.alloc == &g_inline) {
+                h->reserved = 0;
+            } else {
+                dv_free_base(p);
+            }
+            cp[newsz] = 0;
+            cp[newsz+1] = 0;
+        }
+        return cp;
+    }
+
+    if (newsz > (dv_size_t) alloc) {
+        size_t oldblock = h ? BLOCK_SIZE(alloc) : 0;
+#ifdef DMEM_STATS
+        size_t oldalloc = alloc;
+        uintptr_t oldh = (uintptr_t) h;
+        uint64_t oldused = h ? h->used : 0;
+#ifdef DV_HAVE_MREMAP
+        bool remapped = h && a == &g_map;
+#else
+        bool remapped = false;
+#endif
+        if (h) {
+            stat_block(h, -1);
+        }
+#endif
         alloc = (alloc * 2) + 16;
 
-        if (newsz > (int) alloc) {
-            alloc = (newsz + 8) & ~7U;
+        if (newsz > (dv_size_t) alloc) {
+            alloc = ((size_t) newsz + 8) & ~(size_t) 7;
+        }
+
+        if (!a && g_pool_limit) {
+            alloc = pool_round(alloc);
         }
 
         assert((alloc / 8) * 8 == alloc);
 
-        cp = (char*) realloc(cp ? cp - 8 : NULL, alloc + 10);
-        if (cp) {
-            *((uint64_t*) cp) = alloc;
-            cp += 8;
+        if (a) {
+            h = (dvi_header*) a->realloc(a, h, oldblock, BLOCK_SIZE(alloc));
+
+#ifdef DV_HAVE_MREMAP
+        } else if (g_map_threshold && BLOCK_SIZE(alloc) >= g_map_threshold) {
+            dvi_header* m = (dvi_header*) map_realloc(&g_map, NULL, 0, BLOCK_SIZE(alloc));
+            if (m && h) {
+                memcpy(m, h, oldblock);
+                free(h);
+            }
+            h = m;
+            a = &g_map;
+#endif
+
+        } else {
+            dvi_header* n = g_pool_limit ? pool_get(alloc) : NULL;
+            if (!n) {
+                h = (dvi_header*) realloc(h, BLOCK_SIZE(alloc));
+            } else if (h) {
+                memcpy(n, h, oldblock);
+                if (!pool_put(h)) {
+                    free(h);
+                }
+                h = n;
+            } else {
+                h = n;
+            }
         }
+
+        cp = NULL;
+        if (h) {
+            h->u.alloc = a;
+            h->reserved = alloc;
+            cp = (char*) (h + 1);
+
+#ifdef DMEM_STATS
+            h->used = oldused;
+            stat_block(h, 1);
+            if (oldh) {
+                STAT_ADD(reallocs, 1);
+                if ((uintptr_t) h != oldh && !remapped) {
+                    STAT_ADD(copied, oldalloc);
+                }
+            }
+#endif
+        }
+#ifdef DMEM_STATS
+        else if (oldh) {
+            /* the old block is left untouched on failure */
+            stat_block((dvi_header*) oldh, 1);
+        }
+#endif
     }
 
     if (cp) {
         cp[newsz] = 0;
         cp[newsz+1] = 0;
+
+#ifdef DMEM_STATS
+        h = HEADER(cp);
+        if (h->u.alloc != &g_inline) {
+            STAT_ADD(used, (int64_t) newsz - (int64_t) h->used);
+            h->used = (uint64_t) newsz;
+        }
+#endif
     }
 
     return cp;
 }
 
+void* dv_resize_base(void* p, dv_size_t newsz)
+{
+    dv_allocator* a = p ? HEADER(p)->u.alloc : g_allocator;
+
+    if (a == &g_inline && newsz > (dv_size_t) HEADER(p)->reserved) {
+        a = g_allocator;
+    }
+
+    return dv_resize_alloc_base(a, p, newsz);
+}
+
 /* ------------------------------------------------------------------------- */
 
 size_t dv_reserved_base(void* p)
-{ return p ? (size_t) ((uint64_t*) p)[-1] : 0; }
+{ return p ? (size_t) HEADER(p)->reserved : 0; }
 
-void* dv_append_buffer_base(struct dv_base* v, int num, int typesz)
+/* ------------------------------------------------------------------------- */
+
+struct dvi_arena_block {
+    dvi_arena_block* next;
+    size_t size;
+};
+
+#define ARENA_ALIGN(x) (((size_t) (x) + 15) & ~(size_t) 15)
+#define ARENA_HEADER ARENA_ALIGN(sizeof(dvi_arena_block))
+#define ARENA_DEFAULT_BLOCK (64 * 1024)
+
+static void* arena_alloc(dv_arena* a, size_t sz)
 {
-    int oldsz = v->size * typesz;
+    dvi_arena_block* b;
+    char* ret;
+
+    sz = ARENA_ALIGN(sz);
+
+    if (sz <= (size_t) (a->end - a->next)) {
+        ret = a->next;
+        a->next += sz;
+        return ret;
+    }
+
+    if (sz > a->block_size / 4) {
+        /* Large allocations get their own block which is put behind the
+         * current block so we can keep on bumping from the current one.
+         */
+        b = (dvi_arena_block*) malloc(ARENA_HEADER + sz);
+        if (!b) {
+            return NULL;
+        }
+
+        b->size = sz;
+
+        if (a->blocks) {
+            b->next = a->blocks->next;
+            a->blocks->next = b;
+        } else {
+            b->next = NULL;
+            a->blocks = b;
+        }
+
+        return (char*) b + ARENA_HEADER;
+    }
+
+    b = (dvi_arena_block*) malloc(ARENA_HEADER + a->block_size);
+    if (!b) {
+        return NULL;
+    }
+
+    b->size = a->block_size;
+    b->next = a->blocks;
+    a->blocks = b;
+
+    ret = (char*) b + ARENA_HEADER;
+    a->next = ret + sz;
+    a->end = ret + b->size;
+    return ret;
+}
+
+static void* arena_realloc(dv_allocator* base, void* p, size_t oldsz, size_t newsz)
+{
+    dv_arena* a = (dv_arena*) base;
+    char* cp = (char*) p;
+    char* np;
+
+    /* The last allocation can be resized in place */
+    if (cp && cp + ARENA_ALIGN(oldsz) == a->next && ARENA_ALIGN(newsz) <= (size_t) (a->end - cp)) {
+        a->next = cp + ARENA_ALIGN(newsz);
+        return cp;
+    }
+
+    np = (char*) arena_alloc(a, newsz);
+
+    if (np && cp) {
+        memcpy(np, cp, oldsz < newsz ? oldsz : newsz);
+    }
+
+    return np;
+}
+
+static void arena_free(dv_allocator* base, void* p, size_t sz)
+{
+    dv_arena* a = (dv_arena*) base;
+    char* cp = (char*) p;
+
+    /* Only the last allocation can be given back, the rest is released
+     * when the arena is reset.
+     */
+    if (cp + ARENA_ALIGN(sz) == a->next) {
+        a->next = cp;
+    }
+}
+
+void dv_arena_init(dv_arena* a, size_t block_size)
+{
+    a->base.realloc = &arena_realloc;
+    a->base.free = &arena_free;
+    a->blocks = NULL;
+    a->next = NULL;
+    a->end = NULL;
+    a->block_size = block_size ? ARENA_ALIGN(block_size) : ARENA_DEFAULT_BLOCK;
+}
+
+void dv_arena_reset(dv_arena* a)
+{
+    dvi_arena_block* keep = a->blocks;
+    dvi_arena_block* b;
+
+    if (keep && keep->size != a->block_size) {
+        keep = NULL;
+    }
+
+    b = keep ? keep->next : a->blocks;
+    while (b) {
+        dvi_arena_block* next = b->next;
+        free(b);
+        b = next;
+    }
+
+    if (keep) {
+        keep->next = NULL;
+        a->blocks = keep;
+        a->next = (char*) keep + ARENA_HEADER;
+        a->end = a->next + keep->size;
+    } else {
+        a->blocks = NULL;
+        a->next = NULL;
+        a->end = NULL;
+    }
+}
+
+void dv_arena_free(dv_arena* a)
+{
+    dvi_arena_block* b = a->blocks;
+
+    while (b) {
+        dvi_arena_block* next = b->next;
+        free(b);
+        b = next;
+    }
+
+    a->blocks = NULL;
+    a->next = NULL;
+    a->end = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void* dv_append_buffer_base(struct dv_base* v, dv_size_t num, int typesz)
+{
+    dv_size_t oldsz = v->size * typesz;
     v->size += num;
     v->data = dv_resize_base(v->data, v->size * typesz);
     return v->data + oldsz;
 }
 
-void* dv_append_zeroed_base(struct dv_base* v, int num, int typesz)
+void* dv_append_zeroed_base(struct dv_base* v, dv_size_t num, int typesz)
 {
     void* ret = dv_append_buffer_base(v, num, typesz);
     memset(ret, 0, num * typesz);
@@ -94,11 +785,11 @@ void* dv_append_zeroed_base(struct dv_base* v, int num, int typesz)
 
 /* ------------------------------------------------------------------------- */
 
-void* dv_insert_buffer_base(struct dv_base* v, int idx, int num, int typesz)
+void* dv_insert_buffer_base(struct dv_base* v, dv_size_t idx, dv_size_t num, int typesz)
 {
     char* s;
     char* e;
-    int after = (v->size - idx) * typesz;
+    dv_size_t after = (v->size - idx) * typesz;
     v->size += num;
     v->data = dv_resize_base(v->data, v->size * typesz);
     s = (char*) v->data + (idx * typesz);
@@ -107,7 +798,7 @@ void* dv_insert_buffer_base(struct dv_base* v, int idx, int num, int typesz)
     return s;
 }
 
-void* dv_insert_zeroed_base(struct dv_base* v, int idx, int num, int typesz)
+void* dv_insert_zeroed_base(struct dv_base* v, dv_size_t idx, dv_size_t num, int typesz)
 {
     void* ret = dv_insert_buffer_base(v, idx, num, typesz);
     memset(ret, 0, num * typesz);
@@ -116,15 +807,123 @@ void* dv_insert_zeroed_base(struct dv_base* v, int idx, int num, int typesz)
 
 /* ------------------------------------------------------------------------- */
 
-int dv_cmp_base(void* adata, int asz, void* bdata, int bsz)
+int dv_cmp_base(void* adata, dv_size_t asz, void* bdata, dv_size_t bsz)
 {
     int c;
-    int cmpsz = asz;
+    dv_size_t cmpsz = asz;
     if (cmpsz > bsz) {
         cmpsz = bsz;
     }
-    c = memcmp(adata, bdata, bsz);
-    return c ? c : (asz - bsz);
+    c = memcmp(adata, bdata, cmpsz);
+    return c ? c : (asz > bsz) - (asz < bsz);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Loads an integer as an unsigned key that sorts in the same order */
+static uint64_t radix_key(const unsigned char* p, int typesz, bool is_signed)
+{
+    uint64_t k;
+
+    switch (typesz) {
+    case 1:
+        k = *p;
+        break;
+    case 2:
+        {
+            uint16_t v;
+            memcpy(&v, p, 2);
+            k = v;
+        }
+        break;
+    case 4:
+        {
+            uint32_t v;
+            memcpy(&v, p, 4);
+            k = v;
+        }
+        break;
+    default:
+        memcpy(&k, p, 8);
+        break;
+    }
+
+    if (is_signed) {
+        k ^= UINT64_C(1) << (typesz * 8 - 1);
+    }
+
+    return k;
+}
+
+/* Least significant digit first radix sort, one byte per pass. Passes where
+ * every value has the same byte are skipped.
+ */
+void dv_radix_sort_base(void* data, dv_size_t size, int typesz, bool is_signed)
+{
+    size_t count[8][256];
+    unsigned char *src, *dst, *tmp;
+    dv_size_t i, j;
+    int b;
+
+    assert(typesz == 1 || typesz == 2 || typesz == 4 || typesz == 8);
+
+    src = (unsigned char*) data;
+
+    if (size < 32) {
+        unsigned char v[8];
+        for (i = 1; i < size; i++) {
+            uint64_t k = radix_key(src + i * typesz, typesz, is_signed);
+            for (j = i; j > 0 && radix_key(src + (j - 1) * typesz, typesz, is_signed) > k; j--) {
+            }
+            if (j != i) {
+                memcpy(v, src + i * typesz, typesz);
+                memmove(src + (j + 1) * typesz, src + j * typesz, (i - j) * typesz);
+                memcpy(src + j * typesz, v, typesz);
+            }
+        }
+        return;
+    }
+
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < size; i++) {
+        uint64_t k = radix_key(src + i * typesz, typesz, is_signed);
+        for (b = 0; b < typesz; b++) {
+            count[b][(k >> (b * 8)) & 0xFF]++;
+        }
+    }
+
+    tmp = (unsigned char*) malloc((size_t) size * typesz);
+    dst = tmp;
+
+    for (b = 0; b < typesz; b++) {
+        size_t* c = count[b];
+        size_t sum = 0;
+
+        if (c[radix_key(src, typesz, is_signed) >> (b * 8) & 0xFF] == (size_t) size) {
+            continue;
+        }
+
+        for (i = 0; i < 256; i++) {
+            size_t n = c[i];
+            c[i] = sum;
+            sum += n;
+        }
+
+        for (i = 0; i < size; i++) {
+            uint64_t k = radix_key(src + i * typesz, typesz, is_signed);
+            memcpy(dst + c[(k >> (b * 8)) & 0xFF]++ * typesz, src + i * typesz, typesz);
+        }
+
+        /* the sorted output is the input to the next pass */
+        dst = src;
+        src = (dst == tmp) ? (unsigned char*) data : tmp;
+    }
+
+    if (src != data) {
+        memcpy(data, src, (size_t) size * typesz);
+    }
+
+    free(tmp);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -0,0 +1,734 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#include "bench.h"
+#include <dmem/soa.h>
+
+/* The JSON and XML parsers keep their lexer buffers, scope stacks and any
+ * strings the delegates hold onto in vectors. These benchmarks reproduce
+ * that allocation pattern over generated documents so we can compare the
+ * malloc default against running each request in an arena.
+ */
+
+DVECTOR_INIT(char_vector, d_vector(char));
+DVECTOR_INIT(int, int);
+
+typedef struct Scope Scope;
+struct Scope {
+    int type;
+    int children;
+};
+
+DVECTOR_INIT(Scope, Scope);
+
+typedef struct Workload Workload;
+struct Workload {
+    d_string doc;
+    dv_arena* arena;
+};
+
+static void free_strings(d_vector(char_vector)* v)
+{
+    int i;
+    for (i = 0; i < v->size; i++) {
+        dv_free(v->data[i]);
+    }
+    dv_free(*v);
+}
+
+static void parse_json(void* udata)
+{
+    Workload* w = (Workload*) udata;
+    d_vector(Scope) scopes = DV_INIT;
+    d_vector(char_vector) kept = DV_INIT;
+    d_vector(char) buf = DV_INIT;
+    d_vector(char) errstr = DV_INIT;
+    dv_allocator* prev = dv_set_allocator(w->arena ? &w->arena->base : NULL);
+    const char* p = w->doc.data;
+    const char* e = p + w->doc.size;
+
+    while (p < e) {
+        if (*p == '{' || *p == '[') {
+            Scope* s = dv_append_zeroed(&scopes, 1);
+            s->type = *p;
+            p++;
+
+        } else if (*p == '}' || *p == ']') {
+            dv_erase_end(&scopes, 1);
+            p++;
+
+        } else if (*p == '\"') {
+            d_vector(char) str = DV_INIT;
+            const char* b = ++p;
+            while (p < e && *p != '\"') {
+                p++;
+            }
+            dv_set2(&buf, b, (int) (p - b));
+            dv_set(&str, buf);
+            dv_append1(&kept, str);
+            p++;
+
+        } else if (*p == '-' || ('0' <= *p && *p <= '9')) {
+            const char* b = p;
+            while (p < e && (*p == '-' || *p == '.' || ('0' <= *p && *p <= '9'))) {
+                p++;
+            }
+            dv_set2(&buf, b, (int) (p - b));
+
+        } else {
+            p++;
+        }
+    }
+
+    dv_print(&errstr, "(%d) : %s", kept.size, "done");
+
+    if (w->arena) {
+        dv_arena_reset(w->arena);
+    } else {
+        free_strings(&kept);
+        dv_free(scopes);
+        dv_free(buf);
+        dv_free(errstr);
+    }
+
+    dv_set_allocator(prev);
+}
+
+typedef struct XmlScope XmlScope;
+struct XmlScope {
+    d_vector(char) tagbuf;
+    int namespaces_size;
+};
+
+DVECTOR_INIT(XmlScope, XmlScope);
+
+static void parse_xml(void* udata)
+{
+    Workload* w = (Workload*) udata;
+    d_vector(XmlScope) scopes = DV_INIT;
+    d_vector(char_vector) attributes = DV_INIT;
+    d_vector(char) token_buffer = DV_INIT;
+    dv_allocator* prev = dv_set_allocator(w->arena ? &w->arena->base : NULL);
+    d_string doc = w->doc;
+
+    while (doc.size) {
+        d_string text = dv_split_char(&doc, '<');
+        d_string tag = dv_split_char(&doc, '>');
+        d_string name;
+
+        dv_set(&token_buffer, text);
+
+        if (tag.size && tag.data[0] == '/') {
+            XmlScope* s = &scopes.data[scopes.size - 1];
+            dv_free(s->tagbuf);
+            dv_erase_end(&scopes, 1);
+
+        } else if (tag.size) {
+            XmlScope* s = dv_append_zeroed(&scopes, 1);
+            name = dv_split_char(&tag, ' ');
+            dv_set(&s->tagbuf, name);
+
+            while (tag.size) {
+                d_vector(char) attr = DV_INIT;
+                dv_set(&attr, dv_split_char(&tag, ' '));
+                dv_append1(&attributes, attr);
+            }
+
+            if (name.size && name.data[name.size - 1] == '/') {
+                dv_free(s->tagbuf);
+                dv_erase_end(&scopes, 1);
+            }
+
+            free_strings(&attributes);
+            dv_init(&attributes);
+        }
+    }
+
+    if (w->arena) {
+        dv_arena_reset(w->arena);
+    } else {
+        dv_free(scopes);
+        dv_free(attributes);
+        dv_free(token_buffer);
+    }
+
+    dv_set_allocator(prev);
+}
+
+/* The XML parser buffers the tag name of every open scope when a chunk ends
+ * part way through the document. This streams the document through in small
+ * chunks and does the same with either a plain vector or inline storage for
+ * each scope's tag buffer, counting the allocations made.
+ */
+
+DVECTOR_INLINE_INIT(tag, char, 32);
+
+typedef struct TagScope TagScope;
+struct TagScope {
+    d_string tag;
+    d_vector(char) tagbuf;
+    d_inline(tag) inline_tagbuf;
+};
+
+DVECTOR_INIT(TagScope, TagScope);
+
+static int g_allocations;
+
+static void* count_realloc(dv_allocator* a, void* p, size_t oldsz, size_t newsz)
+{
+    (void) a;
+    (void) oldsz;
+    g_allocations++;
+    return realloc(p, newsz);
+}
+
+static void count_free(dv_allocator* a, void* p, size_t sz)
+{
+    (void) a;
+    (void) sz;
+    free(p);
+}
+
+static dv_allocator g_count = {&count_realloc, &count_free};
+
+static void stream_tags(Workload* w, bool use_inline)
+{
+    d_vector(TagScope) scopes = DV_INIT;
+    d_string doc = w->doc;
+    int i, next_chunk = 64;
+
+    while (doc.size) {
+        d_string tag;
+
+        dv_split_char(&doc, '<');
+        tag = dv_split_char(&doc, '>');
+
+        if (tag.size && tag.data[0] == '/') {
+            TagScope* s = &scopes.data[scopes.size - 1];
+            dv_free(s->tagbuf);
+            dv_free(s->inline_tagbuf.v);
+            dv_erase_end(&scopes, 1);
+
+        } else if (tag.size) {
+            TagScope* old = scopes.data;
+            TagScope* s = dv_append_zeroed(&scopes, 1);
+
+            if (scopes.data != old) {
+                for (i = 0; i < scopes.size; i++) {
+                    dv_inline_moved(&scopes.data[i].inline_tagbuf);
+                }
+            }
+
+            s->tag = dv_split_char(&tag, ' ');
+            if (use_inline) {
+                dv_init_inline(&s->inline_tagbuf);
+            }
+        }
+
+        /* chunk boundary - buffer the tags of the open scopes */
+        if (doc.data - w->doc.data >= next_chunk) {
+            next_chunk += 64;
+
+            for (i = 0; i < scopes.size; i++) {
+                TagScope* s = &scopes.data[i];
+                if (use_inline && s->tag.data != s->inline_tagbuf.v.data) {
+                    dv_set(&s->inline_tagbuf.v, s->tag);
+                    s->tag = s->inline_tagbuf.v;
+                } else if (!use_inline && s->tag.data != s->tagbuf.data) {
+                    dv_set(&s->tagbuf, s->tag);
+                    s->tag = s->tagbuf;
+                }
+            }
+        }
+    }
+
+    dv_free(scopes);
+}
+
+static void stream_tags_vector(void* udata)
+{ stream_tags((Workload*) udata, false); }
+
+static void stream_tags_inline(void* udata)
+{ stream_tags((Workload*) udata, true); }
+
+static void count_allocations(const char* name, void (*func)(void*), void* udata)
+{
+    dv_allocator* prev = dv_set_allocator(&g_count);
+    g_allocations = 0;
+    func(udata);
+    dv_set_allocator(prev);
+    printf("%-40s %12d allocations\n", name, g_allocations);
+}
+
+/* Filters a vector of ints in [0,100) removing those less than 'hits' so
+ * that roughly hits% of the values are removed. The old erase per item loop
+ * is kept here for comparison.
+ */
+struct Filter {
+    d_vector(int) src;
+    d_vector(int) v;
+    int hits;
+};
+
+static void filter_erase(void* udata)
+{
+    struct Filter* f = (struct Filter*) udata;
+    dv_size_t i;
+    dv_set(&f->v, f->src);
+    for (i = 0; i < f->v.size;) {
+        if (f->v.data[i] < f->hits) {
+            dv_erase(&f->v, i, 1);
+        } else {
+            i++;
+        }
+    }
+}
+
+static void filter_remove(void* udata)
+{
+    struct Filter* f = (struct Filter*) udata;
+    dv_set(&f->v, f->src);
+    dv_remove2(&f->v, f->v.data[INDEX] < f->hits);
+}
+
+static void filter_swap_remove(void* udata)
+{
+    struct Filter* f = (struct Filter*) udata;
+    dv_set(&f->v, f->src);
+    dv_swap_remove2(&f->v, f->v.data[INDEX] < f->hits);
+}
+
+static void filter_partition(void* udata)
+{
+    struct Filter* f = (struct Filter*) udata;
+    dv_size_t n;
+    dv_set(&f->v, f->src);
+    dv_partition(&f->v, f->v.data[INDEX] >= f->hits, &n);
+    dv_resize(&f->v, n);
+}
+
+static void bench_filter(void)
+{
+    static const int hits[] = {1, 10, 50, 90};
+    struct Filter f;
+    char name[64];
+    int i;
+
+    dv_init(&f.src);
+    dv_init(&f.v);
+    srand(1);
+    for (i = 0; i < 100000; i++) {
+        dv_append1(&f.src, rand() % 100);
+    }
+
+    for (i = 0; i < (int) (sizeof(hits) / sizeof(hits[0])); i++) {
+        f.hits = hits[i];
+        sprintf(name, "remove %d%% of 100k (erase loop)", f.hits);
+        bench_run(name, 5, &filter_erase, &f);
+        sprintf(name, "remove %d%% of 100k (dv_remove2)", f.hits);
+        bench_run(name, 500, &filter_remove, &f);
+        sprintf(name, "remove %d%% of 100k (dv_swap_remove2)", f.hits);
+        bench_run(name, 500, &filter_swap_remove, &f);
+        sprintf(name, "remove %d%% of 100k (dv_partition)", f.hits);
+        bench_run(name, 500, &filter_partition, &f);
+    }
+
+    dv_free(f.src);
+    dv_free(f.v);
+}
+
+/* Sorts 1M random ints and 100k short strings comparing qsort with dv_sort
+ * and the radix sorts.
+ */
+DVECTOR_INIT(string, d_string);
+
+struct Sort {
+    d_vector(int) isrc;
+    d_vector(int) iv;
+    d_vector(string) ssrc;
+    d_vector(string) sv;
+};
+
+static int cmp_int(const void* a, const void* b)
+{
+    int ia = *(const int*) a;
+    int ib = *(const int*) b;
+    return (ia > ib) - (ia < ib);
+}
+
+static int cmp_string(const void* a, const void* b)
+{ return dv_cmp(*(const d_string*) a, *(const d_string*) b); }
+
+static void sort_int_qsort(void* udata)
+{
+    struct Sort* s = (struct Sort*) udata;
+    dv_set(&s->iv, s->isrc);
+    qsort(s->iv.data, s->iv.size, sizeof(int), &cmp_int);
+}
+
+static void sort_int_dv_sort(void* udata)
+{
+    struct Sort* s = (struct Sort*) udata;
+    dv_set(&s->iv, s->isrc);
+    dv_sort(&s->iv);
+}
+
+static void sort_int_radix(void* udata)
+{
+    struct Sort* s = (struct Sort*) udata;
+    dv_set(&s->iv, s->isrc);
+    dv_sort_int(&s->iv);
+}
+
+static void sort_string_qsort(void* udata)
+{
+    struct Sort* s = (struct Sort*) udata;
+    dv_set(&s->sv, s->ssrc);
+    qsort(s->sv.data, s->sv.size, sizeof(d_string), &cmp_string);
+}
+
+static void sort_string_dv_sort(void* udata)
+{
+    struct Sort* s = (struct Sort*) udata;
+    dv_set(&s->sv, s->ssrc);
+    dv_sort2(&s->sv, dv_cmp(s->sv.data[INDEX1], s->sv.data[INDEX2]) < 0);
+}
+
+static void sort_string_radix(void* udata)
+{
+    struct Sort* s = (struct Sort*) udata;
+    dv_set(&s->sv, s->ssrc);
+    dv_sort_string(&s->sv);
+}
+
+static void bench_sort(void)
+{
+    struct Sort s;
+    d_vector(char) words = DV_INIT;
+    int i;
+
+    dv_init(&s.isrc);
+    dv_init(&s.iv);
+    dv_init(&s.ssrc);
+    dv_init(&s.sv);
+
+    srand(1);
+    for (i = 0; i < 1000000; i++) {
+        dv_append1(&s.isrc, rand());
+    }
+
+    for (i = 0; i < 100000; i++) {
+        dv_print(&words, "item%d ", rand() % 50000);
+    }
+    for (i = 0; i < 100000; i++) {
+        d_string w = dv_split_char((d_string*) &words, ' ');
+        dv_append1(&s.ssrc, w);
+    }
+
+    bench_run("sort 1M ints (qsort)", 5, &sort_int_qsort, &s);
+    bench_run("sort 1M ints (dv_sort)", 5, &sort_int_dv_sort, &s);
+    bench_run("sort 1M ints (dv_sort_int)", 5, &sort_int_radix, &s);
+    bench_run("sort 100k strings (qsort)", 5, &sort_string_qsort, &s);
+    bench_run("sort 100k strings (dv_sort2)", 5, &sort_string_dv_sort, &s);
+    bench_run("sort 100k strings (dv_sort_string)", 5, &sort_string_radix, &s);
+
+    dv_free(s.isrc);
+    dv_free(s.iv);
+    dv_free(s.ssrc);
+    dv_free(s.sv);
+}
+
+/* Finds and counts in 1M int32 and uint8 values with each SIMD level
+ * compared to the generic dv_find.
+ */
+DVECTOR_INIT(u8, uint8_t);
+
+struct Find {
+    d_vector(int) iv;
+    d_vector(u8) bv;
+};
+
+static void find_generic(void* udata)
+{
+    struct Find* f = (struct Find*) udata;
+    dv_size_t idx;
+    dv_find(f->iv, -1, &idx);
+    if (idx != -1) abort();
+}
+
+static void find_int32(void* udata)
+{
+    struct Find* f = (struct Find*) udata;
+    if (dv_find_int(f->iv, -1) != -1) abort();
+}
+
+static void count_int32(void* udata)
+{
+    struct Find* f = (struct Find*) udata;
+    if (dv_count_int(f->iv, 7) == 0) abort();
+}
+
+static void count_uint8(void* udata)
+{
+    struct Find* f = (struct Find*) udata;
+    if (dv_count_int(f->bv, 7) == 0) abort();
+}
+
+static void bench_find(void)
+{
+    static const char* levels[] = {"scalar", "sse2", "avx2"};
+    struct Find f;
+    char name[64];
+    int i;
+
+    dv_init(&f.iv);
+    dv_init(&f.bv);
+    for (i = 0; i < 1000000; i++) {
+        dv_append1(&f.iv, i % 1000);
+        dv_append1(&f.bv, (uint8_t) (i % 100));
+    }
+
+    bench_run("find in 1M int32 (dv_find)", 100, &find_generic, &f);
+
+    for (i = DV_SIMD_NONE; i <= DV_SIMD_AVX2; i++) {
+        dv_set_simd(i);
+        sprintf(name, "find in 1M int32 (%s)", levels[i]);
+        bench_run(name, 100, &find_int32, &f);
+        sprintf(name, "count in 1M int32 (%s)", levels[i]);
+        bench_run(name, 100, &count_int32, &f);
+        sprintf(name, "count in 1M uint8 (%s)", levels[i]);
+        bench_run(name, 100, &count_uint8, &f);
+    }
+
+    dv_set_simd(DV_SIMD_AVX2);
+    dv_free(f.iv);
+    dv_free(f.bv);
+}
+
+/* The JSON and XML builders write into a fresh output vector per document
+ * and format each value through short lived buffers. Servers run many
+ * small documents through this so compare malloc against the buffer pool.
+ */
+static void build_json(void* udata)
+{
+    d_vector(char) out = DV_INIT;
+    int i;
+    (void) udata;
+
+    dv_append(&out, C("{\"items\": ["));
+    for (i = 0; i < 20; i++) {
+        d_vector(char) key = DV_INIT;
+        d_vector(char) num = DV_INIT;
+        dv_print(&key, "item %d", i);
+        dv_print(&num, "%d.%02d", i * 3, i % 100);
+        dv_print(&out, "%s{\"name\": \"%.*s\", \"price\": %.*s}",
+                i ? ", " : "", DV_PRI(key), DV_PRI(num));
+        dv_free(key);
+        dv_free(num);
+    }
+    dv_append(&out, C("]}"));
+    dv_free(out);
+}
+
+static void build_xml(void* udata)
+{
+    d_vector(char) out = DV_INIT;
+    int i;
+    (void) udata;
+
+    dv_append(&out, C("<items>"));
+    for (i = 0; i < 20; i++) {
+        d_vector(char) tag = DV_INIT;
+        d_vector(char) attr = DV_INIT;
+        dv_print(&tag, "item%d", i % 7);
+        dv_print(&attr, "%d.%02d", i * 3, i % 100);
+        dv_print(&out, "<%.*s price=\"%.*s\">item %d</%.*s>",
+                DV_PRI(tag), DV_PRI(attr), i, DV_PRI(tag));
+        dv_free(tag);
+        dv_free(attr);
+    }
+    dv_append(&out, C("</items>"));
+    dv_free(out);
+}
+
+static void bench_pool(void)
+{
+    bench_run("json build (malloc)", 100000, &build_json, NULL);
+    bench_run("xml build (malloc)", 100000, &build_xml, NULL);
+
+    dv_set_pool_limit(1024 * 1024);
+    bench_run("json build (pool)", 100000, &build_json, NULL);
+    bench_run("xml build (pool)", 100000, &build_xml, NULL);
+    dv_pool_trim();
+    dv_set_pool_limit(0);
+}
+
+/* Order books and similar tables are scanned one or two fields at a time.
+ * Compare summing price * qty over 64 byte records against the same rows
+ * stored as columns.
+ */
+typedef struct Order Order;
+struct Order {
+    double price;
+    int qty;
+    int side;
+    int64_t id;
+    int64_t time;
+    char venue[32];
+};
+
+DVECTOR_INIT(Order, Order);
+
+#define ORDER_FIELDS(X)                                                     \
+    X(double, price)                                                        \
+    X(int, qty)                                                             \
+    X(int, side)                                                            \
+    X(int64_t, id)                                                          \
+    X(int64_t, time)                                                        \
+    X(d_string, venue)
+
+DVECTOR_SOA_INIT(order, ORDER_FIELDS);
+
+struct Orders {
+    d_vector(Order) aos;
+    d_soa(order) soa;
+    double sum;
+};
+
+static void scan_aos(void* udata)
+{
+    struct Orders* o = (struct Orders*) udata;
+    double sum = 0;
+    dv_size_t i;
+    for (i = 0; i < o->aos.size; i++) {
+        sum += o->aos.data[i].price * o->aos.data[i].qty;
+    }
+    o->sum = sum;
+}
+
+static void scan_soa(void* udata)
+{
+    struct Orders* o = (struct Orders*) udata;
+    double sum = 0;
+    dv_size_t i;
+    for (i = 0; i < o->soa.size; i++) {
+        sum += o->soa.price[i] * o->soa.qty[i];
+    }
+    o->sum = sum;
+}
+
+static void bench_soa(void)
+{
+    struct Orders o;
+    double aos;
+    dv_size_t i, n = 4000000;
+
+    dv_init(&o.aos);
+    memset(&o.soa, 0, sizeof(o.soa));
+    dv_resize(&o.aos, n);
+    dsoa_resize_order(&o.soa, n);
+    memset(o.aos.data, 0, n * sizeof(Order));
+    for (i = 0; i < n; i++) {
+        o.aos.data[i].price = o.soa.price[i] = (i % 1000) * 0.25;
+        o.aos.data[i].qty = o.soa.qty[i] = (int) (i % 17);
+        o.aos.data[i].side = o.soa.side[i] = (int) (i & 1);
+        o.aos.data[i].id = o.soa.id[i] = i;
+        o.aos.data[i].time = o.soa.time[i] = i * 3;
+        o.soa.venue[i] = C("XNAS");
+    }
+
+    bench_run("scan 4M price*qty (aos)", 20, &scan_aos, &o);
+    aos = o.sum;
+    bench_run("scan 4M price*qty (soa)", 20, &scan_soa, &o);
+    if (aos != o.sum) abort();
+
+    dv_free(o.aos);
+    dsoa_free_order(&o.soa);
+}
+
+static void generate_json(d_vector(char)* out, int items)
+{
+    int i;
+    dv_append(out, C("{\"items\": ["));
+    for (i = 0; i < items; i++) {
+        dv_print(out, "%s{\"id\": %d, \"name\": \"item %d\", \"price\": %d.%02d, \"tags\": [\"a\", \"b%d\"]}",
+                i ? ", " : "", i, i, i * 3, i % 100, i % 7);
+    }
+    dv_append(out, C("]}"));
+}
+
+static void generate_xml(d_vector(char)* out, int items)
+{
+    int i;
+    dv_append(out, C("<items>"));
+    for (i = 0; i < items; i++) {
+        dv_print(out, "<item id=\"%d\" price=\"%d.%02d\"><name>item %d</name><tag>a</tag><tag>b%d</tag></item>",
+                i, i * 3, i % 100, i, i % 7);
+    }
+    dv_append(out, C("</items>"));
+}
+
+int main(void)
+{
+    d_vector(char) json = DV_INIT;
+    d_vector(char) xml = DV_INIT;
+    dv_arena arena;
+    Workload w;
+
+    generate_json(&json, 200);
+    generate_xml(&xml, 200);
+    dv_arena_init(&arena, 0);
+
+    w.doc = json;
+    w.arena = NULL;
+    bench_run_bytes("json parse (malloc)", 2000, w.doc.size, &parse_json, &w);
+    w.arena = &arena;
+    bench_run_bytes("json parse (arena)", 2000, w.doc.size, &parse_json, &w);
+
+    w.doc = xml;
+    w.arena = NULL;
+    bench_run_bytes("xml parse (malloc)", 2000, w.doc.size, &parse_xml, &w);
+    w.arena = &arena;
+    bench_run_bytes("xml parse (arena)", 2000, w.doc.size, &parse_xml, &w);
+
+    w.arena = NULL;
+    count_allocations("xml scope tags (vector)", &stream_tags_vector, &w);
+    count_allocations("xml scope tags (inline)", &stream_tags_inline, &w);
+    bench_run("xml scope tags (vector)", 2000, &stream_tags_vector, &w);
+    bench_run("xml scope tags (inline)", 2000, &stream_tags_inline, &w);
+
+    bench_filter();
+    bench_sort();
+    bench_find();
+    bench_pool();
+    bench_soa();
+
+    dv_arena_free(&arena);
+    dv_free(json);
+    dv_free(xml);
+    return 0;
+}
@@ -0,0 +1,185 @@
+/* vim: ts=4 sw=4 sts=4 et
+ *
+ * Copyright (c) 2009 James R. McKaskill
+ *
+ * This software is licensed under the stock MIT license:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * ----------------------------------------------------------------------------
+ */
+
+#include <dmem/vector.hpp>
+#include <dmem/char.h>
+#include "test.h"
+
+struct Point {
+    Point() : x(0), y(0) {}
+    Point(int x_, int y_) : x(x_), y(y_) {}
+    int x, y;
+};
+
+DVECTOR_INIT(Point, Point);
+DVECTOR_INIT(int, int);
+
+static dv_size_t sum(d_slice(int) s)
+{
+    dv_size_t ret = 0;
+    for (dv_size_t i = 0; i < s.size; i++) {
+        ret += s.data[i];
+    }
+    return ret;
+}
+
+/* char masks can be built at compile time */
+constexpr dv_char_mask g_ws = dv_mask(" \t\r\n");
+static_assert(g_ws.d[0] == ((1U << '\t') | (1U << '\r') | (1U << '\n')), "dv_mask");
+static_assert(g_ws.d[1] == 1U, "dv_mask");
+static_assert(dv_mask("\xE9").d[7] == 1U << 9, "dv_mask");
+static const dv_char_mask g_ws_c = DV_MASK_INIT(' ', '\t', '\r', '\n');
+
+/* only slices can be taken without copying, an owning d_vector has to go
+ * through release */
+static_assert(std::is_convertible<dmem::vector<int>, d_slice(int)>::value, "slice conversion");
+static_assert(!std::is_convertible<dmem::vector<int>, d_vector(int)>::value, "vector conversion");
+static_assert(!std::is_convertible<dmem::vector<char>, d_slice(int)>::value, "slice type mismatch");
+
+static dmem::vector<int> make_range(int num)
+{
+    dmem::vector<int> ret;
+    for (int i = 0; i < num; i++) {
+        ret.push_back(i);
+    }
+    return ret;
+}
+
+int main(void)
+{
+    /* push_back, emplace_back and iteration */
+    dmem::vector<Point> p;
+    check(p.empty());
+    check(p.data() == NULL);
+    p.push_back(Point(1, 2));
+    Point& e = p.emplace_back(3, 4);
+    check_int(e.x, 3);
+    check_int(p.size(), 2);
+    check_int(p[0].y, 2);
+    check_int(p.back().y, 4);
+    int total = 0;
+    for (const Point& i : p) {
+        total += i.x + i.y;
+    }
+    check_int(total, 10);
+
+    /* emplace_back of an existing value survives the vector growing */
+    for (int i = 0; i < 100; i++) {
+        p.emplace_back(p[0]);
+    }
+    check_int(p.size(), 102);
+    check_int(p[101].x, 1);
+
+    /* move construction and assignment hand over the storage */
+    Point* data = p.data();
+    dmem::vector<Point> q(std::move(p));
+    check(q.data() == data);
+    check(p.data() == NULL);
+    check_int(p.size(), 0);
+    p = std::move(q);
+    check(p.data() == data);
+    check(q.empty());
+
+    dmem::vector<int> r = make_range(10);
+    check_int(r.size(), 10);
+    r = make_range(5);
+    check_int(r.size(), 5);
+
+    /* clone has its own storage */
+    dmem::vector<Point> c = p.clone();
+    check(c.data() != p.data());
+    check_int(c.size(), p.size());
+    check_int(c[1].x, 3);
+
+    /* converts to a d_slice without copying */
+    d_slice(int) s = r;
+    check(s.data == r.data());
+    check_int(s.size, 5);
+    check_int(sum(r), 10);
+
+    /* reserve and resize */
+    r.reserve(1000);
+    check(r.capacity() >= 1000);
+    check_int(r.size(), 5);
+    r.resize(8);
+    check_int(r[7], 0);
+    r.resize(10, 7);
+    check_int(r[9], 7);
+    check_int(r[4], 4);
+    r.erase(0, 2);
+    check_int(r.size(), 8);
+    check_int(r[0], 2);
+    r.pop_back();
+    check_int(r.back(), 7);
+    r.clear();
+    check(r.empty());
+
+    /* append from slices and C vectors */
+    dmem::vector<int> a{1, 2, 3};
+    d_vector(int) cv = DV_INIT;
+    dv_append1(&cv, 4);
+    dv_append1(&cv, 5);
+    a.append(cv);
+    a.append(a.clone());
+    check_int(a.size(), 10);
+    check_int(a[4], 5);
+    check_int(a[9], 5);
+    dv_free(cv);
+
+    /* strings stay nul terminated and work with the C functions */
+    dmem::vector<char> str;
+    dv_print(str.c_vec<d_vector(char)>(), "%d-%s", 42, "x");
+    check_string(str, C("42-x"));
+    str.push_back('!');
+    check_int(str.data()[str.size()], 0);
+    str.resize(2);
+    check_int(str.data()[2], 0);
+    check_string(str, C("42"));
+
+    /* constexpr and macro masks agree */
+    for (int i = 0; i < 8; i++) {
+        check_int(g_ws.d[i], g_ws_c.d[i]);
+    }
+    d_string words = C("a b\tc");
+    check_string(dv_split_mask(&words, &g_ws), C("a"));
+    check_int(dv_find_mask(words, &g_ws), 1);
+
+    /* release and adopt move ownership to and from C */
+    d_vector(int) rel = a.release<d_vector(int)>();
+    check(a.empty());
+    check_int(rel.size, 10);
+    dmem::vector<int> ad = dmem::vector<int>::adopt(rel);
+    check(ad.data() == rel.data);
+
+    /* swap */
+    ad.swap(r);
+    check(ad.empty());
+    check_int(r.size(), 10);
+
+    dv_free(g_log);
+    return 0;
+}
@@ -26,9 +26,14 @@
  */
 
 #include <dmem/vector.h>
+#include <pthread.h>
 #include "test.h"
 
 DVECTOR_INIT(int, int);
+DVECTOR_INIT(u16, uint16_t);
+DVECTOR_INIT(u8, uint8_t);
+DVECTOR_INIT(i64, int64_t);
+DVECTOR_INLINE_INIT(int4, int, 4 * sizeof(int));
 
 static int generations;
 static d_vector(int) generation;
@@ -42,12 +47,31 @@ static d_slice(int) generate() {
 	return generation;
 }
 
+static void* free_on_thread(void* udata) {
+	d_vector(int) v = DV_INIT;
+	dv_resize(&v, 1000);
+	*(int**) udata = v.data;
+	dv_free(v);
+	return NULL;
+}
+
 int main(void)
 {
 	d_vector(int) v = DV_INIT;
 	int *p;
+	size_t pooled;
+	pthread_t thread;
 	int int3[3] = {1,2,3};
-	int idx;
+	dv_size_t idx;
+	dv_arena arena;
+	d_inline(int4) iv, iv2;
+	d_vector(u16) u = DV_INIT;
+	d_vector(u8) u8 = DV_INIT;
+	d_vector(i64) i64 = DV_INIT;
+	uint16_t any[3] = {296, 90, 60};
+	d_slice(u16) vals;
+	dv_stats st, st2;
+	int i, level;
 
 	check_int(v.size, 0);
 	check(v.data == NULL);
@@ -198,6 +222,45 @@ int main(void)
 	check_int(v.size, 1);
 	check_int(v.data[0], 35);
 
+	dv_clear(&v);
+	for (idx = 0; idx < 10; idx++) {
+		dv_append1(&v, (int) idx);
+	}
+	dv_remove2(&v, v.data[INDEX] % 3 == 0);
+	check_int(v.size, 6);
+	check_int(v.data[0], 1);
+	check_int(v.data[1], 2);
+	check_int(v.data[2], 4);
+	check_int(v.data[5], 8);
+	dv_remove(&v, 100);
+	check_int(v.size, 6);
+
+	dv_swap_erase(&v, 1);
+	check_int(v.size, 5);
+	check_int(v.data[1], 8);
+	check_int(v.data[4], 7);
+
+	/* 1 8 4 5 7 -> 7 5 4 */
+	dv_swap_remove2(&v, v.data[INDEX] < 2 || v.data[INDEX] > 7);
+	check_int(v.size, 3);
+	check_int(v.data[0], 7);
+	check_int(v.data[1], 5);
+	check_int(v.data[2], 4);
+	dv_swap_remove(&v, 4);
+	check_int(v.size, 2);
+	check_int(v.data[1], 5);
+
+	dv_clear(&v);
+	for (idx = 0; idx < 10; idx++) {
+		dv_append1(&v, (int) idx);
+	}
+	dv_partition(&v, v.data[INDEX] & 1, &idx);
+	check_int(idx, 5);
+	check_int(v.size, 10);
+	for (idx = 0; idx < 10; idx++) {
+		check_int(v.data[idx] & 1, idx < 5);
+	}
+
 	dv_resize(&v, 3);
 	v.data[0] = 45;
 	v.data[1] = 35;
@@ -236,5 +299,281 @@ int main(void)
 	v.data[2] = 5;
 	check(!dv_ends_with(v, generate()));
 
+	dv_free(v);
+	dv_init(&v);
+
+	dv_arena_init(&arena, 256);
+
+	dv_reserve_alloc(&v, 4, &arena.base);
+	check(dv_allocator_base(v.data) == &arena.base);
+	check(dv_reserved(v) >= 4);
+	p = v.data;
+	dv_resize(&v, 8);
+	check(v.data == p);
+	v.data[7] = 7;
+
+	/* large blocks go into their own chunk */
+	dv_resize(&v, 1000);
+	check(v.data != p);
+	check_int(v.data[7], 7);
+	check(dv_reserved(v) >= 1000 * sizeof(int));
+
+	/* move the data back to malloc */
+	dv_reserve_alloc(&v, v.size, NULL);
+	check(dv_allocator_base(v.data) == NULL);
+	check_int(v.size, 1000);
+	check_int(v.data[7], 7);
+	dv_free(v);
+	dv_init(&v);
+
+	check(dv_set_allocator(&arena.base) == NULL);
+	check(dv_current_allocator() == &arena.base);
+	dv_append2(&v, int3, 3);
+	check(dv_allocator_base(v.data) == &arena.base);
+	check_int(v.data[2], 3);
+	dv_free(v);
+	dv_init(&v);
+	check(dv_set_allocator(NULL) == &arena.base);
+
+	dv_arena_reset(&arena);
+	check(arena.blocks != NULL);
+	check_int(arena.end - arena.next, 256);
+	dv_arena_free(&arena);
+	check(arena.blocks == NULL);
+
+	dv_init_inline(&iv);
+	check_int(iv.v.size, 0);
+	check(iv.v.data == (int*) iv.buf);
+	check_int(dv_reserved(iv.v), 4 * sizeof(int));
+	dv_append2(&iv.v, int3, 3);
+	dv_insert2(&iv.v, 0, int3, 1);
+	check(iv.v.data == (int*) iv.buf);
+	check_int(iv.v.size, 4);
+	check_int(iv.v.data[0], 1);
+	check_int(iv.v.data[3], 3);
+	dv_erase(&iv.v, 0, 1);
+	check_int(iv.v.size, 3);
+	check_int(iv.v.data[0], 1);
+
+	iv2 = iv;
+	dv_inline_moved(&iv2);
+	check(iv2.v.data == (int*) iv2.buf);
+	check_int(iv2.v.data[2], 3);
+
+	/* spill to the heap */
+	dv_append(&iv.v, generate());
+	check(iv.v.data != (int*) iv.buf);
+	check_int(iv.v.size, 6);
+	check_int(iv.v.data[0], 1);
+	check_int(iv.v.data[5], 3);
+	iv2 = iv;
+	dv_inline_moved(&iv2);
+	check(iv2.v.data == iv.v.data);
+	dv_free(iv.v);
+
+	memset(&iv, 0, sizeof(iv));
+	dv_inline_moved(&iv);
+	check(iv.v.data == NULL);
+
+	/* sorting */
+	dv_clear(&v);
+	for (i = 0; i < 1000; i++) {
+		dv_append1(&v, rand() % 500 - 250);
+	}
+	dv_sort(&v);
+	for (i = 1; i < v.size; i++) {
+		check(v.data[i-1] <= v.data[i]);
+	}
+	dv_sort(&v); /* already sorted */
+	for (i = 1; i < v.size; i++) {
+		check(v.data[i-1] <= v.data[i]);
+	}
+	dv_sort2(&v, v.data[INDEX1] > v.data[INDEX2]);
+	for (i = 1; i < v.size; i++) {
+		check(v.data[i-1] >= v.data[i]);
+	}
+	dv_sort_int(&v);
+	for (i = 1; i < v.size; i++) {
+		check(v.data[i-1] <= v.data[i]);
+	}
+
+	dv_lower_bound(v, 10, &idx);
+	check(idx == 0 || v.data[idx-1] < 10);
+	check(idx == v.size || v.data[idx] >= 10);
+	dv_upper_bound(v, 10, &idx);
+	check(idx == 0 || v.data[idx-1] <= 10);
+	check(idx == v.size || v.data[idx] > 10);
+	dv_lower_bound(v, 1000, &idx);
+	check_int(idx, v.size);
+	dv_upper_bound(v, -1000, &idx);
+	check_int(idx, 0);
+
+	dv_unique(&v);
+	for (i = 1; i < v.size; i++) {
+		check(v.data[i-1] < v.data[i]);
+	}
+
+	dv_clear(&v);
+	for (i = 0; i < 10; i++) {
+		dv_append1(&v, i & 1 ? INT_MIN : i * 1000);
+	}
+	dv_sort_int(&v);
+	check_int(v.data[0], INT_MIN);
+	check_int(v.data[4], INT_MIN);
+	check_int(v.data[5], 0);
+	check_int(v.data[9], 8000);
+
+	for (i = 0; i < 1000; i++) {
+		dv_append1(&u, (uint16_t) (i * 7919));
+	}
+	dv_sort_uint(&u);
+	for (i = 1; i < u.size; i++) {
+		check(u.data[i-1] <= u.data[i]);
+	}
+
+	/* integer find for each width with each SIMD level */
+	dv_clear(&v);
+	dv_clear(&u);
+	for (i = 0; i < 100; i++) {
+		dv_append1(&u8, (uint8_t) (i * 3));
+		dv_append1(&u, (uint16_t) (i * 3));
+		dv_append1(&v, i * 3 - 150);
+		dv_append1(&i64, (int64_t) (i * 3) << 32);
+	}
+	for (level = DV_SIMD_NONE; level <= DV_SIMD_AVX2; level++) {
+		dv_set_simd(level);
+
+		check_int(dv_find_int(u8, 0), 0);
+		check_int(dv_find_int(u8, 3), 1);
+		check_int(dv_find_int(u8, 297 & 0xFF), 99);
+		check_int(dv_find_int(u8, 1), -1);
+		check_int(dv_count_int(u8, 2), 1); /* 258 & 0xFF */
+		check_int(dv_count_int(u8, 1), 0);
+		check_int(dv_find_int(u, 297), 99);
+		check_int(dv_find_int(u, 40), -1);
+		check_int(dv_count_int(u, 42), 1);
+		check_int(dv_find_int(v, -150), 0);
+		check_int(dv_find_int(v, -3), 49);
+		check_int(dv_find_int(v, 147), 99);
+		check_int(dv_find_int(v, -2), -1);
+		check_int(dv_count_int(v, 0), 1);
+		check_int(dv_find_int(i64, (int64_t) 150 << 32), 50);
+		check_int(dv_find_int(i64, 150), -1);
+		check_int(dv_find_int(i64, ((int64_t) 150 << 32) + 1), -1);
+		check_int(dv_count_int(i64, (int64_t) 297 << 32), 1);
+
+		dv_find(v, 93, &idx);
+		check_int(dv_find_int(v, 93), idx);
+
+		vals.data = any;
+		vals.size = 3;
+		check_int(dv_find_any_int(u, vals), 20);
+		vals.size = 1;
+		check_int(dv_find_any_int(u, vals), -1);
+	}
+	/* enough to overflow 8 bit lane counts */
+	dv_clear(&u8);
+	dv_append_zeroed(&u8, 5001);
+	u8.data[5000] = 1;
+	for (level = DV_SIMD_NONE; level <= DV_SIMD_AVX2; level++) {
+		dv_set_simd(level);
+		check_int(dv_count_int(u8, 0), 5000);
+		check_int(dv_find_int(u8, 1), 5000);
+	}
+	dv_set_simd(DV_SIMD_AVX2);
+	dv_free(u);
+	dv_free(u8);
+	dv_free(i64);
+
+	/* allocation stats */
+#ifdef DMEM_STATS
+	/* the test log is itself a vector, so only check between snapshots */
+	dv_free(v);
+	dv_init(&v);
+	dv_get_stats(&st);
+	dv_resize(&v, 10);
+	dv_get_stats(&st2);
+	check_int(st2.live, st.live + 1);
+	check_int(st2.used, st.used + 10 * sizeof(int));
+	check(st2.reserved - st.reserved >= 10 * sizeof(int));
+	dv_get_stats(&st);
+	for (i = 0; i < 1000; i++) {
+		dv_append1(&v, i);
+	}
+	dv_erase(&v, 0, 10);
+	dv_get_stats(&st2);
+	check(st2.reallocs > st.reallocs);
+	check(st2.copied > st.copied);
+	check_int(st2.live, st.live);
+	check_int(st2.used, st.used + 990 * sizeof(int));
+	check(st2.reserved - st2.used >= 0);
+	dv_get_stats(&st);
+	dv_free(v);
+	dv_init(&v);
+	dv_get_stats(&st2);
+	check_int(st2.live, st.live - 1);
+	check(st2.used < st.used);
+	check(st2.reserved < st.reserved);
+#else
+	st.live = 1;
+	check(!dv_get_stats(&st));
+	st2 = st;
+	check_int(st2.live, 0);
+#endif
+
+	/* the buffer pool hands freed blocks back out, the test log is also a
+	 * vector so only check between steps */
+	dv_free(v);
+	dv_init(&v);
+	dv_set_pool_limit(1024 * 1024);
+	dv_resize(&v, 10);
+	p = v.data;
+	dv_free(v);
+	pooled = dv_pool_size();
+	dv_init(&v);
+	dv_resize(&v, 5);
+	check(pooled > 0);
+	check(v.data == p);
+	check_int(dv_reserved(v), 48);
+	dv_init(&u);
+	dv_resize(&u, 10);
+	dv_pool_trim();
+	dv_set_pool_limit(100);
+	dv_free(v);
+	dv_free(u);
+	pooled = dv_pool_size();
+	dv_init(&v);
+	dv_init(&u);
+	check(pooled > 0 && pooled <= 100);
+	dv_pool_trim();
+	check_int(dv_pool_size(), 0);
+
+	/* a thread's cache moves to the shared lists when it exits */
+	dv_set_pool_limit(1024 * 1024);
+	pthread_create(&thread, NULL, &free_on_thread, &p);
+	pthread_join(thread, NULL);
+	pooled = dv_pool_size();
+	dv_resize(&v, 1000);
+	check(pooled > 0);
+	check(v.data == p);
+	dv_free(v);
+	dv_init(&v);
+	dv_pool_trim();
+	check_int(dv_pool_size(), 0);
+	dv_set_pool_limit(0);
+
+	/* large vectors move to a memory map and grow with mremap */
+	dv_set_mmap_threshold(64 * 1024, false);
+	dv_clear(&v);
+	for (idx = 0; idx < 100000; idx++) {
+		dv_append1(&v, (int) idx);
+	}
+	check_int(v.size, 100000);
+	check_int(v.data[0], 0);
+	check_int(v.data[12345], 12345);
+	check_int(v.data[99999], 99999);
+	dv_free(v);
+	dv_set_mmap_threshold(64 * 1024 * 1024, false);
+
 	return 0;
 }
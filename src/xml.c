@@ -96,28 +96,28 @@ static bool ReplaceEscapedValue(d_vector(char)* buffer, int begin)
 
     if (dv_begins_with(str, C("&#x"))) {
         /* &#x33; */
-        char* chend;
-        long val = strtol(str.data + 3, &chend, 16);
+        int64_t val;
+        d_string digits = dv_right(str, 3);
 
-        if (chend != str.data + str.size || val < 0 || val > UNICODE_MAX) {
+        if (!digits.size || dv_parse_integer(digits, 16, &val) != digits.size || val < 0 || val > UNICODE_MAX) {
             return false;
         }
 
         dv_resize(buffer, begin);
-        AppendUtf8(buffer, val);
+        AppendUtf8(buffer, (long) val);
         return true;
 
     } else if (dv_begins_with(str, C("&#"))) {
         /* &#33; */
-        char* chend;
-        long val = strtol(str.data + 2, &chend, 10);
+        int64_t val;
+        d_string digits = dv_right(str, 2);
 
-        if (chend != str.data + str.size || val < 0 || val > UNICODE_MAX) {
+        if (!digits.size || dv_parse_integer(digits, 10, &val) != digits.size || val < 0 || val > UNICODE_MAX) {
             return false;
         }
 
         dv_resize(buffer, begin);
-        AppendUtf8(buffer, val);
+        AppendUtf8(buffer, (long) val);
         return true;
 
     } else if (dv_equals(str, C("&amp"))) {
@@ -328,17 +328,49 @@ static const char* SearchForCharacter(dx_Parser* p, const char* b, const char* e
 
 /* ------------------------------------------------------------------------- */
 
+/* The scope tag buffers use inline storage which has to be fixed up when the
+ * scopes vector is reallocated.
+ */
+static void ScopesMoved(dx_Parser* s)
+{
+    int i;
+
+    for (i = 0; i < s->scopes.size; i++) {
+        dxi_Scope* x = &s->scopes.data[i];
+        bool tag_in_buf = x->tag.data == x->tagbuf.v.data;
+
+        dv_inline_moved(&x->tagbuf);
+
+        if (tag_in_buf) {
+            x->tag.data = x->tagbuf.v.data;
+        }
+    }
+}
+
 static dxi_Scope* PushScope(dx_Parser* s, dx_Node* node, const char* b, d_string* inner_xml)
 {
+    dxi_Scope* old = s->scopes.data;
     dxi_Scope* scope = dv_append_zeroed(&s->scopes, 1);
-    scope->tag = s->current_tag;
-    scope->tagbuf = s->tagbuf;
+
+    if (s->scopes.data != old) {
+        ScopesMoved(s);
+    }
+
+    dv_init_inline(&scope->tagbuf);
+
+    if (s->current_tag.data && s->current_tag.data == s->tagbuf.data) {
+        dv_set(&scope->tagbuf.v, s->current_tag);
+        scope->tag = scope->tagbuf.v;
+    } else {
+        scope->tag = s->current_tag;
+    }
+
     scope->namespaces_size = s->namespaces.size;
     scope->on_element = node->on_element;
     scope->on_inner_xml = node->on_inner_xml;
     scope->on_end = node->on_end;
     memset(&s->current_tag, 0, sizeof(s->current_tag));
-    memset(&s->tagbuf, 0, sizeof(s->tagbuf));
+    dv_clear(&s->tagbuf);
 
     if (node->on_inner_xml.func && s->outermost_inner_xml_scope < 0) {
         s->outermost_inner_xml_scope = s->scopes.size;
@@ -355,7 +387,7 @@ static dxi_Scope* PopScope(dx_Parser* s)
 {
     int i;
     dxi_Scope* scope = &dv_last(s->scopes);
-    dv_free(scope->tagbuf);
+    dv_free(scope->tagbuf.v);
 
     if (s->scopes.size == s->outermost_inner_xml_scope) {
         dv_clear(&s->inner_xml);
@@ -381,6 +413,7 @@ static void SetupNode(dx_Parser* s, dxi_Scope* scope, dx_Node* node)
     int i, j, colon;
 
     memset(node, 0, sizeof(dx_Node));
+    node->source = s->source;
 
 
     /* Resolve the attributes */
@@ -440,6 +473,7 @@ int dx_parse_chunk(dx_Parser* s, d_string str)
     int ret;
 
     memset(&node, 0, sizeof(node));
+    node.source = s->source;
 
     ret = setjmp(s->jmp);
     if (ret == DXI_ERROR) {
@@ -449,9 +483,9 @@ int dx_parse_chunk(dx_Parser* s, d_string str)
 
         for (i = 0; i < s->scopes.size; i++) {
             dxi_Scope* x = &s->scopes.data[i];
-            if (x->tag.data != x->tagbuf.data) {
-                dv_set(&x->tagbuf, x->tag);
-                x->tag = x->tagbuf;
+            if (x->tag.data != x->tagbuf.v.data) {
+                dv_set(&x->tagbuf.v, x->tag);
+                x->tag = x->tagbuf.v;
             }
         }
         
@@ -831,6 +865,7 @@ int dx_parse_chunk(dx_Parser* s, d_string str)
         }
 
         memset(&node, 0, sizeof(node));
+        node.source = s->source;
 
         if (scope->on_inner_xml.func) {
             int in_buf = s->inner_xml.size - scope->inner_xml_off;
@@ -869,6 +904,7 @@ int dx_parse_chunk(dx_Parser* s, d_string str)
             }
 
             memset(&node, 0, sizeof(node));
+            node.source = s->source;
         }
 
         if (scope->on_end.func && !CALL_DELEGATE_1(scope->on_end, &node)) {
@@ -910,7 +946,7 @@ void dx_free_parser(dx_Parser* s)
         int i;
 
         for (i = 0; i < s->scopes.size; i++) {
-            dv_free(s->scopes.data[i].tagbuf);
+            dv_free(s->scopes.data[i].tagbuf.v);
         }
         dv_free(s->scopes);
 
@@ -951,6 +987,19 @@ bool dx_parse(d_string str, dx_Delegate dlg, d_vector(char)* errstr)
     return ret;
 }
 
+/* The parser doesn't take a reference, nodes borrow the caller's for the
+ * duration of the parse */
+bool dx_parse_shared(d_shared str, dx_Delegate dlg, d_vector(char)* errstr)
+{
+    int ret;
+    dx_Parser* s = dx_new_parser(dlg);
+    s->errstr = errstr;
+    s->source = str;
+    ret = dx_parse_chunk(s, ds_string(str));
+    dx_free_parser(s);
+    return ret;
+}
+
 /* ------------------------------------------------------------------------- */
 
 d_string dx_attribute(const dx_Node* element, d_string name)
@@ -1125,7 +1174,7 @@ void dx_append_number_attribute(dx_Builder* b, d_string key, double value)
     dv_append(&b->out, C(" "));
     dv_append(&b->out, key);
     dv_append(&b->out, C("=\""));
-    dv_print(&b->out, "%.16g", value);
+    dv_append_number(&b->out, value);
     dv_append(&b->out, C("\""));
 }
 
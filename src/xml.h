@@ -70,12 +70,16 @@ struct dxi_OffsetString {
     int size;
 };
 
+/* Most tag names fit inline so buffering a scope's tag across chunks
+ * doesn't need to allocate */
+DVECTOR_INLINE_INIT(tag, char, 32);
+
 struct dxi_Scope {
     dx_Delegate             on_element;
     dx_Delegate             on_inner_xml;
     dx_Delegate             on_end;
     d_Slice(char)           tag;
-    d_Vector(char)          tagbuf;
+    d_inline(tag)           tagbuf;
     int                     namespaces_size;
     int                     inner_xml_off;
 };
@@ -107,5 +111,7 @@ struct dx_Parser {
 
     d_Vector(char)          inner_xml;
     int                     outermost_inner_xml_scope;
+
+    d_shared                source;
 };
 